@@ -45,6 +45,9 @@ local conf = {
   math = {
     globals = true
   },
+  physics = {
+    shapecache = false
+  },
   thread = {
     workers = -1
   },
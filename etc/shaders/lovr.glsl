@@ -64,9 +64,13 @@ layout(set = 1, binding = 5) uniform texture2D ClearcoatTexture;
 layout(set = 1, binding = 6) uniform texture2D OcclusionTexture;
 layout(set = 1, binding = 7) uniform texture2D NormalTexture;
 
+// The high bit is set when identical draws are batched into one instanced draw.  Each instance is
+// one of the original draws and the base instance is the first draw's index into Draws.
 layout(push_constant) uniform PushConstants {
-  uint DrawID;
+  uint DrawBits;
 };
+
+#define Batched ((DrawBits & 0x80000000u) != 0u)
 #endif
 
 // Attributes
@@ -117,10 +121,10 @@ layout(location = 14) in vec4 Tangent;
 #endif
 
 #ifdef GL_VERTEX_SHADER
-#define BaseInstance gl_BaseInstance
+#define BaseInstance (Batched ? 0 : gl_BaseInstance)
 #define BaseVertex gl_BaseVertex
 #define DrawIndex gl_DrawIndex
-#define InstanceIndex gl_InstanceIndex
+#define InstanceIndex (Batched ? 0 : gl_InstanceIndex)
 #define PointSize gl_PointSize
 #define Position gl_Position
 #define VertexIndex gl_VertexIndex
@@ -154,6 +158,14 @@ layout(location = 14) in vec4 Tangent;
 #define CameraPositionWorld (-View[3].xyz * mat3(View))
 #endif
 
+// Batched draws only know their draw index in the vertex stage, so shaders that use DrawID in the
+// other stages are never batched
+#ifdef GL_VERTEX_SHADER
+#define DrawID (Batched ? uint(gl_InstanceIndex) : DrawBits)
+#elif !defined(GL_COMPUTE_SHADER)
+#define DrawID (DrawBits & 0xffu)
+#endif
+
 #ifdef GL_VERTEX_SHADER
 #define Transform mat4(Draws[DrawID].transform)
 #define NormalMatrix (cofactor3(Draws[DrawID].transform))
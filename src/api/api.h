@@ -43,6 +43,8 @@ extern StringEntry lovrFilterMode[];
 extern StringEntry lovrFoveationLevel[];
 extern StringEntry lovrHeadsetDriver[];
 extern StringEntry lovrHorizontalAlign[];
+extern StringEntry lovrImageFilter[];
+extern StringEntry lovrImageOp[];
 extern StringEntry lovrJointType[];
 extern StringEntry lovrKeyboardKey[];
 extern StringEntry lovrLayerType[];
@@ -148,6 +150,7 @@ struct Image;
 struct ModelData;
 struct Blob* luax_readblob(lua_State* L, int index, const char* debug);
 struct Image* luax_checkimage(lua_State* L, int index);
+void luax_checkimages(lua_State* L, int count, struct Image** images);
 uint32_t luax_checkcodepoint(lua_State* L, int index);
 uint32_t luax_checkanimationindex(lua_State* L, int index, struct ModelData* model);
 uint32_t luax_checkmaterialindex(lua_State* L, int index, struct ModelData* model);
@@ -72,6 +72,71 @@ Image* luax_checkimage(lua_State* L, int index) {
   return image;
 }
 
+// Like luax_checkimage, for the top count values on the stack, decoding any files in parallel
+void luax_checkimages(lua_State* L, int count, Image** images) {
+  Blob* blobStack[8];
+  Image* decodedStack[8];
+  int base = lua_gettop(L) - count + 1;
+
+  // Arguments are checked before anything is allocated so a bad one doesn't leak the others
+  for (int i = 0; i < count; i++) {
+    if (!luax_totype(L, base + i, Image) && !luax_totype(L, base + i, Blob)) {
+      luaL_checkstring(L, base + i);
+    }
+  }
+
+  bool heap = count > (int) COUNTOF(blobStack);
+  Blob** blobs = heap ? lovrMalloc(count * sizeof(Blob*)) : blobStack;
+  Image** decoded = heap ? lovrMalloc(count * sizeof(Image*)) : decodedStack;
+  uint32_t blobCount = 0;
+
+  for (int i = 0; i < count; i++) {
+    if ((images[i] = luax_totype(L, base + i, Image)) != NULL) {
+      continue;
+    } else if ((blobs[blobCount] = luax_totype(L, base + i, Blob)) != NULL) {
+      lovrRetain(blobs[blobCount++]);
+    } else {
+      size_t size;
+      const char* path = lua_tostring(L, base + i);
+      void* data = luax_readfile(path, &size);
+
+      if (!data) {
+        for (uint32_t j = 0; j < blobCount; j++) {
+          lovrRelease(blobs[j], lovrBlobDestroy);
+        }
+
+        if (heap) {
+          lovrFree(blobs);
+          lovrFree(decoded);
+        }
+
+        luaL_error(L, "Could not read Image from '%s'", path);
+      }
+
+      blobs[blobCount++] = lovrBlobCreate(data, size, path);
+    }
+  }
+
+  bool success = lovrImageCreateFromFiles(blobs, blobCount, false, decoded);
+
+  for (int i = 0, j = 0; i < count; i++) {
+    if (!images[i]) {
+      lovrRelease(blobs[j], lovrBlobDestroy);
+      images[i] = success ? decoded[j] : NULL;
+      j++;
+    } else if (success) {
+      lovrRetain(images[i]);
+    }
+  }
+
+  if (heap) {
+    lovrFree(blobs);
+    lovrFree(decoded);
+  }
+
+  luax_assert(L, success);
+}
+
 static int l_lovrDataNewBlob(lua_State* L) {
   size_t size;
   uint8_t* data = NULL;
@@ -127,9 +192,10 @@ static int l_lovrDataNewImage(lua_State* L) {
       memcpy(lovrImageGetLayerData(image, 0, 0), lovrImageGetLayerData(source, 0, 0), lovrImageGetLayerSize(image, 0));
     } else {
       Blob* blob = luax_readblob(L, 1, "Texture");
-      image = lovrImageCreateFromFile(blob);
+      bool compact = lua_toboolean(L, 2);
+      bool success = lovrImageCreateFromFiles(&blob, 1, compact, &image);
       lovrRelease(blob, lovrBlobDestroy);
-      luax_assert(L, image);
+      luax_assert(L, success);
     }
   }
 
@@ -52,6 +52,23 @@ StringEntry lovrTextureFormat[] = {
   { 0 }
 };
 
+StringEntry lovrImageFilter[] = {
+  [IMAGE_FILTER_BOX] = ENTRY("box"),
+  [IMAGE_FILTER_KAISER] = ENTRY("kaiser"),
+  [IMAGE_FILTER_LANCZOS] = ENTRY("lanczos"),
+  { 0 }
+};
+
+StringEntry lovrImageOp[] = {
+  [IMAGE_OP_ADD] = ENTRY("add"),
+  [IMAGE_OP_SUBTRACT] = ENTRY("subtract"),
+  [IMAGE_OP_MULTIPLY] = ENTRY("multiply"),
+  [IMAGE_OP_MIN] = ENTRY("min"),
+  [IMAGE_OP_MAX] = ENTRY("max"),
+  [IMAGE_OP_BLEND] = ENTRY("blend"),
+  { 0 }
+};
+
 static int l_lovrImageGetBlob(lua_State* L) {
   Image* image = luax_checktype(L, 1, Image);
   Blob* blob = lovrImageGetBlob(image);
@@ -168,6 +185,118 @@ static int l_lovrImagePaste(lua_State* L) {
   return 0;
 }
 
+static void luax_checkrect(lua_State* L, int index, Image* image, uint32_t offset[2], uint32_t extent[2]) {
+  offset[0] = luax_optu32(L, index + 0, 0);
+  offset[1] = luax_optu32(L, index + 1, 0);
+  extent[0] = luax_optu32(L, index + 2, lovrImageGetWidth(image, 0) - MIN(offset[0], lovrImageGetWidth(image, 0)));
+  extent[1] = luax_optu32(L, index + 3, lovrImageGetHeight(image, 0) - MIN(offset[1], lovrImageGetHeight(image, 0)));
+}
+
+static int l_lovrImageFill(lua_State* L) {
+  Image* image = luax_checktype(L, 1, Image);
+  uint32_t offset[2], extent[2];
+  float color[4];
+  luax_optcolor(L, 2, color);
+  luax_checkrect(L, 3, image, offset, extent);
+  luax_assert(L, lovrImageFill(image, offset, extent, color));
+  return 0;
+}
+
+// Takes a 4x4 matrix or a 4x5 matrix where the last column is added to the result, row major
+static int l_lovrImageTransform(lua_State* L) {
+  Image* image = luax_checktype(L, 1, Image);
+  luaL_checktype(L, 2, LUA_TTABLE);
+  int length = luax_len(L, 2);
+  luax_check(L, length == 16 || length == 20, "Color matrix must have 16 or 20 numbers");
+  int columns = length / 4;
+  float matrix[16], bias[4] = { 0.f };
+  for (int i = 0; i < length; i++) {
+    lua_rawgeti(L, 2, i + 1);
+    float value = luax_checkfloat(L, -1);
+    lua_pop(L, 1);
+    if (i % columns == 4) {
+      bias[i / columns] = value;
+    } else {
+      matrix[(i / columns) * 4 + i % columns] = value;
+    }
+  }
+  uint32_t offset[2], extent[2];
+  luax_checkrect(L, 3, image, offset, extent);
+  luax_assert(L, lovrImageTransform(image, offset, extent, matrix, bias));
+  return 0;
+}
+
+// A swizzle is a color matrix with a single 1 in each row, or a constant in the bias
+static int l_lovrImageSwizzle(lua_State* L) {
+  Image* image = luax_checktype(L, 1, Image);
+  size_t length;
+  const char* swizzle = luaL_checklstring(L, 2, &length);
+  luax_check(L, length == 4, "Swizzle must have 4 characters");
+  float matrix[16] = { 0.f }, bias[4] = { 0.f };
+  for (uint32_t i = 0; i < 4; i++) {
+    switch (swizzle[i]) {
+      case 'r': matrix[4 * i + 0] = 1.f; break;
+      case 'g': matrix[4 * i + 1] = 1.f; break;
+      case 'b': matrix[4 * i + 2] = 1.f; break;
+      case 'a': matrix[4 * i + 3] = 1.f; break;
+      case '0': bias[i] = 0.f; break;
+      case '1': bias[i] = 1.f; break;
+      default: return luaL_error(L, "Invalid swizzle character '%c' (expected r, g, b, a, 0, or 1)", swizzle[i]);
+    }
+  }
+  uint32_t offset[2], extent[2];
+  luax_checkrect(L, 3, image, offset, extent);
+  luax_assert(L, lovrImageTransform(image, offset, extent, matrix, bias));
+  return 0;
+}
+
+static int l_lovrImageCombine(lua_State* L) {
+  Image* dst = luax_checktype(L, 1, Image);
+  Image* src = luax_checktype(L, 2, Image);
+  ImageOp op = luax_checkenum(L, 3, ImageOp, NULL);
+  uint32_t srcOffset[2], dstOffset[2], extent[2];
+  dstOffset[0] = luax_optu32(L, 4, 0);
+  dstOffset[1] = luax_optu32(L, 5, 0);
+  srcOffset[0] = luax_optu32(L, 6, 0);
+  srcOffset[1] = luax_optu32(L, 7, 0);
+  extent[0] = luax_optu32(L, 8, lovrImageGetWidth(src, 0));
+  extent[1] = luax_optu32(L, 9, lovrImageGetHeight(src, 0));
+  luax_assert(L, lovrImageCombine(dst, src, op, srcOffset, dstOffset, extent));
+  return 0;
+}
+
+static int l_lovrImageConvert(lua_State* L) {
+  Image* image = luax_checktype(L, 1, Image);
+  TextureFormat format = luax_checkenum(L, 2, TextureFormat, NULL);
+  Image* converted = lovrImageConvert(image, format);
+  luax_assert(L, converted);
+  luax_pushtype(L, Image, converted);
+  lovrRelease(converted, lovrImageDestroy);
+  return 1;
+}
+
+static int l_lovrImageResize(lua_State* L) {
+  Image* image = luax_checktype(L, 1, Image);
+  uint32_t width = luax_checku32(L, 2);
+  uint32_t height = luax_checku32(L, 3);
+  ImageFilter filter = luax_checkenum(L, 4, ImageFilter, "kaiser");
+  Image* resized = lovrImageResize(image, width, height, filter);
+  luax_assert(L, resized);
+  luax_pushtype(L, Image, resized);
+  lovrRelease(resized, lovrImageDestroy);
+  return 1;
+}
+
+static int l_lovrImageGenerateMipmaps(lua_State* L) {
+  Image* image = luax_checktype(L, 1, Image);
+  ImageFilter filter = luax_checkenum(L, 2, ImageFilter, "kaiser");
+  Image* mipmapped = lovrImageGenerateMipmaps(image, filter);
+  luax_assert(L, mipmapped);
+  luax_pushtype(L, Image, mipmapped);
+  lovrRelease(mipmapped, lovrImageDestroy);
+  return 1;
+}
+
 static int l_lovrImageEncode(lua_State* L) {
   Image* image = luax_checktype(L, 1, Image);
   Blob* blob = lovrImageEncode(image);
@@ -177,6 +306,16 @@ static int l_lovrImageEncode(lua_State* L) {
   return 1;
 }
 
+static int l_lovrImageCompress(lua_State* L) {
+  Image* image = luax_checktype(L, 1, Image);
+  TextureFormat format = luax_checkenum(L, 2, TextureFormat, "bc7");
+  Image* compressed = lovrImageCompress(image, format);
+  luax_assert(L, compressed);
+  luax_pushtype(L, Image, compressed);
+  lovrRelease(compressed, lovrImageDestroy);
+  return 1;
+}
+
 const luaL_Reg lovrImage[] = {
   { "getBlob", l_lovrImageGetBlob },
   { "getPointer", l_lovrImageGetPointer },
@@ -188,6 +327,14 @@ const luaL_Reg lovrImage[] = {
   { "setPixel", l_lovrImageSetPixel },
   { "mapPixel", l_lovrImageMapPixel },
   { "paste", l_lovrImagePaste },
+  { "fill", l_lovrImageFill },
+  { "transform", l_lovrImageTransform },
+  { "swizzle", l_lovrImageSwizzle },
+  { "combine", l_lovrImageCombine },
+  { "convert", l_lovrImageConvert },
+  { "resize", l_lovrImageResize },
+  { "generateMipmaps", l_lovrImageGenerateMipmaps },
   { "encode", l_lovrImageEncode },
+  { "compress", l_lovrImageCompress },
   { NULL, NULL }
 };
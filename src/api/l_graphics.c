@@ -320,6 +320,34 @@ static void luax_writeshadercache(void) {
   lovrFree(data);
 }
 
+static void luax_writepipelinecache(void) {
+  size_t size;
+  lovrGraphicsGetPipelineCache(NULL, &size);
+
+  if (size == 0) {
+    return;
+  }
+
+  void* data = lovrMalloc(size);
+  lovrGraphicsGetPipelineCache(data, &size);
+
+  if (size > 0) {
+    luax_writefile(".lovrpipelinecache", data, size);
+  }
+
+  lovrFree(data);
+}
+
+static void luax_writefontcache(void) {
+  size_t size;
+  void* data = lovrGraphicsGetFontCache(&size);
+
+  if (data) {
+    luax_writefile(".lovrfontcache", data, size);
+    lovrFree(data);
+  }
+}
+
 static int l_lovrGraphicsInitialize(lua_State* L) {
   GraphicsConfig config = {
     .debug = false,
@@ -357,15 +385,21 @@ static int l_lovrGraphicsInitialize(lua_State* L) {
 
   if (shaderCache) {
     config.cacheData = luax_readfile(".lovrshadercache", &config.cacheSize);
+    config.pipelineData = luax_readfile(".lovrpipelinecache", &config.pipelineSize);
+    config.fontCacheData = luax_readfile(".lovrfontcache", &config.fontCacheSize);
   }
 
   bool success = lovrGraphicsInit(&config);
   lovrFree(config.cacheData);
+  lovrFree(config.pipelineData);
+  lovrFree(config.fontCacheData);
   luax_assert(L, success);
   luax_atexit(L, lovrGraphicsDestroy);
 
   if (shaderCache) { // Finalizers run in the opposite order they were added, so this has to go last
     luax_atexit(L, luax_writeshadercache);
+    luax_atexit(L, luax_writepipelinecache);
+    luax_atexit(L, luax_writefontcache);
   }
 
   return 0;
@@ -518,6 +552,41 @@ static int l_lovrGraphicsGetLimits(lua_State* L) {
   return 1;
 }
 
+static int l_lovrGraphicsGetMemoryStats(lua_State* L) {
+  GraphicsHeap heaps[16];
+  uint32_t count = lovrGraphicsGetHeaps(heaps, COUNTOF(heaps));
+
+  lua_newtable(L);
+  lua_createtable(L, (int) count, 0);
+  for (uint32_t i = 0; i < count; i++) {
+    lua_createtable(L, 0, 7);
+    lua_pushnumber(L, (double) heaps[i].size), lua_setfield(L, -2, "size");
+    lua_pushnumber(L, (double) heaps[i].allocated), lua_setfield(L, -2, "allocated");
+    lua_pushnumber(L, (double) heaps[i].used), lua_setfield(L, -2, "used");
+    lua_pushnumber(L, (double) heaps[i].largestFree), lua_setfield(L, -2, "largestFree");
+    lua_pushinteger(L, heaps[i].blocks), lua_setfield(L, -2, "blocks");
+    lua_pushinteger(L, heaps[i].allocations), lua_setfield(L, -2, "allocations");
+    lua_pushboolean(L, heaps[i].deviceLocal), lua_setfield(L, -2, "deviceLocal");
+    lua_rawseti(L, -2, i + 1);
+  }
+  lua_setfield(L, -2, "heaps");
+
+  GraphicsBufferPool pools[BUFFER_POOL_COUNT];
+  lovrGraphicsGetBufferPools(pools);
+  const char* names[] = { "static", "stream", "upload", "download" };
+  lua_createtable(L, 0, BUFFER_POOL_COUNT);
+  for (uint32_t i = 0; i < BUFFER_POOL_COUNT; i++) {
+    lua_createtable(L, 0, 4);
+    lua_pushinteger(L, pools[i].blocks), lua_setfield(L, -2, "blocks");
+    lua_pushnumber(L, (double) pools[i].memory), lua_setfield(L, -2, "memory");
+    lua_pushnumber(L, (double) pools[i].active), lua_setfield(L, -2, "active");
+    lua_pushnumber(L, (double) pools[i].peak), lua_setfield(L, -2, "peak");
+    lua_setfield(L, -2, names[i]);
+  }
+  lua_setfield(L, -2, "buffers");
+  return 1;
+}
+
 static int l_lovrGraphicsIsFormatSupported(lua_State* L) {
   TextureFormat format = luax_checkenum(L, 1, TextureFormat, NULL);
   uint32_t features = 0;
@@ -801,19 +870,21 @@ static int l_lovrGraphicsNewTexture(lua_State* L) {
           lua_rawget(L, 1);
         }
         luax_check(L, !lua_isnil(L, -1), "No array texture layers given and cubemap face '%s' missing", faces[i]);
-        images[i] = luax_checkimage(L, -1);
       }
+      luax_checkimages(L, 6, images);
+      lua_pop(L, 6);
     } else {
+      luaL_checkstack(L, (int) info.imageCount, "Too many texture layers");
       for (uint32_t i = 0; i < info.imageCount; i++) {
         lua_rawgeti(L, 1, (int) i + 1);
-        images[i] = luax_checkimage(L, -1);
-        lua_pop(L, 1);
       }
+      luax_checkimages(L, (int) info.imageCount, images);
+      lua_pop(L, (int) info.imageCount);
 
       info.type = info.imageCount == 6 ? TEXTURE_CUBE : TEXTURE_ARRAY;
       info.layers = info.imageCount == 1 ? lovrImageGetLayerCount(images[0]) : info.imageCount;
     }
-  } else {
+  } else if (luax_totype(L, index, Image)) {
     info.imageCount = 1;
     info.images = images;
     images[0] = luax_checkimage(L, index++);
@@ -823,6 +894,37 @@ static int l_lovrGraphicsNewTexture(lua_State* L) {
     } else if (info.layers > 1) {
       info.type = TEXTURE_ARRAY;
     }
+  } else {
+    // PNG/JPG/HDR files get decoded right into the upload buffer, other files become an Image
+    ImageFileInfo file;
+    Blob* blob = luax_readblob(L, index++, "Texture");
+
+    if (!lovrImageGetFileInfo(blob, false, &file)) {
+      lovrRelease(blob, lovrBlobDestroy);
+      luax_assert(L, false);
+    }
+
+    if (file.width > 0) {
+      info.file = blob;
+      info.format = file.format;
+      info.srgb = file.srgb;
+      info.width = file.width;
+      info.height = file.height;
+      bool mipmappable = lovrGraphicsGetFormatSupport(info.format, TEXTURE_FEATURE_BLIT) & (1 << info.srgb);
+      info.mipmaps = mipmappable ? ~0u : 1;
+    } else {
+      info.imageCount = 1;
+      info.images = images;
+      images[0] = lovrImageCreateFromFile(blob);
+      lovrRelease(blob, lovrBlobDestroy);
+      luax_assert(L, images[0]);
+      info.layers = lovrImageGetLayerCount(images[0]);
+      if (lovrImageIsCube(images[0])) {
+        info.type = TEXTURE_CUBE;
+      } else if (info.layers > 1) {
+        info.type = TEXTURE_ARRAY;
+      }
+    }
   }
 
   if (info.imageCount > 0) {
@@ -849,7 +951,7 @@ static int l_lovrGraphicsNewTexture(lua_State* L) {
     info.type = lua_isnil(L, -1) ? info.type : (uint32_t) luax_checkenum(L, -1, TextureType, NULL);
     lua_pop(L, 1);
 
-    if (info.imageCount == 0) {
+    if (info.imageCount == 0 && !info.file) {
       lua_getfield(L, index, "format");
       info.format = lua_isnil(L, -1) ? info.format : (uint32_t) luax_checkenum(L, -1, TextureFormat, NULL);
       lua_pop(L, 1);
@@ -870,9 +972,9 @@ static int l_lovrGraphicsNewTexture(lua_State* L) {
     } else if (!lua_isnil(L, -1)) {
       info.mipmaps = lua_toboolean(L, -1) ? ~0u : 1;
     } else {
-      info.mipmaps = (info.samples > 1 || info.imageCount == 0 || !mipmappable) ? 1 : ~0u;
+      info.mipmaps = (info.samples > 1 || (info.imageCount == 0 && !info.file) || !mipmappable) ? 1 : ~0u;
     }
-    if (info.imageCount > 0 && info.mipmaps > 1 && !mipmappable) {
+    if ((info.imageCount > 0 || info.file) && info.mipmaps > 1 && !mipmappable) {
       luaL_error(L, "This texture format does not support blitting, which is required for mipmap generation");
     }
     lua_pop(L, 1);
@@ -909,6 +1011,8 @@ static int l_lovrGraphicsNewTexture(lua_State* L) {
     lovrRelease(images[i], lovrImageDestroy);
   }
 
+  lovrRelease(info.file, lovrBlobDestroy);
+
   if (images != stack) {
     lovrFree(images);
   }
@@ -1540,6 +1644,7 @@ static const luaL_Reg lovrGraphics[] = {
   { "getDevice", l_lovrGraphicsGetDevice },
   { "getFeatures", l_lovrGraphicsGetFeatures },
   { "getLimits", l_lovrGraphicsGetLimits },
+  { "getMemoryStats", l_lovrGraphicsGetMemoryStats },
   { "isFormatSupported", l_lovrGraphicsIsFormatSupported },
   { "getBackgroundColor", l_lovrGraphicsGetBackgroundColor },
   { "setBackgroundColor", l_lovrGraphicsSetBackgroundColor },
@@ -1,5 +1,6 @@
 #include "api.h"
 #include "graphics/graphics.h"
+#include "data/blob.h"
 #include "data/rasterizer.h"
 #include "util.h"
 #include <stdlib.h>
@@ -171,6 +172,58 @@ static int l_lovrFontGetVertices(lua_State* L) {
   return 2;
 }
 
+static int l_lovrFontPrewarm(lua_State* L) {
+  Font* font = luax_checktype(L, 1, Font);
+  uint32_t* codepoints;
+  uint32_t count = 0;
+
+  if (lua_type(L, 2) == LUA_TSTRING) {
+    size_t length, bytes;
+    const char* str = lua_tolstring(L, 2, &length);
+    const char* end = str + length;
+    codepoints = lovrMalloc(MAX(length, 1) * sizeof(uint32_t));
+    while ((bytes = utf8_decode(str, end, &codepoints[count])) > 0) {
+      str += bytes;
+      count++;
+    }
+  } else {
+    uint32_t first = luax_checku32(L, 2);
+    uint32_t last = luax_optu32(L, 3, first);
+    luax_check(L, last >= first, "Last codepoint must not be less than the first one");
+    luax_check(L, last - first < 65536, "Too many codepoints to prewarm (max is 65536)");
+    count = last - first + 1;
+    codepoints = lovrMalloc(count * sizeof(uint32_t));
+    for (uint32_t i = 0; i < count; i++) {
+      codepoints[i] = first + i;
+    }
+  }
+
+  bool success = lovrFontPrewarm(font, codepoints, count);
+  lovrFree(codepoints);
+  luax_assert(L, success);
+  return 0;
+}
+
+static int l_lovrFontGetCache(lua_State* L) {
+  Font* font = luax_checktype(L, 1, Font);
+  size_t size;
+  void* data = lovrFontGetCache(font, &size);
+  luax_assert(L, data);
+  Blob* blob = lovrBlobCreate(data, size, "Font cache");
+  luax_pushtype(L, Blob, blob);
+  lovrRelease(blob, lovrBlobDestroy);
+  return 1;
+}
+
+static int l_lovrFontLoadCache(lua_State* L) {
+  Font* font = luax_checktype(L, 1, Font);
+  Blob* blob = luax_checktype(L, 2, Blob);
+  bool loaded;
+  luax_assert(L, lovrFontLoadCache(font, blob->data, blob->size, &loaded));
+  lua_pushboolean(L, loaded);
+  return 1;
+}
+
 const luaL_Reg lovrFont[] = {
   { "getRasterizer", l_lovrFontGetRasterizer },
   { "getPixelDensity", l_lovrFontGetPixelDensity },
@@ -184,5 +237,8 @@ const luaL_Reg lovrFont[] = {
   { "getWidth", l_lovrFontGetWidth },
   { "getLines", l_lovrFontGetLines },
   { "getVertices", l_lovrFontGetVertices },
+  { "prewarm", l_lovrFontPrewarm },
+  { "getCache", l_lovrFontGetCache },
+  { "loadCache", l_lovrFontLoadCache },
   { NULL, NULL }
 };
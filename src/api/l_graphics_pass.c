@@ -9,7 +9,16 @@
 
 static int l_lovrPassReset(lua_State* L) {
   Pass* pass = luax_checktype(L, 1, Pass);
-  lovrPassReset(pass);
+  luax_assert(L, lovrPassReset(pass));
+  return 1;
+}
+
+static int l_lovrPassFork(lua_State* L) {
+  Pass* pass = luax_checktype(L, 1, Pass);
+  Pass* fork = lovrPassFork(pass);
+  luax_assert(L, fork);
+  luax_pushtype(L, Pass, fork);
+  lovrRelease(fork, lovrPassDestroy);
   return 1;
 }
 
@@ -20,6 +29,8 @@ static int l_lovrPassGetStats(lua_State* L) {
   lua_pushinteger(L, stats->draws), lua_setfield(L, -2, "draws");
   lua_pushinteger(L, stats->computes), lua_setfield(L, -2, "computes");
   lua_pushinteger(L, stats->drawsCulled), lua_setfield(L, -2, "drawsCulled");
+  lua_pushinteger(L, stats->drawsBatched), lua_setfield(L, -2, "drawsBatched");
+  lua_pushinteger(L, stats->stateChangesSaved), lua_setfield(L, -2, "stateChangesSaved");
   lua_pushinteger(L, stats->cpuMemoryReserved), lua_setfield(L, -2, "cpuMemoryReserved");
   lua_pushinteger(L, stats->cpuMemoryUsed), lua_setfield(L, -2, "cpuMemoryUsed");
   lua_pushnumber(L, stats->submitTime), lua_setfield(L, -2, "submitTime");
@@ -619,6 +630,19 @@ static int l_lovrPassSetStencilWrite(lua_State* L) {
   return 0;
 }
 
+static int l_lovrPassIsSorting(lua_State* L) {
+  Pass* pass = luax_checktype(L, 1, Pass);
+  lua_pushboolean(L, lovrPassIsSorting(pass));
+  return 1;
+}
+
+static int l_lovrPassSetSorting(lua_State* L) {
+  Pass* pass = luax_checktype(L, 1, Pass);
+  bool enable = lua_toboolean(L, 2);
+  lovrPassSetSorting(pass, enable);
+  return 0;
+}
+
 static int l_lovrPassSetViewCull(lua_State* L) {
   Pass* pass = luax_checktype(L, 1, Pass);
   bool enable = lua_toboolean(L, 2);
@@ -1093,6 +1117,7 @@ static int l_lovrPassToString(lua_State* L) {
 
 const luaL_Reg lovrPass[] = {
   { "reset", l_lovrPassReset },
+  { "fork", l_lovrPassFork },
   { "getStats", l_lovrPassGetStats },
   { "getLabel", l_lovrPassGetLabel },
 
@@ -1136,6 +1161,8 @@ const luaL_Reg lovrPass[] = {
   { "setStencilTest", l_lovrPassSetStencilTest },
   { "setStencilWrite", l_lovrPassSetStencilWrite },
   { "setViewCull", l_lovrPassSetViewCull },
+  { "isSorting", l_lovrPassIsSorting },
+  { "setSorting", l_lovrPassSetSorting },
   { "setViewport", l_lovrPassSetViewport },
   { "setWinding", l_lovrPassSetWinding },
   { "setWireframe", l_lovrPassSetWireframe },
@@ -31,6 +31,16 @@ StringEntry lovrMotorMode[] = {
   { 0 }
 };
 
+static void luax_writeshapecache(void) {
+  size_t size;
+  void* data = lovrPhysicsGetShapeCache(&size);
+
+  if (data) {
+    luax_writefile(".lovrshapecache", data, size);
+    lovrFree(data);
+  }
+}
+
 static int l_lovrPhysicsNewWorld(lua_State* L) {
   WorldInfo info = {
     .maxColliders = 16384,
@@ -40,7 +50,10 @@ static int l_lovrPhysicsNewWorld(lua_State* L) {
     .maxOverlap = .01f,
     .restitutionThreshold = 1.f,
     .velocitySteps = 10,
-    .positionSteps = 2
+    .positionSteps = 2,
+    .collisionSteps = 1,
+    .timestep = 0.f,
+    .maxSteps = 8
   };
 
   if (lua_istable(L, 1)) {
@@ -76,6 +89,18 @@ static int l_lovrPhysicsNewWorld(lua_State* L) {
     if (!lua_isnil(L, -1)) info.positionSteps = luax_checku32(L, -1);
     lua_pop(L, 1);
 
+    lua_getfield(L, 1, "collisionSteps");
+    if (!lua_isnil(L, -1)) info.collisionSteps = luax_checku32(L, -1);
+    lua_pop(L, 1);
+
+    lua_getfield(L, 1, "timestep");
+    if (!lua_isnil(L, -1)) info.timestep = luax_checkfloat(L, -1);
+    lua_pop(L, 1);
+
+    lua_getfield(L, 1, "maxSteps");
+    if (!lua_isnil(L, -1)) info.maxSteps = luax_checku32(L, -1);
+    lua_pop(L, 1);
+
     lua_getfield(L, 1, "tags");
     if (!lua_isnil(L, -1)) {
       luax_check(L, lua_istable(L, -1), "World tag list should be a table");
@@ -371,7 +396,29 @@ int luaopen_lovr_physics(lua_State* L) {
   luax_registertype(L, DistanceJoint);
   luax_registertype(L, HingeJoint);
   luax_registertype(L, SliderJoint);
-  lovrPhysicsInit(luax_unref);
+
+  bool shapeCache = false;
+
+  luax_pushconf(L);
+  if (lua_istable(L, -1)) {
+    lua_getfield(L, -1, "physics");
+    if (lua_istable(L, -1)) {
+      lua_getfield(L, -1, "shapecache");
+      shapeCache = lua_toboolean(L, -1);
+      lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+  }
+  lua_pop(L, 1);
+
+  size_t cacheSize = 0;
+  void* cacheData = shapeCache ? luax_readfile(".lovrshapecache", &cacheSize) : NULL;
+  lovrPhysicsInit(luax_unref, cacheData, cacheSize);
+  lovrFree(cacheData);
   luax_atexit(L, lovrPhysicsDestroy);
+
+  if (shapeCache) { // Finalizers run in the opposite order they were added, so this has to go last
+    luax_atexit(L, luax_writeshapecache);
+  }
   return 1;
 }
@@ -1,5 +1,6 @@
 #include "api.h"
 #include "physics/physics.h"
+#include "data/blob.h"
 #include "data/image.h"
 #include "core/maf.h"
 #include "util.h"
@@ -93,6 +94,15 @@ Shape* luax_newconvexshape(lua_State* L, int index) {
     return lovrConvexShapeClone(parent, scale);
   }
 
+  Blob* blob = luax_totype(L, index, Blob);
+
+  if (blob) {
+    float scale = luax_optfloat(L, index + 1, 1.f);
+    ConvexShape* shape = lovrConvexShapeDeserialize(blob->data, blob->size, scale);
+    luax_assert(L, shape);
+    return shape;
+  }
+
   float* points;
   uint32_t count;
   bool shouldFree;
@@ -112,6 +122,15 @@ Shape* luax_newmeshshape(lua_State* L, int index) {
     return lovrMeshShapeClone(parent, scale);
   }
 
+  Blob* blob = luax_totype(L, index, Blob);
+
+  if (blob) {
+    float scale = luax_optfloat(L, index + 1, 1.f);
+    MeshShape* shape = lovrMeshShapeDeserialize(blob->data, blob->size, scale);
+    luax_assert(L, shape);
+    return shape;
+  }
+
   float* vertices;
   uint32_t* indices;
   uint32_t vertexCount;
@@ -381,6 +400,17 @@ static int l_lovrShapeRaycast(lua_State* L) {
   return 0;
 }
 
+static int l_lovrShapeSerialize(lua_State* L) {
+  Shape* shape = luax_checkshape(L, 1);
+  size_t size;
+  void* data = lovrShapeSerialize(shape, &size);
+  luax_assert(L, data);
+  Blob* blob = lovrBlobCreate(data, size, "Shape data");
+  luax_pushtype(L, Blob, blob);
+  lovrRelease(blob, lovrBlobDestroy);
+  return 1;
+}
+
 #define lovrShape \
   { "destroy", l_lovrShapeDestroy }, \
   { "isDestroyed", l_lovrShapeIsDestroyed }, \
@@ -576,6 +606,7 @@ const luaL_Reg lovrConvexShape[] = {
   { "getFaceCount", l_lovrConvexShapeGetFaceCount },
   { "getFace", l_lovrConvexShapeGetFace },
   { "getScale", l_lovrConvexShapeGetScale },
+  { "serialize", l_lovrShapeSerialize },
   { NULL, NULL }
 };
 
@@ -589,6 +620,7 @@ static int l_lovrMeshShapeGetScale(lua_State* L) {
 const luaL_Reg lovrMeshShape[] = {
   lovrShape,
   { "getScale", l_lovrMeshShapeGetScale },
+  { "serialize", l_lovrShapeSerialize },
   { NULL, NULL }
 };
 
@@ -1,5 +1,6 @@
 #include "api.h"
 #include "physics/physics.h"
+#include "data/blob.h"
 #include "core/maf.h"
 #include "util.h"
 #include <float.h>
@@ -327,11 +328,12 @@ static int l_lovrWorldUpdate(lua_State* L) {
   World* world = luax_checkworld(L, 1);
   float dt = luax_checkfloat(L, 2);
   lua_settop(L, 2);
-  lovrWorldUpdate(world, dt);
+  uint32_t steps = lovrWorldUpdate(world, dt);
   if (lua_type(L, 3) == LUA_TSTRING) {
     lua_error(L);
   }
-  return 0;
+  lua_pushinteger(L, steps);
+  return 1;
 }
 
 static int l_lovrWorldInterpolate(lua_State* L) {
@@ -341,6 +343,129 @@ static int l_lovrWorldInterpolate(lua_State* L) {
   return 0;
 }
 
+// Colliders are given as a table, or nil for every Collider in the World (in getColliders order)
+static Collider** luax_checkcolliderlist(lua_State* L, int index, World* world, uint32_t* count) {
+  Collider* collider = NULL;
+
+  if (lua_isnoneornil(L, index)) {
+    *count = 0;
+    while ((collider = lovrWorldGetColliders(world, collider)) != NULL) {
+      (*count)++;
+    }
+
+    Collider** colliders = lovrMalloc(MAX(*count, 1) * sizeof(Collider*));
+    for (uint32_t i = 0; (collider = lovrWorldGetColliders(world, collider)) != NULL; i++) {
+      colliders[i] = collider;
+    }
+    return colliders;
+  }
+
+  luaL_checktype(L, index, LUA_TTABLE);
+  *count = luax_len(L, index);
+
+  for (uint32_t i = 0; i < *count; i++) {
+    lua_rawgeti(L, index, (int) i + 1);
+    collider = luax_checktype(L, -1, Collider);
+    luax_check(L, !lovrColliderIsDestroyed(collider), "Attempt to use a destroyed Collider");
+    luax_check(L, lovrColliderGetWorld(collider) == world, "Collider %d belongs to a different World", i + 1);
+    lua_pop(L, 1);
+  }
+
+  Collider** colliders = lovrMalloc(MAX(*count, 1) * sizeof(Collider*));
+  for (uint32_t i = 0; i < *count; i++) {
+    lua_rawgeti(L, index, (int) i + 1);
+    colliders[i] = luax_totype(L, -1, Collider);
+    lua_pop(L, 1);
+  }
+  return colliders;
+}
+
+static int l_lovrWorldGetPoses(lua_State* L) {
+  World* world = luax_checkworld(L, 1);
+  Blob* blob = lua_isnoneornil(L, 3) ? NULL : luax_checktype(L, 3, Blob);
+  size_t offset = luaL_optinteger(L, 4, 0);
+  uint32_t count;
+  Collider** colliders = luax_checkcolliderlist(L, 2, world, &count);
+  size_t size = count * 7 * sizeof(float);
+
+  if (blob) {
+    if (offset > blob->size || size > blob->size - offset) {
+      lovrFree(colliders);
+      return luaL_error(L, "Blob is too small to hold %d poses at offset %d", count, (int) offset);
+    }
+    lua_pushvalue(L, 3);
+  } else {
+    blob = lovrBlobCreate(lovrMalloc(MAX(size, 1)), size, "Poses");
+    luax_pushtype(L, Blob, blob);
+    lovrRelease(blob, lovrBlobDestroy);
+    offset = 0;
+  }
+
+  lovrWorldGetPoses(world, colliders, count, (float*) ((char*) blob->data + offset));
+  lovrFree(colliders);
+  lua_pushinteger(L, count);
+  return 2;
+}
+
+static int l_lovrWorldSetPoses(lua_State* L) {
+  World* world = luax_checkworld(L, 1);
+  Blob* blob = luax_checktype(L, 3, Blob);
+  size_t offset = luaL_optinteger(L, 4, 0);
+  uint32_t count;
+  Collider** colliders = luax_checkcolliderlist(L, 2, world, &count);
+  size_t size = count * 7 * sizeof(float);
+  if (offset > blob->size || size > blob->size - offset) {
+    lovrFree(colliders);
+    return luaL_error(L, "Blob is too small to hold %d poses at offset %d", count, (int) offset);
+  }
+  bool success = lovrWorldSetPoses(world, colliders, count, (float*) ((char*) blob->data + offset));
+  lovrFree(colliders);
+  luax_assert(L, success);
+  return 0;
+}
+
+static int l_lovrWorldMoveKinematic(lua_State* L) {
+  World* world = luax_checkworld(L, 1);
+  Blob* blob = luax_checktype(L, 3, Blob);
+  float dt = luax_checkfloat(L, 4);
+  size_t offset = luaL_optinteger(L, 5, 0);
+  luax_check(L, dt > 0.f, "dt must > 0");
+  uint32_t count;
+  Collider** colliders = luax_checkcolliderlist(L, 2, world, &count);
+  size_t size = count * 7 * sizeof(float);
+  if (offset > blob->size || size > blob->size - offset) {
+    lovrFree(colliders);
+    return luaL_error(L, "Blob is too small to hold %d poses at offset %d", count, (int) offset);
+  }
+  bool success = lovrWorldMoveKinematic(world, colliders, count, (float*) ((char*) blob->data + offset), dt);
+  lovrFree(colliders);
+  luax_assert(L, success);
+  return 0;
+}
+
+static int l_lovrWorldSaveState(lua_State* L) {
+  World* world = luax_checkworld(L, 1);
+  Blob* blob = luax_totype(L, 2, Blob);
+  size_t size = blob ? blob->size : 0;
+  void* data = lovrWorldSaveState(world, blob ? blob->data : NULL, &size);
+  luax_assert(L, data);
+  if (blob && data == blob->data) {
+    lua_settop(L, 2);
+  } else {
+    blob = lovrBlobCreate(data, size, "World state");
+    luax_pushtype(L, Blob, blob);
+    lovrRelease(blob, lovrBlobDestroy);
+  }
+  return 1;
+}
+
+static int l_lovrWorldRestoreState(lua_State* L) {
+  World* world = luax_checkworld(L, 1);
+  Blob* blob = luax_checktype(L, 2, Blob);
+  luax_assert(L, lovrWorldRestoreState(world, blob->data, blob->size));
+  return 0;
+}
+
 static uint32_t luax_checktagmask(lua_State* L, int index, World* world) {
   if (lua_isnoneornil(L, index)) {
     return ~0u;
@@ -395,6 +520,115 @@ static int l_lovrWorldShapecast(lua_State* L) {
   return 0;
 }
 
+// Batch results are written to a flat table, 9 values per query:
+// collider, shape, x, y, z, nx, ny, nz, fraction (or 9 falses for a miss)
+static int luax_pushcastresults(lua_State* L, int index, CastResult* hits, uint32_t count, uint32_t hitCount) {
+  if (lua_istable(L, index)) {
+    lua_pushvalue(L, index);
+  } else {
+    lua_createtable(L, (int) count * 9, 0);
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    CastResult* hit = &hits[i];
+    int base = (int) i * 9;
+    if (hit->collider) {
+      luax_pushtype(L, Collider, hit->collider);
+      lua_rawseti(L, -2, base + 1);
+      luax_pushshape(L, hit->shape);
+      lua_rawseti(L, -2, base + 2);
+      float values[7] = {
+        hit->position[0], hit->position[1], hit->position[2],
+        hit->normal[0], hit->normal[1], hit->normal[2],
+        hit->fraction
+      };
+      for (int k = 0; k < 7; k++) {
+        lua_pushnumber(L, values[k]);
+        lua_rawseti(L, -2, base + 3 + k);
+      }
+    } else {
+      for (int k = 1; k <= 9; k++) {
+        lua_pushboolean(L, false);
+        lua_rawseti(L, -2, base + k);
+      }
+    }
+  }
+
+  lua_pushinteger(L, hitCount);
+  return 2;
+}
+
+static int l_lovrWorldRaycastBatch(lua_State* L) {
+  World* world = luax_checkworld(L, 1);
+  luaL_checktype(L, 2, LUA_TTABLE);
+  uint32_t filter = luax_checktagmask(L, 3, world);
+  int length = luax_len(L, 2);
+  luax_check(L, length % 6 == 0, "Ray table length must be a multiple of 6");
+  uint32_t count = length / 6;
+
+  if (count == 0) {
+    return luax_pushcastresults(L, 4, NULL, 0, 0);
+  }
+
+  Raycast* rays = lovrMalloc(count * sizeof(Raycast));
+  CastResult* hits = lovrMalloc(count * sizeof(CastResult));
+
+  for (uint32_t i = 0; i < count; i++) {
+    float v[6];
+    for (int j = 0; j < 6; j++) {
+      lua_rawgeti(L, 2, (int) i * 6 + j + 1);
+      v[j] = luax_tofloat(L, -1);
+      lua_pop(L, 1);
+    }
+    vec3_init(rays[i].start, v);
+    vec3_init(rays[i].end, v + 3);
+    rays[i].filter = filter;
+  }
+
+  uint32_t hitCount = lovrWorldRaycastBatch(world, rays, count, hits);
+  int n = luax_pushcastresults(L, 4, hits, count, hitCount);
+  lovrFree(rays);
+  lovrFree(hits);
+  return n;
+}
+
+static int l_lovrWorldShapecastBatch(lua_State* L) {
+  World* world = luax_checkworld(L, 1);
+  Shape* shape = luax_checkshape(L, 2);
+  luaL_checktype(L, 3, LUA_TTABLE);
+  uint32_t filter = luax_checktagmask(L, 4, world);
+  int length = luax_len(L, 3);
+  luax_check(L, length % 10 == 0, "Shapecast table length must be a multiple of 10");
+  uint32_t count = length / 10;
+
+  if (count == 0) {
+    return luax_pushcastresults(L, 5, NULL, 0, 0);
+  }
+
+  Shapecast* casts = lovrMalloc(count * sizeof(Shapecast));
+  CastResult* hits = lovrMalloc(count * sizeof(CastResult));
+
+  for (uint32_t i = 0; i < count; i++) {
+    float v[10];
+    for (int j = 0; j < 10; j++) {
+      lua_rawgeti(L, 3, (int) i * 10 + j + 1);
+      v[j] = luax_tofloat(L, -1);
+      lua_pop(L, 1);
+    }
+    casts[i].shape = shape;
+    vec3_init(casts[i].pose, v);
+    vec3_init(casts[i].end, v + 3);
+    quat_fromAngleAxis(casts[i].pose + 3, v[6], v[7], v[8], v[9]);
+    casts[i].filter = filter;
+  }
+
+  uint32_t hitCount = lovrWorldShapecastBatch(world, casts, count, hits);
+  int n = luax_pushcastresults(L, 5, hits, count, hitCount);
+  lovrFree(casts);
+  lovrFree(hits);
+  return n;
+}
+
 static int l_lovrWorldOverlapShape(lua_State* L) {
   World* world = luax_checkworld(L, 1);
   int index;
@@ -674,8 +908,15 @@ const luaL_Reg lovrWorld[] = {
   { "getJoints", l_lovrWorldGetJoints },
   { "update", l_lovrWorldUpdate },
   { "interpolate", l_lovrWorldInterpolate },
+  { "getPoses", l_lovrWorldGetPoses },
+  { "setPoses", l_lovrWorldSetPoses },
+  { "moveKinematic", l_lovrWorldMoveKinematic },
+  { "saveState", l_lovrWorldSaveState },
+  { "restoreState", l_lovrWorldRestoreState },
   { "raycast", l_lovrWorldRaycast },
   { "shapecast", l_lovrWorldShapecast },
+  { "raycastBatch", l_lovrWorldRaycastBatch },
+  { "shapecastBatch", l_lovrWorldShapecastBatch },
   { "overlapShape", l_lovrWorldOverlapShape },
   { "queryBox", l_lovrWorldQueryBox },
   { "querySphere", l_lovrWorldQuerySphere },
@@ -67,7 +67,9 @@ static int l_lovrThreadNewThread(lua_State* L) {
 }
 
 static int l_lovrThreadNewChannel(lua_State* L) {
-  Channel* channel = lovrChannelCreate(0);
+  uint32_t capacity = luax_optu32(L, 1, 0);
+  Channel* channel = lovrChannelCreate(0, capacity);
+  luax_assert(L, channel);
   luax_pushtype(L, Channel, channel);
   lovrRelease(channel, lovrChannelDestroy);
   return 1;
@@ -26,12 +26,58 @@ static int l_lovrChannelPush(lua_State* L) {
   luax_checkvariant(L, 2, &variant);
   luax_checktimeout(L, 3, &timeout);
   uint64_t id;
-  bool read = lovrChannelPush(channel, &variant, timeout, &id);
+  bool read;
+  bool pushed = lovrChannelPush(channel, &variant, timeout, &id, &read);
+  if (!pushed) lovrVariantDestroy(&variant);
   lua_pushnumber(L, id);
   lua_pushboolean(L, read);
   return 2;
 }
 
+static int checkVariantProtected(lua_State* L) {
+  luax_checkvariant(L, 1, lua_touserdata(L, 2));
+  return 0;
+}
+
+static int l_lovrChannelPushBatch(lua_State* L) {
+  Variant variants[64];
+  Channel* channel = luax_checktype(L, 1, Channel);
+  luaL_checktype(L, 2, LUA_TTABLE);
+  uint32_t length = luax_len(L, 2);
+  uint32_t total = 0;
+
+  for (uint32_t i = 0; i < length;) {
+    uint32_t count = MIN(length - i, COUNTOF(variants));
+
+    // Variants are converted in protected mode so the ones already converted can be destroyed
+    for (uint32_t j = 0; j < count; j++) {
+      lua_pushcfunction(L, checkVariantProtected);
+      lua_rawgeti(L, 2, i + j + 1);
+      lua_pushlightuserdata(L, &variants[j]);
+      if (lua_pcall(L, 2, 0, 0)) {
+        for (uint32_t k = 0; k < j; k++) {
+          lovrVariantDestroy(&variants[k]);
+        }
+        return lua_error(L);
+      }
+    }
+
+    uint32_t pushed = lovrChannelPushBatch(channel, variants, count);
+    total += pushed;
+    i += count;
+
+    if (pushed < count) {
+      for (uint32_t j = pushed; j < count; j++) {
+        lovrVariantDestroy(&variants[j]);
+      }
+      break;
+    }
+  }
+
+  lua_pushinteger(L, total);
+  return 1;
+}
+
 static int l_lovrChannelPop(lua_State* L) {
   Variant variant;
   double timeout;
@@ -46,6 +92,41 @@ static int l_lovrChannelPop(lua_State* L) {
   return 1;
 }
 
+static int l_lovrChannelPopBatch(lua_State* L) {
+  Variant variants[64];
+  Channel* channel = luax_checktype(L, 1, Channel);
+  uint32_t limit = luax_optu32(L, 2, ~0u);
+  uint32_t total = 0;
+
+  while (total < limit) {
+    uint32_t chunk = MIN(limit - total, COUNTOF(variants));
+
+    // Stop once the stack is full, leaving the rest of the messages in the Channel
+    if (!lua_checkstack(L, chunk + LUA_MINSTACK)) break;
+
+    uint32_t count = lovrChannelPopBatch(channel, variants, chunk);
+    for (uint32_t i = 0; i < count; i++) {
+      luax_pushvariant(L, &variants[i]);
+      lovrVariantDestroy(&variants[i]);
+    }
+    total += count;
+    if (count < chunk) break;
+  }
+
+  return total;
+}
+
+static int l_lovrChannelGetCapacity(lua_State* L) {
+  Channel* channel = luax_checktype(L, 1, Channel);
+  uint32_t capacity = lovrChannelGetCapacity(channel);
+  if (capacity > 0) {
+    lua_pushinteger(L, capacity);
+  } else {
+    lua_pushnil(L);
+  }
+  return 1;
+}
+
 static int l_lovrChannelPeek(lua_State* L) {
   Variant variant;
   Channel* channel = luax_checktype(L, 1, Channel);
@@ -81,9 +162,12 @@ static int l_lovrChannelHasRead(lua_State* L) {
 const luaL_Reg lovrChannel[] = {
   { "push", l_lovrChannelPush },
   { "pop", l_lovrChannelPop },
+  { "pushBatch", l_lovrChannelPushBatch },
+  { "popBatch", l_lovrChannelPopBatch },
   { "peek", l_lovrChannelPeek },
   { "clear", l_lovrChannelClear },
   { "getCount", l_lovrChannelGetCount },
+  { "getCapacity", l_lovrChannelGetCapacity },
   { "hasRead", l_lovrChannelHasRead },
   { NULL, NULL }
 };
@@ -757,9 +757,20 @@ typedef struct {
   } vk;
 } gpu_config;
 
+typedef struct {
+  uint64_t size;
+  uint64_t allocated;
+  uint64_t used;
+  uint64_t largestFree;
+  uint32_t blocks;
+  uint32_t allocations;
+  bool deviceLocal;
+} gpu_heap_stats;
+
 bool gpu_init(gpu_config* config);
 void gpu_destroy(void);
 const char* gpu_get_error(void);
+uint32_t gpu_get_memory_stats(gpu_heap_stats* heaps, uint32_t capacity);
 bool gpu_begin(uint32_t* tick);
 bool gpu_submit(gpu_stream** streams, uint32_t count);
 bool gpu_is_complete(uint32_t tick);
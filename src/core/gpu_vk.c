@@ -1,5 +1,6 @@
 #include "gpu.h"
 #include <string.h>
+#include <threads.h>
 
 #ifdef _WIN32
 #define THREAD_LOCAL __declspec(thread)
@@ -28,12 +29,16 @@ typedef struct gpu_memory gpu_memory;
 struct gpu_buffer {
   VkBuffer handle;
   gpu_memory* memory;
+  VkDeviceSize offset;
+  VkDeviceSize size;
 };
 
 struct gpu_texture {
   VkImage handle;
   VkImageView view;
   gpu_memory* memory;
+  VkDeviceSize offset;
+  VkDeviceSize size;
   VkImageAspectFlagBits aspect;
   VkImageLayout layout;
   uint32_t layers;
@@ -99,10 +104,23 @@ size_t gpu_sizeof_tally(void) { return sizeof(gpu_tally); }
 
 // Internals
 
+typedef struct {
+  VkDeviceSize offset;
+  VkDeviceSize size;
+} gpu_range;
+
+// Blocks keep their free ranges sorted by offset.  Allocations are best fit over all of the blocks
+// of an allocator, and freed ranges are merged with their neighbors.
 struct gpu_memory {
   VkDeviceMemory handle;
   void* pointer;
   uint32_t refs;
+  uint32_t allocator;
+  VkDeviceSize size;
+  VkDeviceSize used;
+  gpu_range* ranges;
+  uint32_t rangeCount;
+  uint32_t rangeCapacity;
 };
 
 typedef enum {
@@ -126,16 +144,17 @@ typedef enum {
 } gpu_memory_type;
 
 typedef struct {
-  gpu_memory* block;
-  uint32_t cursor;
   uint16_t memoryType;
   uint16_t memoryFlags;
+  uint32_t heap;
 } gpu_allocator;
 
 typedef struct {
   void* handle;
   VkObjectType type;
   uint32_t tick;
+  VkDeviceSize offset;
+  VkDeviceSize size;
 } gpu_victim;
 
 typedef struct {
@@ -201,10 +220,13 @@ static struct {
   gpu_allocator allocators[GPU_MEMORY_COUNT];
   uint8_t allocatorLookup[GPU_MEMORY_COUNT];
   gpu_memory memory[1024];
+  VkMemoryHeap heaps[VK_MAX_MEMORY_HEAPS];
+  uint32_t heapCount;
   uint32_t streamCount;
   uint32_t tick[2];
   gpu_tick ticks[2];
   gpu_morgue morgue;
+  mtx_t lock;
 } state;
 
 // Helpers
@@ -223,9 +245,13 @@ enum { LINEAR, SRGB };
 #define MORGUE_MASK (COUNTOF(state.morgue.data) - 1)
 
 static gpu_memory* allocate(gpu_memory_type type, VkMemoryRequirements info, VkDeviceSize* offset);
-static void release(gpu_memory* memory);
+static gpu_memory* allocateUnlocked(gpu_memory_type type, VkMemoryRequirements info, VkDeviceSize* offset);
+static void release(gpu_memory* memory, VkDeviceSize offset, VkDeviceSize size);
+static void freeRange(gpu_memory* memory, VkDeviceSize offset, VkDeviceSize size);
 static void condemn(void* handle, VkObjectType type);
+static void condemnUnlocked(void* handle, VkObjectType type);
 static void expunge(void);
+static void expungeUnlocked(void);
 static bool hasLayer(VkLayerProperties* layers, uint32_t count, const char* layer);
 static bool hasExtension(VkExtensionProperties* extensions, uint32_t count, const char* extension);
 static VkBufferUsageFlags getBufferUsage(gpu_buffer_type type);
@@ -404,9 +430,12 @@ bool gpu_buffer_init(gpu_buffer* buffer, gpu_buffer_info* info) {
     return false;
   }
 
+  buffer->offset = offset;
+  buffer->size = requirements.size;
+
   VK(vkBindBufferMemory(state.device, buffer->handle, buffer->memory->handle, offset), "vkBindBufferMemory") {
     vkDestroyBuffer(state.device, buffer->handle, NULL);
-    release(buffer->memory);
+    release(buffer->memory, buffer->offset, buffer->size);
     return false;
   }
 
@@ -420,7 +449,7 @@ bool gpu_buffer_init(gpu_buffer* buffer, gpu_buffer_info* info) {
 void gpu_buffer_destroy(gpu_buffer* buffer) {
   if (!buffer->memory) return;
   condemn(buffer->handle, VK_OBJECT_TYPE_BUFFER);
-  release(buffer->memory);
+  release(buffer->memory, buffer->offset, buffer->size);
 }
 
 // Texture
@@ -535,15 +564,18 @@ bool gpu_texture_init(gpu_texture* texture, gpu_texture_info* info) {
     return false;
   }
 
+  texture->offset = offset;
+  texture->size = requirements.size;
+
   VK(vkBindImageMemory(state.device, texture->handle, texture->memory->handle, offset), "vkBindImageMemory") {
     vkDestroyImage(state.device, texture->handle, NULL);
-    release(texture->memory);
+    release(texture->memory, texture->offset, texture->size);
     return false;
   }
 
   if (!gpu_texture_init_view(texture, &viewInfo)) {
     vkDestroyImage(state.device, texture->handle, NULL);
-    release(texture->memory);
+    release(texture->memory, texture->offset, texture->size);
     return false;
   }
 
@@ -737,7 +769,7 @@ void gpu_texture_destroy(gpu_texture* texture) {
   if (texture->imported) return;
   if (!texture->memory) return;
   condemn(texture->handle, VK_OBJECT_TYPE_IMAGE);
-  release(texture->memory);
+  release(texture->memory, texture->offset, texture->size);
 }
 
 // Surface
@@ -2278,6 +2310,7 @@ void gpu_xr_release(gpu_stream* stream, gpu_texture* texture) {
 
 bool gpu_init(gpu_config* config) {
   state.config = *config;
+  mtx_init(&state.lock, mtx_plain);
 
   // Load
 #ifdef _WIN32
@@ -2670,6 +2703,8 @@ bool gpu_init(gpu_config* config) {
     VkPhysicalDeviceMemoryProperties memoryProperties;
     vkGetPhysicalDeviceMemoryProperties(state.adapter, &memoryProperties);
     VkMemoryType* memoryTypes = memoryProperties.memoryTypes;
+    memcpy(state.heaps, memoryProperties.memoryHeaps, sizeof(state.heaps));
+    state.heapCount = memoryProperties.memoryHeapCount;
 
     VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 
@@ -2719,12 +2754,14 @@ bool gpu_init(gpu_config* config) {
         if ((memoryTypes[j].propertyFlags & bufferFlags[i]) == bufferFlags[i]) {
           allocator->memoryFlags = memoryTypes[j].propertyFlags;
           allocator->memoryType = j;
+          allocator->heap = memoryTypes[j].heapIndex;
           break;
         }
 
         if ((memoryTypes[j].propertyFlags & fallback) == fallback) {
           allocator->memoryFlags = memoryTypes[j].propertyFlags;
           allocator->memoryType = j;
+          allocator->heap = memoryTypes[j].heapIndex;
         }
       }
     }
@@ -2801,6 +2838,7 @@ bool gpu_init(gpu_config* config) {
         uint32_t index = allocatorCount++;
         state.allocators[index].memoryFlags = memoryFlags;
         state.allocators[index].memoryType = memoryType;
+        state.allocators[index].heap = memoryTypes[memoryType].heapIndex;
         state.allocatorLookup[i] = index;
       }
     }
@@ -2882,6 +2920,7 @@ void gpu_destroy(void) {
   }
   for (uint32_t i = 0; i < COUNTOF(state.memory); i++) {
     if (state.memory[i].handle) vkFreeMemory(state.device, state.memory[i].handle, NULL);
+    if (state.memory[i].ranges) state.config.fnFree(state.memory[i].ranges);
   }
   for (uint32_t i = 0; i < COUNTOF(state.surface.images); i++) {
     if (state.surface.images[i].view) vkDestroyImageView(state.device, state.surface.images[i].view, NULL);
@@ -2896,6 +2935,7 @@ void gpu_destroy(void) {
 #else
   if (state.library) dlclose(state.library);
 #endif
+  mtx_destroy(&state.lock);
   memset(&state, 0, sizeof(state));
 }
 
@@ -2985,10 +3025,68 @@ uintptr_t gpu_vk_get_queue(uint32_t* queueFamilyIndex, uint32_t* queueIndex) {
 
 // Helpers
 
+static bool insertRange(gpu_memory* memory, uint32_t index, VkDeviceSize offset, VkDeviceSize size) {
+  if (memory->rangeCount == memory->rangeCapacity) {
+    uint32_t capacity = memory->rangeCapacity ? memory->rangeCapacity * 2 : 8;
+    gpu_range* ranges = state.config.fnAlloc(capacity * sizeof(gpu_range));
+    ASSERT(ranges, "Out of memory") return false;
+    if (memory->ranges) {
+      memcpy(ranges, memory->ranges, memory->rangeCount * sizeof(gpu_range));
+      state.config.fnFree(memory->ranges);
+    }
+    memory->ranges = ranges;
+    memory->rangeCapacity = capacity;
+  }
+
+  memmove(memory->ranges + index + 1, memory->ranges + index, (memory->rangeCount - index) * sizeof(gpu_range));
+  memory->ranges[index] = (gpu_range) { offset, size };
+  memory->rangeCount++;
+  return true;
+}
+
+static void removeRange(gpu_memory* memory, uint32_t index) {
+  memmove(memory->ranges + index, memory->ranges + index + 1, (memory->rangeCount - index - 1) * sizeof(gpu_range));
+  memory->rangeCount--;
+}
+
+// Carves an allocation out of a free range, leaving the padding before it and the rest after it free
+static bool claimRange(gpu_memory* memory, uint32_t index, VkDeviceSize offset, VkDeviceSize size) {
+  gpu_range range = memory->ranges[index];
+  VkDeviceSize before = offset - range.offset;
+  VkDeviceSize after = range.offset + range.size - (offset + size);
+
+  if (before > 0 && after > 0) {
+    memory->ranges[index].size = before;
+    if (!insertRange(memory, index + 1, offset + size, after)) return false;
+  } else if (before > 0) {
+    memory->ranges[index].size = before;
+  } else if (after > 0) {
+    memory->ranges[index] = (gpu_range) { offset + size, after };
+  } else {
+    removeRange(memory, index);
+  }
+
+  memory->used += size;
+  memory->refs++;
+  return true;
+}
+
+// Memory and the morgue are shared by every thread that creates or destroys objects (e.g. buffers
+// allocated by forked passes), so they're guarded by a lock.  The Unlocked variants expect the
+// lock to be held already.
+
 static gpu_memory* allocate(gpu_memory_type type, VkMemoryRequirements info, VkDeviceSize* offset) {
-  gpu_allocator* allocator = &state.allocators[state.allocatorLookup[type]];
+  mtx_lock(&state.lock);
+  gpu_memory* memory = allocateUnlocked(type, info, offset);
+  mtx_unlock(&state.lock);
+  return memory;
+}
 
-  static const uint32_t blockSizes[] = {
+static gpu_memory* allocateUnlocked(gpu_memory_type type, VkMemoryRequirements info, VkDeviceSize* offset) {
+  uint32_t index = state.allocatorLookup[type];
+  gpu_allocator* allocator = &state.allocators[index];
+
+  static const VkDeviceSize blockSizes[] = {
     [GPU_MEMORY_BUFFER_STATIC] = 1 << 26,
     [GPU_MEMORY_BUFFER_STREAM] = 0,
     [GPU_MEMORY_BUFFER_UPLOAD] = 0,
@@ -3007,17 +3105,43 @@ static gpu_memory* allocate(gpu_memory_type type, VkMemoryRequirements info, VkD
     [GPU_MEMORY_TEXTURE_LAZY_D32FS8] = 1 << 28
   };
 
-  uint32_t blockSize = blockSizes[type];
-  uint32_t cursor = ALIGN(allocator->cursor, info.alignment);
+  VkDeviceSize blockSize = blockSizes[type];
+  VkDeviceSize alignment = MAX(info.alignment, 1);
+
+  // Find the free range that leaves the least space behind (blocks of size zero are dedicated)
+  if (blockSize > 0 && info.size <= blockSize) {
+    gpu_memory* best = NULL;
+    uint32_t bestIndex = 0;
+    VkDeviceSize bestOffset = 0;
+    VkDeviceSize bestWaste = ~(VkDeviceSize) 0;
+
+    for (uint32_t i = 0; i < COUNTOF(state.memory); i++) {
+      gpu_memory* memory = &state.memory[i];
+
+      if (!memory->handle || memory->allocator != index || memory->size - memory->used < info.size) {
+        continue;
+      }
+
+      for (uint32_t j = 0; j < memory->rangeCount; j++) {
+        gpu_range* range = &memory->ranges[j];
+        VkDeviceSize aligned = (range->offset + alignment - 1) / alignment * alignment;
+        if (aligned + info.size <= range->offset + range->size && range->size - info.size < bestWaste) {
+          best = memory;
+          bestIndex = j;
+          bestOffset = aligned;
+          bestWaste = range->size - info.size;
+        }
+      }
+    }
 
-  if (allocator->block && cursor + info.size <= blockSize) {
-    allocator->cursor = cursor + info.size;
-    allocator->block->refs++;
-    *offset = cursor;
-    return allocator->block;
+    if (best) {
+      if (!claimRange(best, bestIndex, bestOffset, info.size)) return NULL;
+      *offset = bestOffset;
+      return best;
+    }
   }
 
-  // If there wasn't an active block or it overflowed, find an empty block to allocate
+  // Otherwise, allocate a new block
   for (uint32_t i = 0; i < COUNTOF(state.memory); i++) {
     if (!state.memory[i].handle) {
       gpu_memory* memory = &state.memory[i];
@@ -3029,7 +3153,6 @@ static gpu_memory* allocate(gpu_memory_type type, VkMemoryRequirements info, VkD
       };
 
       VK(vkAllocateMemory(state.device, &memoryInfo, NULL, &memory->handle), "Failed to allocate GPU memory") {
-        allocator->block = NULL;
         return NULL;
       }
 
@@ -3043,9 +3166,18 @@ static gpu_memory* allocate(gpu_memory_type type, VkMemoryRequirements info, VkD
         memory->pointer = NULL;
       }
 
-      allocator->block = memory;
-      allocator->cursor = info.size;
-      allocator->block->refs = 1;
+      memory->refs = 0;
+      memory->allocator = index;
+      memory->size = memoryInfo.allocationSize;
+      memory->used = 0;
+      memory->rangeCount = 0;
+
+      if (!insertRange(memory, 0, 0, memory->size) || !claimRange(memory, 0, 0, info.size)) {
+        vkFreeMemory(state.device, memory->handle, NULL);
+        memory->handle = NULL;
+        return NULL;
+      }
+
       *offset = 0;
       return memory;
     }
@@ -3055,42 +3187,125 @@ static gpu_memory* allocate(gpu_memory_type type, VkMemoryRequirements info, VkD
   return NULL;
 }
 
-static void release(gpu_memory* memory) {
-  if (memory && --memory->refs == 0) {
-    condemn(memory->handle, VK_OBJECT_TYPE_DEVICE_MEMORY);
+// The range can't be reused until the GPU is done with it, so it goes through the morgue
+static void release(gpu_memory* memory, VkDeviceSize offset, VkDeviceSize size) {
+  if (!memory) return;
+  gpu_morgue* morgue = &state.morgue;
+  mtx_lock(&state.lock);
+  uint32_t head = morgue->head;
+  condemnUnlocked(memory, VK_OBJECT_TYPE_DEVICE_MEMORY);
+  if (morgue->head != head) {
+    morgue->data[head & MORGUE_MASK].offset = offset;
+    morgue->data[head & MORGUE_MASK].size = size;
+  }
+  mtx_unlock(&state.lock);
+}
+
+static void freeRange(gpu_memory* memory, VkDeviceSize offset, VkDeviceSize size) {
+  memory->used -= size;
+
+  if (--memory->refs == 0) {
+    vkFreeMemory(state.device, memory->handle, NULL);
     memory->handle = NULL;
+    memory->pointer = NULL;
+    memory->rangeCount = 0;
+    return;
+  }
 
-    for (uint32_t i = 0; i < COUNTOF(state.allocators); i++) {
-      if (state.allocators[i].block == memory) {
-        state.allocators[i].block = NULL;
-        state.allocators[i].cursor = 0;
-      }
+  // Find the first free range after the freed one, then merge with the neighbors
+  uint32_t lo = 0, hi = memory->rangeCount;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (memory->ranges[mid].offset < offset) lo = mid + 1;
+    else hi = mid;
+  }
+
+  gpu_range* prev = lo > 0 ? &memory->ranges[lo - 1] : NULL;
+  gpu_range* next = lo < memory->rangeCount ? &memory->ranges[lo] : NULL;
+  bool mergePrev = prev && prev->offset + prev->size == offset;
+  bool mergeNext = next && offset + size == next->offset;
+
+  if (mergePrev && mergeNext) {
+    prev->size += size + next->size;
+    removeRange(memory, lo);
+  } else if (mergePrev) {
+    prev->size += size;
+  } else if (mergeNext) {
+    next->offset = offset;
+    next->size += size;
+  } else if (!insertRange(memory, lo, offset, size)) {
+    return; // Leaks the range, but the block is still valid
+  }
+}
+
+uint32_t gpu_get_memory_stats(gpu_heap_stats* heaps, uint32_t capacity) {
+  uint32_t count = MIN(state.heapCount, capacity);
+  mtx_lock(&state.lock);
+
+  for (uint32_t i = 0; i < count; i++) {
+    heaps[i] = (gpu_heap_stats) {
+      .size = state.heaps[i].size,
+      .deviceLocal = state.heaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT
+    };
+  }
+
+  for (uint32_t i = 0; i < COUNTOF(state.memory); i++) {
+    gpu_memory* memory = &state.memory[i];
+    uint32_t heap = state.allocators[memory->allocator].heap;
+
+    if (!memory->handle || heap >= count) {
+      continue;
+    }
+
+    heaps[heap].allocated += memory->size;
+    heaps[heap].used += memory->used;
+    heaps[heap].blocks++;
+    heaps[heap].allocations += memory->refs;
+
+    for (uint32_t j = 0; j < memory->rangeCount; j++) {
+      heaps[heap].largestFree = MAX(heaps[heap].largestFree, memory->ranges[j].size);
     }
   }
+
+  mtx_unlock(&state.lock);
+  return count;
 }
 
 static void condemn(void* handle, VkObjectType type) {
+  if (!handle) return;
+  mtx_lock(&state.lock);
+  condemnUnlocked(handle, type);
+  mtx_unlock(&state.lock);
+}
+
+static void condemnUnlocked(void* handle, VkObjectType type) {
   if (!handle) return;
   gpu_morgue* morgue = &state.morgue;
 
   // If the morgue is full, try expunging to reclaim some space
   if (morgue->head - morgue->tail >= COUNTOF(morgue->data)) {
-    expunge();
+    expungeUnlocked();
 
     // If that didn't work, wait for the GPU to be done with the oldest victim and retry
     if (morgue->head - morgue->tail >= COUNTOF(morgue->data)) {
       gpu_wait_tick(morgue->data[morgue->tail & MORGUE_MASK].tick, NULL);
-      expunge();
+      expungeUnlocked();
     }
 
     // The following should be unreachable
     ASSERT(morgue->head - morgue->tail < COUNTOF(morgue->data), "Morgue overflow!") return;
   }
 
-  morgue->data[morgue->head++ & MORGUE_MASK] = (gpu_victim) { handle, type, state.tick[CPU] };
+  morgue->data[morgue->head++ & MORGUE_MASK] = (gpu_victim) { handle, type, state.tick[CPU], 0, 0 };
 }
 
 static void expunge(void) {
+  mtx_lock(&state.lock);
+  expungeUnlocked();
+  mtx_unlock(&state.lock);
+}
+
+static void expungeUnlocked(void) {
   gpu_morgue* morgue = &state.morgue;
   while (morgue->tail != morgue->head && state.tick[GPU] >= morgue->data[morgue->tail & MORGUE_MASK].tick) {
     gpu_victim* victim = &morgue->data[morgue->tail++ & MORGUE_MASK];
@@ -3106,7 +3321,7 @@ static void expunge(void) {
       case VK_OBJECT_TYPE_QUERY_POOL: vkDestroyQueryPool(state.device, victim->handle, NULL); break;
       case VK_OBJECT_TYPE_RENDER_PASS: vkDestroyRenderPass(state.device, victim->handle, NULL); break;
       case VK_OBJECT_TYPE_FRAMEBUFFER: vkDestroyFramebuffer(state.device, victim->handle, NULL); break;
-      case VK_OBJECT_TYPE_DEVICE_MEMORY: vkFreeMemory(state.device, victim->handle, NULL); break;
+      case VK_OBJECT_TYPE_DEVICE_MEMORY: freeRange(victim->handle, victim->offset, victim->size); break;
       default: LOG("Trying to destroy invalid Vulkan object type!"); break;
     }
   }
@@ -1050,6 +1050,10 @@ void gpu_destroy(void) {
   memset(&state, 0, sizeof(state));
 }
 
+uint32_t gpu_get_memory_stats(gpu_heap_stats* heaps, uint32_t capacity) {
+  return 0;
+}
+
 uint32_t gpu_begin(void) {
   return state.tick++;
 }
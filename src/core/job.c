@@ -5,68 +5,337 @@
 
 #define MAX_WORKERS 64
 #define MAX_JOBS 1024
+#define MASK (MAX_JOBS - 1)
+
+// Jobs are referred to by their index + 1 in the queues, so 0 can mean "nothing"
 
 struct job {
-  job* next;
   fn_job* fn;
   void* arg;
+  job_group* group;
+  bool detached;
+  atomic_uint next;
   atomic_uint done;
 };
 
+// Chase-Lev deque, owner pushes/pops at the bottom and thieves steal from the top.  It can't
+// overflow since it's as big as the job pool.
+typedef struct {
+  atomic_uint top;
+  char padding[60];
+  atomic_uint bottom;
+  atomic_uint slots[MAX_JOBS];
+} deque;
+
+// Bounded MPMC queue (Vyukov) for jobs submitted by threads that aren't workers
+typedef struct {
+  atomic_uint sequence;
+  uint32_t index;
+} cell;
+
 static struct {
   job jobs[MAX_JOBS];
+  deque deques[MAX_WORKERS];
+  cell cells[MAX_JOBS];
+  atomic_uint head;
+  char padding[60];
+  atomic_uint tail;
+  atomic_uint pool;
   thrd_t workers[MAX_WORKERS];
   uint32_t workerCount;
-  job* head;
-  job* tail;
-  job* pool;
+  atomic_uint sleepers;
+  atomic_uint waiters;
   cnd_t hasJob;
+  cnd_t jobDone;
   mtx_t lock;
-  bool quit;
+  atomic_uint quit;
 } state;
 
-// Must hold lock, this will unlock it, state.head must exist
-static void runJob(void) {
-  job* job = state.head;
-  state.head = job->next;
-  if (!job->next) state.tail = NULL;
-  mtx_unlock(&state.lock);
+// Index of the worker the current thread is (+ 1), 0 for other threads
+static thread_local uint32_t worker;
 
-  job->fn(job->arg);
-  job->done = true;
+// Pool (lock-free stack, the upper 16 bits of the head are an ABA tag)
+
+static job* allocJob(void) {
+  uint32_t head = atomic_load(&state.pool);
+  for (;;) {
+    uint32_t index = head & 0xffff;
+    if (index == 0) return NULL;
+    uint32_t next = atomic_load(&state.jobs[index - 1].next);
+    uint32_t tagged = (((head >> 16) + 1) << 16) | next;
+    if (atomic_compare_exchange_weak(&state.pool, &head, tagged)) {
+      return &state.jobs[index - 1];
+    }
+  }
 }
 
-static int workerLoop(void* arg) {
+static void freeJob(job* job) {
+  uint32_t index = (uint32_t) (job - state.jobs) + 1;
+  uint32_t head = atomic_load(&state.pool);
+  do {
+    atomic_store(&job->next, head & 0xffff);
+  } while (!atomic_compare_exchange_weak(&state.pool, &head, (((head >> 16) + 1) << 16) | index));
+}
+
+// Deque
+
+static void push(deque* d, uint32_t index) {
+  uint32_t b = atomic_load(&d->bottom);
+  atomic_store(&d->slots[b & MASK], index);
+  atomic_store(&d->bottom, b + 1);
+}
+
+static uint32_t pop(deque* d) {
+  uint32_t b = atomic_load(&d->bottom) - 1;
+  atomic_store(&d->bottom, b);
+  uint32_t t = atomic_load(&d->top);
+
+  if ((int32_t) (b - t) < 0) {
+    atomic_store(&d->bottom, t);
+    return 0;
+  }
+
+  uint32_t index = atomic_load(&d->slots[b & MASK]);
+
+  if (b != t) {
+    return index;
+  }
+
+  // Last one, race the thieves for it
+  if (!atomic_compare_exchange_strong(&d->top, &t, t + 1)) {
+    index = 0;
+  }
+
+  atomic_store(&d->bottom, b + 1);
+  return index;
+}
+
+static uint32_t steal(deque* d) {
+  uint32_t t = atomic_load(&d->top);
+  uint32_t b = atomic_load(&d->bottom);
+
+  if ((int32_t) (b - t) <= 0) {
+    return 0;
+  }
+
+  uint32_t index = atomic_load(&d->slots[t & MASK]);
+  return atomic_compare_exchange_strong(&d->top, &t, t + 1) ? index : 0;
+}
+
+// Queue
+
+static void enqueue(uint32_t index) {
+  cell* c;
+  uint32_t position = atomic_load(&state.tail);
   for (;;) {
+    c = &state.cells[position & MASK];
+    int32_t diff = (int32_t) (atomic_load(&c->sequence) - position);
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak(&state.tail, &position, position + 1)) {
+        break;
+      }
+    } else {
+      position = atomic_load(&state.tail);
+    }
+  }
+  c->index = index;
+  atomic_store(&c->sequence, position + 1);
+}
+
+static uint32_t dequeue(void) {
+  cell* c;
+  uint32_t position = atomic_load(&state.head);
+  for (;;) {
+    c = &state.cells[position & MASK];
+    int32_t diff = (int32_t) (atomic_load(&c->sequence) - (position + 1));
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak(&state.head, &position, position + 1)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return 0;
+    } else {
+      position = atomic_load(&state.head);
+    }
+  }
+  uint32_t index = c->index;
+  atomic_store(&c->sequence, position + MAX_JOBS);
+  return index;
+}
+
+// Scheduling
+
+static bool hasWork(void) {
+  if ((int32_t) (atomic_load(&state.tail) - atomic_load(&state.head)) > 0) {
+    return true;
+  }
+
+  for (uint32_t i = 0; i < state.workerCount; i++) {
+    deque* d = &state.deques[i];
+    if ((int32_t) (atomic_load(&d->bottom) - atomic_load(&d->top)) > 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static job* findJob(void) {
+  uint32_t index = 0;
+
+  if (worker) {
+    index = pop(&state.deques[worker - 1]);
+  }
+
+  if (!index) {
+    index = dequeue();
+  }
+
+  for (uint32_t i = 0; i < state.workerCount && !index; i++) {
+    uint32_t victim = (worker + i) % state.workerCount;
+    if (victim != worker - 1) {
+      index = steal(&state.deques[victim]);
+    }
+  }
+
+  return index ? &state.jobs[index - 1] : NULL;
+}
+
+// Only takes the lock if someone is actually asleep
+static void wake(bool all) {
+  if (atomic_load(&state.sleepers) > 0 || atomic_load(&state.waiters) > 0) {
     mtx_lock(&state.lock);
+    if (all) {
+      cnd_broadcast(&state.hasJob);
+    } else {
+      cnd_signal(&state.hasJob);
+    }
+    cnd_broadcast(&state.jobDone);
+    mtx_unlock(&state.lock);
+  }
+}
 
-    while (!state.head && !state.quit) {
-      cnd_wait(&state.hasJob, &state.lock);
+static void submit(job* job) {
+  uint32_t index = (uint32_t) (job - state.jobs) + 1;
+  if (worker) {
+    push(&state.deques[worker - 1], index);
+  } else {
+    enqueue(index);
+  }
+}
+
+static void finishGroup(job_group* group);
+
+// Jobs that belong to a group or were detached go back to the pool on their own, since nobody is
+// going to job_wait on them
+static void runJob(job* job) {
+  job->fn(job->arg);
+
+  if (job->group || job->detached) {
+    job_group* group = job->group;
+    freeJob(job);
+    if (group) finishGroup(group);
+  } else {
+    atomic_store(&job->done, 1);
+  }
+
+  if (atomic_load(&state.waiters) > 0) {
+    mtx_lock(&state.lock);
+    cnd_broadcast(&state.jobDone);
+    mtx_unlock(&state.lock);
+  }
+}
+
+// Grabs a job from the pool and submits it.  If the pool is exhausted, this helps out with other
+// jobs until one is available, and if there's nothing to help with then the job runs inline.  The
+// group, if any, should already be counting the job.
+static job* spawn(fn_job* fn, void* arg, job_group* group, bool detached) {
+  job* job;
+
+  while ((job = allocJob()) == NULL) {
+    struct job* other = findJob();
+
+    if (other) {
+      runJob(other);
+      continue;
     }
 
-    if (state.quit) {
-      break;
+    fn(arg);
+    if (group) finishGroup(group);
+    return NULL;
+  }
+
+  job->fn = fn;
+  job->arg = arg;
+  job->group = group;
+  job->detached = detached;
+  atomic_store(&job->done, 0);
+  submit(job);
+  return job;
+}
+
+// The last one out reads the continuation before zeroing the counter, since the group's memory may
+// be gone as soon as a waiter sees zero.  Nobody else can be holding a count when it's 1.
+static void finishGroup(job_group* group) {
+  uint32_t pending = atomic_load(&group->pending);
+
+  while (pending > 1 && !atomic_compare_exchange_weak(&group->pending, &pending, pending - 1)) {
+    continue;
+  }
+
+  if (pending == 1) {
+    fn_job* fn = group->then;
+    void* arg = group->arg;
+    job_group* next = group->next;
+    atomic_store(&group->pending, 0);
+
+    if (fn && spawn(fn, arg, next, !next)) {
+      wake(false);
     }
+  }
+}
+
+static int workerLoop(void* arg) {
+  worker = (uint32_t) (uintptr_t) arg + 1;
+
+  while (!atomic_load(&state.quit)) {
+    job* job = findJob();
 
-    runJob();
+    if (job) {
+      runJob(job);
+      continue;
+    }
+
+    mtx_lock(&state.lock);
+    atomic_fetch_add(&state.sleepers, 1);
+    while (!atomic_load(&state.quit) && !hasWork()) {
+      cnd_wait(&state.hasJob, &state.lock);
+    }
+    atomic_fetch_sub(&state.sleepers, 1);
+    mtx_unlock(&state.lock);
   }
 
-  mtx_unlock(&state.lock);
   return 0;
 }
 
 bool job_init(uint32_t count) {
   mtx_init(&state.lock, mtx_plain);
   cnd_init(&state.hasJob);
+  cnd_init(&state.jobDone);
 
-  state.pool = state.jobs;
-  for (uint32_t i = 0; i < MAX_JOBS - 1; i++) {
-    state.jobs[i].next = &state.jobs[i + 1];
+  for (uint32_t i = 0; i < MAX_JOBS; i++) {
+    state.jobs[i].next = i + 1 < MAX_JOBS ? i + 2 : 0;
+    state.cells[i].sequence = i;
   }
 
+  state.pool = 1;
+
+  // Workers read the count to steal from each other, so it's set up front
   if (count > MAX_WORKERS) count = MAX_WORKERS;
-  for (uint32_t i = 0; i < count; i++, state.workerCount++) {
+  state.workerCount = count;
+  for (uint32_t i = 0; i < count; i++) {
     if (thrd_create(&state.workers[i], workerLoop, (void*) (uintptr_t) i) != thrd_success) {
+      state.workerCount = i;
       return false;
     }
   }
@@ -75,62 +344,164 @@ bool job_init(uint32_t count) {
 }
 
 void job_destroy(void) {
-  state.quit = true;
+  mtx_lock(&state.lock);
+  atomic_store(&state.quit, 1);
   cnd_broadcast(&state.hasJob);
+  mtx_unlock(&state.lock);
   for (uint32_t i = 0; i < state.workerCount; i++) {
     thrd_join(state.workers[i], NULL);
   }
   cnd_destroy(&state.hasJob);
+  cnd_destroy(&state.jobDone);
   mtx_destroy(&state.lock);
   memset(&state, 0, sizeof(state));
 }
 
 job* job_start(fn_job* fn, void* arg) {
-  mtx_lock(&state.lock);
+  job* job = spawn(fn, arg, NULL, false);
+  if (job) wake(false);
+  return job;
+}
+
+void job_start_batch(fn_job* fn, void** args, uint32_t count, job** jobs) {
+  uint32_t submitted = 0;
 
-  if (!state.pool) {
+  for (uint32_t i = 0; i < count; i++) {
+    jobs[i] = spawn(fn, args[i], NULL, false);
+    submitted += !!jobs[i];
+  }
+
+  if (submitted > 0) {
+    wake(submitted > 1);
+  }
+}
+
+void job_wait(job* job) {
+  if (!job) return;
+
+  while (!atomic_load(&job->done)) {
+    struct job* other = findJob();
+
+    if (other) {
+      runJob(other);
+      continue;
+    }
+
+    // Nothing left to help with, the job is running somewhere else
+    mtx_lock(&state.lock);
+    atomic_fetch_add(&state.waiters, 1);
+    while (!atomic_load(&job->done) && !hasWork()) {
+      cnd_wait(&state.jobDone, &state.lock);
+    }
+    atomic_fetch_sub(&state.waiters, 1);
     mtx_unlock(&state.lock);
-    fn(arg);
-    return NULL;
   }
 
-  job* job = state.pool;
-  state.pool = job->next;
+  freeJob(job);
+}
+
+// Groups
 
-  if (state.tail) {
-    state.tail->next = job;
-    state.tail = job;
-  } else {
-    state.head = job;
-    state.tail = job;
-    cnd_signal(&state.hasJob);
+void job_group_init(job_group* group) {
+  atomic_store(&group->pending, 1);
+  group->closed = false;
+  group->then = NULL;
+  group->arg = NULL;
+  group->next = NULL;
+}
+
+void job_group_add(job_group* group, fn_job* fn, void* arg) {
+  atomic_fetch_add(&group->pending, 1);
+  if (spawn(fn, arg, group, false)) {
+    wake(false);
   }
+}
 
-  job->next = NULL;
-  job->done = false;
-  job->fn = fn;
-  job->arg = arg;
+void job_group_add_batch(job_group* group, fn_job* fn, void** args, uint32_t count) {
+  uint32_t submitted = 0;
 
-  mtx_unlock(&state.lock);
-  return job;
+  atomic_fetch_add(&group->pending, count);
+  for (uint32_t i = 0; i < count; i++) {
+    submitted += !!spawn(fn, args[i], group, false);
+  }
+
+  if (submitted > 0) {
+    wake(submitted > 1);
+  }
 }
 
-void job_wait(job* job) {
-  if (!job) return;
+static void closeGroup(job_group* group) {
+  if (!group->closed) {
+    group->closed = true;
+    finishGroup(group);
+  }
+}
 
-  while (!job->done) {
-    mtx_lock(&state.lock);
+void job_group_then(job_group* group, fn_job* fn, void* arg, job_group* next) {
+  group->then = fn;
+  group->arg = arg;
+  group->next = next;
+  if (next) atomic_fetch_add(&next->pending, 1);
+  closeGroup(group);
+}
 
-    if (state.head) {
-      runJob();
-    } else {
-      mtx_unlock(&state.lock);
-      thrd_yield();
+void job_group_wait(job_group* group) {
+  closeGroup(group);
+
+  while (atomic_load(&group->pending) > 0) {
+    job* other = findJob();
+
+    if (other) {
+      runJob(other);
+      continue;
+    }
+
+    mtx_lock(&state.lock);
+    atomic_fetch_add(&state.waiters, 1);
+    while (atomic_load(&group->pending) > 0 && !hasWork()) {
+      cnd_wait(&state.jobDone, &state.lock);
     }
+    atomic_fetch_sub(&state.waiters, 1);
+    mtx_unlock(&state.lock);
   }
+}
 
-  mtx_lock(&state.lock);
-  job->next = state.pool;
-  state.pool = job;
-  mtx_unlock(&state.lock);
+// Parallel for
+
+typedef struct {
+  fn_range* fn;
+  void* arg;
+  uint32_t count;
+  uint32_t grain;
+  atomic_uint next;
+} range;
+
+static void runRange(void* arg) {
+  range* r = arg;
+  uint32_t start;
+  while ((start = atomic_fetch_add(&r->next, r->grain)) < r->count) {
+    uint32_t end = r->count - start > r->grain ? start + r->grain : r->count;
+    r->fn(r->arg, start, end);
+  }
+}
+
+void job_parallel_for(uint32_t count, uint32_t grain, fn_range* fn, void* arg) {
+  if (grain == 0) grain = 1;
+  uint32_t chunks = count / grain + !!(count % grain);
+
+  if (chunks <= 1 || state.workerCount == 0) {
+    if (count > 0) fn(arg, 0, count);
+    return;
+  }
+
+  range r = { fn, arg, count, grain, 0 };
+  uint32_t helpers = chunks - 1 < state.workerCount ? chunks - 1 : state.workerCount;
+
+  job_group group;
+  job_group_init(&group);
+  for (uint32_t i = 0; i < helpers; i++) {
+    job_group_add(&group, runRange, &r);
+  }
+  runRange(&r);
+  job_group_wait(&group);
 }
@@ -1,13 +1,36 @@
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 
 #pragma once
 
 typedef struct job job;
 typedef void fn_job(void* arg);
+typedef void fn_range(void* arg, uint32_t start, uint32_t end);
+
+// A group counts its outstanding jobs.  It stays open until job_group_then or job_group_wait is
+// called, after which no more jobs can be added to it.  A continuation runs as a job once all of
+// the jobs in the group finish, and is counted by the "next" group (if any), so continuations can
+// be chained into dependency graphs.
+typedef struct job_group {
+  atomic_uint pending;
+  bool closed;
+  fn_job* then;
+  void* arg;
+  struct job_group* next;
+} job_group;
 
 bool job_init(uint32_t workerCount);
 void job_destroy(void);
 job* job_start(fn_job* fn, void* arg);
+void job_start_batch(fn_job* fn, void** args, uint32_t count, job** jobs);
 void job_wait(job* job);
+
+void job_group_init(job_group* group);
+void job_group_add(job_group* group, fn_job* fn, void* arg);
+void job_group_add_batch(job_group* group, fn_job* fn, void** args, uint32_t count);
+void job_group_then(job_group* group, fn_job* fn, void* arg, job_group* next);
+void job_group_wait(job_group* group);
+
+void job_parallel_for(uint32_t count, uint32_t grain, fn_range* fn, void* arg);
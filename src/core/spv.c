@@ -46,6 +46,7 @@ typedef struct {
   uint32_t bound;
   spv_cache* cache;
   spv_field* fields;
+  uint32_t pushConstantId;
 } spv_context;
 
 #define OP_CODE(op) (op[0] & 0xffff)
@@ -69,6 +70,7 @@ spv_result spv_parse(const void* source, size_t size, spv_info* info) {
   spv.wordCount = size / sizeof(uint32_t);
   spv.edge = spv.words + spv.wordCount - 8;
   spv.fields = info->fields;
+  spv.pushConstantId = ~0u;
 
   if (spv.wordCount < 16 || spv.words[0] != 0x07230203) {
     return SPV_INVALID;
@@ -91,6 +93,7 @@ spv_result spv_parse(const void* source, size_t size, spv_info* info) {
   info->attributeCount = 0;
   info->resourceCount = 0;
   info->fieldCount = 0;
+  info->pushConstantsUsed = false;
 
   const uint32_t* op = spv.words + 5;
 
@@ -145,7 +148,17 @@ spv_result spv_parse(const void* source, size_t size, spv_info* info) {
         result = spv_parse_variable(&spv, op, info);
         break;
       case 54: // OpFunction
-        op = spv.words + spv.wordCount; // Can exit early upon reaching actual code
+        // Only the code that loads from the push constants needs to be found, then it can exit
+        for (const uint32_t* end = spv.words + spv.wordCount; spv.pushConstantId != ~0u && op < end; op += length) {
+          opcode = OP_CODE(op);
+          length = OP_LENGTH(op);
+          if (length == 0 || op + length > end) return SPV_INVALID;
+          if ((opcode == 61 || opcode == 65 || opcode == 66) && length >= 4 && op[3] == spv.pushConstantId) { // OpLoad, OpAccessChain, OpInBoundsAccessChain
+            info->pushConstantsUsed = true;
+            break;
+          }
+        }
+        op = spv.words + spv.wordCount;
         length = 0;
         break;
     }
@@ -351,6 +364,8 @@ static spv_result spv_parse_variable(spv_context* spv, const uint32_t* op, spv_i
       info->pushConstants = spv->fields++;
     }
 
+    spv->pushConstantId = variableId;
+
     info->fieldCount++;
     return spv_parse_field(spv, type, info->pushConstants, info);
   }
@@ -1,4 +1,5 @@
 #include <stdint.h>
+#include <stdbool.h>
 #include <stddef.h>
 
 #pragma once
@@ -100,6 +101,7 @@ typedef struct {
   uint32_t* features;
   spv_spec_constant* specConstants;
   spv_field* pushConstants;
+  bool pushConstantsUsed;
   spv_attribute* attributes;
   spv_resource* resources;
   spv_field* fields;
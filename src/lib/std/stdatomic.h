@@ -166,6 +166,23 @@ typedef volatile long atomic_uint;
 #define atomic_fetch_and(p, x) InterlockedAnd(p, x)
 #define atomic_fetch_and_explicit(p, x, o) atomic_fetch_and(p, x)
 
+#define atomic_exchange(p, x) _InterlockedExchange((volatile long*) (p), (long) (x))
+#define atomic_exchange_explicit(p, x, o) atomic_exchange(p, x)
+
+static inline _Bool atomic_cas_msvc(volatile long* p, long* expected, long desired) {
+  long previous = _InterlockedCompareExchange(p, desired, *expected);
+  if (previous == *expected) return 1;
+  *expected = previous;
+  return 0;
+}
+
+#define atomic_compare_exchange_strong(p, x, y) atomic_cas_msvc((volatile long*) (p), (long*) (x), (long) (y))
+#define atomic_compare_exchange_strong_explicit(p, x, y, o1, o2) atomic_compare_exchange_strong(p, x, y)
+#define atomic_compare_exchange_weak(p, x, y) atomic_compare_exchange_strong(p, x, y)
+#define atomic_compare_exchange_weak_explicit(p, x, y, o1, o2) atomic_compare_exchange_strong(p, x, y)
+
+#define atomic_thread_fence(o) MemoryBarrier()
+
 #define ATOMIC_INT_LOCK_FREE 2
 
 #endif
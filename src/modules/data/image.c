@@ -1,7 +1,14 @@
 #include "data/image.h"
 #include "data/blob.h"
 #include "util.h"
+#ifndef LOVR_DISABLE_THREAD
+#include "core/job.h"
+#endif
 #include "lib/stb/stb_image.h"
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -102,19 +109,65 @@ static bool loadDDS(Blob* blob, Image** image);
 static bool loadASTC(Blob* blob, Image** image);
 static bool loadKTX1(Blob* blob, Image** image);
 static bool loadKTX2(Blob* blob, Image** image);
-static bool loadSTB(Blob* blob, Image** image);
+static bool loadSTB(Blob* blob, bool compact, Image** image);
 
-Image* lovrImageCreateFromFile(Blob* blob) {
+static Image* decode(Blob* blob, bool compact) {
   Image* image = NULL;
   if (!image && !loadDDS(blob, &image)) return NULL;
   if (!image && !loadASTC(blob, &image)) return NULL;
   if (!image && !loadKTX1(blob, &image)) return NULL;
   if (!image && !loadKTX2(blob, &image)) return NULL;
-  if (!image && !loadSTB(blob, &image)) return NULL;
+  if (!image && !loadSTB(blob, compact, &image)) return NULL;
   if (!image) lovrSetError("Could not load image from '%s': Image file format not recognized", blob->name);
   return image;
 }
 
+Image* lovrImageCreateFromFile(Blob* blob) {
+  return decode(blob, false);
+}
+
+typedef struct {
+  Blob** blobs;
+  Image** images;
+  bool compact;
+  atomic_uint failed;
+  char error[256];
+} DecodeBatch;
+
+static void decodeRange(void* arg, uint32_t start, uint32_t end) {
+  DecodeBatch* batch = arg;
+  for (uint32_t i = start; i < end; i++) {
+    if ((batch->images[i] = decode(batch->blobs[i], batch->compact)) == NULL) {
+      unsigned int expected = 0;
+      if (atomic_compare_exchange_strong(&batch->failed, &expected, i + 1)) {
+        strncpy(batch->error, lovrGetError(), sizeof(batch->error) - 1);
+      }
+    }
+  }
+}
+
+// Errors are thread local, so the first failure's message gets carried back to the caller
+bool lovrImageCreateFromFiles(Blob** blobs, uint32_t count, bool compact, Image** images) {
+  DecodeBatch batch = { .blobs = blobs, .images = images, .compact = compact };
+  atomic_init(&batch.failed, 0);
+
+#ifndef LOVR_DISABLE_THREAD
+  job_parallel_for(count, 1, decodeRange, &batch);
+#else
+  decodeRange(&batch, 0, count);
+#endif
+
+  if (atomic_load(&batch.failed) > 0) {
+    for (uint32_t i = 0; i < count; i++) {
+      lovrRelease(images[i], lovrImageDestroy);
+      images[i] = NULL;
+    }
+    return lovrSetError("%s", batch.error);
+  }
+
+  return true;
+}
+
 void lovrImageDestroy(void* ref) {
   Image* image = ref;
   lovrRelease(image->blob, lovrBlobDestroy);
@@ -256,26 +309,93 @@ bool lovrImageSetPixel(Image* image, uint32_t x, uint32_t y, float pixel[4]) {
   }
 }
 
+typedef void GetPixel(ImagePointer src, float* dst);
+typedef void SetPixel(float* src, ImagePointer dst);
+
+static bool getPixelFunctions(TextureFormat format, GetPixel** getPixel, SetPixel** setPixel) {
+  switch (format) {
+    case FORMAT_R8: *getPixel = getPixelR8, *setPixel = setPixelR8; return true;
+    case FORMAT_RG8: *getPixel = getPixelRG8, *setPixel = setPixelRG8; return true;
+    case FORMAT_RGBA8: *getPixel = getPixelRGBA8, *setPixel = setPixelRGBA8; return true;
+    case FORMAT_R16: *getPixel = getPixelR16, *setPixel = setPixelR16; return true;
+    case FORMAT_RG16: *getPixel = getPixelRG16, *setPixel = setPixelRG16; return true;
+    case FORMAT_RGBA16: *getPixel = getPixelRGBA16, *setPixel = setPixelRGBA16; return true;
+    case FORMAT_R16F: *getPixel = getPixelR16F, *setPixel = setPixelR16F; return true;
+    case FORMAT_RG16F: *getPixel = getPixelRG16F, *setPixel = setPixelRG16F; return true;
+    case FORMAT_RGBA16F: *getPixel = getPixelRGBA16F, *setPixel = setPixelRGBA16F; return true;
+    case FORMAT_R32F: *getPixel = getPixelR32F, *setPixel = setPixelR32F; return true;
+    case FORMAT_RG32F: *getPixel = getPixelRG32F, *setPixel = setPixelRG32F; return true;
+    case FORMAT_RGBA32F: *getPixel = getPixelRGBA32F, *setPixel = setPixelRGBA32F; return true;
+    default: return false;
+  }
+}
+
+// Bulk operations work a row at a time, decoding it to RGBA floats and encoding it back, so the
+// per-pixel work is a tight loop over the row instead of a function call for every pixel
+
+typedef void GetRow(const void* src, float* dst, uint32_t count);
+typedef void SetRow(const float* src, void* dst, uint32_t count);
+
+#define ROW_FUNCTIONS(name, type, channels, decode, encode)\
+  static void getRow##name(const void* src, float* dst, uint32_t count) {\
+    const type* s = src;\
+    for (uint32_t i = 0; i < count; i++, s += channels, dst += 4) {\
+      dst[0] = 0.f, dst[1] = 0.f, dst[2] = 0.f, dst[3] = 1.f;\
+      for (uint32_t c = 0; c < channels; c++) dst[c] = decode(s[c]);\
+    }\
+  }\
+  static void setRow##name(const float* src, void* dst, uint32_t count) {\
+    type* d = dst;\
+    for (uint32_t i = 0; i < count; i++, src += 4, d += channels) {\
+      for (uint32_t c = 0; c < channels; c++) d[c] = encode(src[c]);\
+    }\
+  }
+
+#define DECODE_UNORM8(x) ((x) / 255.f)
+#define ENCODE_UNORM8(x) ((uint8_t) ((x) * 255.f + .5f))
+#define DECODE_UNORM16(x) ((x) / 65535.f)
+#define ENCODE_UNORM16(x) ((uint16_t) ((x) * 65535.f + .5f))
+#define COPY_FLOAT(x) (x)
+
+ROW_FUNCTIONS(R8, uint8_t, 1, DECODE_UNORM8, ENCODE_UNORM8)
+ROW_FUNCTIONS(RG8, uint8_t, 2, DECODE_UNORM8, ENCODE_UNORM8)
+ROW_FUNCTIONS(RGBA8, uint8_t, 4, DECODE_UNORM8, ENCODE_UNORM8)
+ROW_FUNCTIONS(R16, uint16_t, 1, DECODE_UNORM16, ENCODE_UNORM16)
+ROW_FUNCTIONS(RG16, uint16_t, 2, DECODE_UNORM16, ENCODE_UNORM16)
+ROW_FUNCTIONS(RGBA16, uint16_t, 4, DECODE_UNORM16, ENCODE_UNORM16)
+ROW_FUNCTIONS(R16F, uint16_t, 1, float16to32, float32to16)
+ROW_FUNCTIONS(RG16F, uint16_t, 2, float16to32, float32to16)
+ROW_FUNCTIONS(RGBA16F, uint16_t, 4, float16to32, float32to16)
+ROW_FUNCTIONS(R32F, float, 1, COPY_FLOAT, COPY_FLOAT)
+ROW_FUNCTIONS(RG32F, float, 2, COPY_FLOAT, COPY_FLOAT)
+ROW_FUNCTIONS(RGBA32F, float, 4, COPY_FLOAT, COPY_FLOAT)
+
+static bool getRowFunctions(TextureFormat format, GetRow** getRow, SetRow** setRow) {
+  switch (format) {
+    case FORMAT_R8: *getRow = getRowR8, *setRow = setRowR8; return true;
+    case FORMAT_RG8: *getRow = getRowRG8, *setRow = setRowRG8; return true;
+    case FORMAT_RGBA8: *getRow = getRowRGBA8, *setRow = setRowRGBA8; return true;
+    case FORMAT_R16: *getRow = getRowR16, *setRow = setRowR16; return true;
+    case FORMAT_RG16: *getRow = getRowRG16, *setRow = setRowRG16; return true;
+    case FORMAT_RGBA16: *getRow = getRowRGBA16, *setRow = setRowRGBA16; return true;
+    case FORMAT_R16F: *getRow = getRowR16F, *setRow = setRowR16F; return true;
+    case FORMAT_RG16F: *getRow = getRowRG16F, *setRow = setRowRG16F; return true;
+    case FORMAT_RGBA16F: *getRow = getRowRGBA16F, *setRow = setRowRGBA16F; return true;
+    case FORMAT_R32F: *getRow = getRowR32F, *setRow = setRowR32F; return true;
+    case FORMAT_RG32F: *getRow = getRowRG32F, *setRow = setRowRG32F; return true;
+    case FORMAT_RGBA32F: *getRow = getRowRGBA32F, *setRow = setRowRGBA32F; return true;
+    default: return false;
+  }
+}
+
 bool lovrImageMapPixel(Image* image, uint32_t x0, uint32_t y0, uint32_t w, uint32_t h, MapPixelCallback* callback, void* userdata) {
   lovrCheck(!lovrImageIsCompressed(image), "Unable to access individual pixels of a compressed image");
   lovrCheck(x0 + w <= image->width, "Pixel rectangle must be within Image bounds");
   lovrCheck(y0 + h <= image->height, "Pixel rectangle must be within Image bounds");
-  void (*getPixel)(ImagePointer src, float* dst);
-  void (*setPixel)(float* src, ImagePointer dst);
-  switch (image->format) {
-    case FORMAT_R8: getPixel = getPixelR8, setPixel = setPixelR8; break;
-    case FORMAT_RG8: getPixel = getPixelRG8, setPixel = setPixelRG8; break;
-    case FORMAT_RGBA8: getPixel = getPixelRGBA8, setPixel = setPixelRGBA8; break;
-    case FORMAT_R16: getPixel = getPixelR16, setPixel = setPixelR16; break;
-    case FORMAT_RG16: getPixel = getPixelRG16, setPixel = setPixelRG16; break;
-    case FORMAT_RGBA16: getPixel = getPixelRGBA16, setPixel = setPixelRGBA16; break;
-    case FORMAT_R16F: getPixel = getPixelR16F, setPixel = setPixelR16F; break;
-    case FORMAT_RG16F: getPixel = getPixelRG16F, setPixel = setPixelRG16F; break;
-    case FORMAT_RGBA16F: getPixel = getPixelRGBA16F, setPixel = setPixelRGBA16F; break;
-    case FORMAT_R32F: getPixel = getPixelR32F, setPixel = setPixelR32F; break;
-    case FORMAT_RG32F: getPixel = getPixelRG32F, setPixel = setPixelRG32F; break;
-    case FORMAT_RGBA32F: getPixel = getPixelRGBA32F, setPixel = setPixelRGBA32F; break;
-    default: return lovrSetError("Unsupported format for Image:mapPixel");
+  GetPixel* getPixel;
+  SetPixel* setPixel;
+  if (!getPixelFunctions(image->format, &getPixel, &setPixel)) {
+    return lovrSetError("Unsupported format for Image:mapPixel");
   }
   float pixel[4] = { 0.f, 0.f, 0.f, 1.f };
   uint32_t width = image->width;
@@ -311,6 +431,256 @@ bool lovrImageCopy(Image* src, Image* dst, uint32_t srcOffset[2], uint32_t dstOf
   return true;
 }
 
+// Resizing
+
+// Creates an Image with room for every level and layer, laid out layer by layer like DDS files
+static Image* allocateImage(uint32_t width, uint32_t height, uint32_t layers, uint32_t levels, TextureFormat format, uint32_t flags, const char* name) {
+  size_t stride = 0;
+  for (uint32_t i = 0; i < levels; i++) {
+    stride += measure(MAX(width >> i, 1), MAX(height >> i, 1), format);
+  }
+
+  size_t size = stride * layers;
+  uint8_t* data = lovrMalloc(size);
+
+  Image* image = lovrCalloc(offsetof(Image, mipmaps) + levels * sizeof(Mipmap));
+  image->ref = 1;
+  image->flags = flags;
+  image->width = width;
+  image->height = height;
+  image->format = format;
+  image->layers = layers;
+  image->levels = levels;
+  image->blob = lovrBlobCreate(data, size, name);
+
+  for (uint32_t i = 0; i < levels; i++) {
+    size_t levelSize = measure(MAX(width >> i, 1), MAX(height >> i, 1), format);
+    image->mipmaps[i] = (Mipmap) { data, levelSize, stride };
+    data += levelSize;
+  }
+
+  return image;
+}
+
+static float gammaToLinear(float x) {
+  return x <= .04045f ? x / 12.92f : powf((x + .055f) / 1.055f, 2.4f);
+}
+
+static float linearToGamma(float x) {
+  return x <= .0031308f ? x * 12.92f : 1.055f * powf(x, 1.f / 2.4f) - .055f;
+}
+
+static float sinc(float x) {
+  return x == 0.f ? 1.f : sinf((float) M_PI * x) / ((float) M_PI * x);
+}
+
+static float bessel0(float x) {
+  float sum = 1.f, term = 1.f;
+  for (uint32_t k = 1; k < 16; k++) {
+    term *= (x * x * .25f) / (k * k);
+    sum += term;
+  }
+  return sum;
+}
+
+static const float filterSupport[] = {
+  [IMAGE_FILTER_BOX] = .5f,
+  [IMAGE_FILTER_KAISER] = 3.f,
+  [IMAGE_FILTER_LANCZOS] = 3.f
+};
+
+static float evaluateFilter(ImageFilter filter, float t) {
+  switch (filter) {
+    case IMAGE_FILTER_BOX: return fabsf(t) <= .5f ? 1.f : 0.f;
+    case IMAGE_FILTER_KAISER: {
+      float r = t / 3.f;
+      return r * r < 1.f ? sinc(t) * bessel0(4.f * sqrtf(1.f - r * r)) / bessel0(4.f) : 0.f;
+    }
+    case IMAGE_FILTER_LANCZOS: return fabsf(t) < 3.f ? sinc(t) * sinc(t / 3.f) : 0.f;
+    default: lovrUnreachable();
+  }
+}
+
+// The weights each destination pixel gives to its source pixels along one axis.  When shrinking,
+// the filter is stretched so it covers all of the source pixels that land in a destination pixel.
+typedef struct {
+  uint32_t taps;
+  uint32_t* indices;
+  float* weights;
+} ResizeKernel;
+
+static void initKernel(ResizeKernel* kernel, uint32_t srcSize, uint32_t dstSize, ImageFilter filter) {
+  float scale = (float) dstSize / srcSize;
+  float stretch = scale < 1.f ? 1.f / scale : 1.f;
+  float support = filterSupport[filter] * stretch;
+  kernel->taps = (uint32_t) ceilf(support * 2.f) + 1;
+  kernel->indices = lovrMalloc(dstSize * kernel->taps * sizeof(uint32_t));
+  kernel->weights = lovrMalloc(dstSize * kernel->taps * sizeof(float));
+
+  for (uint32_t x = 0; x < dstSize; x++) {
+    uint32_t* indices = kernel->indices + x * kernel->taps;
+    float* weights = kernel->weights + x * kernel->taps;
+    float center = (x + .5f) / scale;
+    int32_t first = (int32_t) floorf(center - support);
+    float sum = 0.f;
+
+    for (uint32_t i = 0; i < kernel->taps; i++) {
+      int32_t j = first + (int32_t) i;
+      weights[i] = evaluateFilter(filter, (j + .5f - center) / stretch);
+      indices[i] = (uint32_t) CLAMP(j, 0, (int32_t) srcSize - 1);
+      sum += weights[i];
+    }
+
+    for (uint32_t i = 0; i < kernel->taps; i++) {
+      weights[i] = sum != 0.f ? weights[i] / sum : 0.f;
+    }
+  }
+}
+
+typedef struct {
+  GetRow* getRow;
+  SetRow* setRow;
+  size_t pixelSize;
+  bool srgb;
+  bool normalized;
+  const uint8_t* src;
+  uint8_t* dst;
+  uint32_t srcWidth;
+  uint32_t srcHeight;
+  uint32_t dstWidth;
+  uint32_t dstHeight;
+  ResizeKernel horizontal;
+  ResizeKernel vertical;
+  float* scratch;
+} ResizeJob;
+
+// First pass: decode each source row to linear floats and filter it horizontally into scratch
+static void resizeRows(void* arg, uint32_t start, uint32_t end) {
+  ResizeJob* job = arg;
+  float* row = lovrMalloc(job->srcWidth * 4 * sizeof(float));
+
+  for (uint32_t y = start; y < end; y++) {
+    job->getRow(job->src + (size_t) y * job->srcWidth * job->pixelSize, row, job->srcWidth);
+
+    if (job->srgb) {
+      for (uint32_t x = 0; x < job->srcWidth; x++) {
+        float* pixel = row + 4 * x;
+        for (uint32_t c = 0; c < 3; c++) pixel[c] = gammaToLinear(pixel[c]);
+      }
+    }
+
+    float* out = job->scratch + (size_t) y * job->dstWidth * 4;
+    for (uint32_t x = 0; x < job->dstWidth; x++, out += 4) {
+      const uint32_t* indices = job->horizontal.indices + x * job->horizontal.taps;
+      const float* weights = job->horizontal.weights + x * job->horizontal.taps;
+      float sum[4] = { 0.f };
+      for (uint32_t i = 0; i < job->horizontal.taps; i++) {
+        const float* pixel = row + 4 * indices[i];
+        for (uint32_t c = 0; c < 4; c++) sum[c] += pixel[c] * weights[i];
+      }
+      memcpy(out, sum, sizeof(sum));
+    }
+  }
+
+  lovrFree(row);
+}
+
+// Second pass: filter scratch vertically one row at a time, then encode each row into the destination
+static void resizeColumns(void* arg, uint32_t start, uint32_t end) {
+  ResizeJob* job = arg;
+  size_t count = (size_t) job->dstWidth * 4;
+  float* row = lovrMalloc(count * sizeof(float));
+
+  for (uint32_t y = start; y < end; y++) {
+    const uint32_t* indices = job->vertical.indices + y * job->vertical.taps;
+    const float* weights = job->vertical.weights + y * job->vertical.taps;
+
+    memset(row, 0, count * sizeof(float));
+    for (uint32_t i = 0; i < job->vertical.taps; i++) {
+      const float* source = job->scratch + (size_t) indices[i] * count;
+      float weight = weights[i];
+      for (size_t k = 0; k < count; k++) row[k] += source[k] * weight;
+    }
+
+    if (job->normalized) {
+      for (size_t k = 0; k < count; k++) row[k] = CLAMP(row[k], 0.f, 1.f);
+    }
+
+    if (job->srgb) {
+      for (uint32_t x = 0; x < job->dstWidth; x++) {
+        float* pixel = row + 4 * x;
+        for (uint32_t c = 0; c < 3; c++) pixel[c] = linearToGamma(pixel[c]);
+      }
+    }
+
+    job->setRow(row, job->dst + (size_t) y * job->dstWidth * job->pixelSize, job->dstWidth);
+  }
+
+  lovrFree(row);
+}
+
+static void resizeLayer(Image* src, uint32_t srcLevel, Image* dst, uint32_t dstLevel, uint32_t layer, ImageFilter filter) {
+  ResizeJob job = {
+    .pixelSize = measure(1, 1, src->format),
+    .normalized = src->format <= FORMAT_RGBA16,
+    .src = lovrImageGetLayerData(src, srcLevel, layer),
+    .dst = lovrImageGetLayerData(dst, dstLevel, layer),
+    .srcWidth = lovrImageGetWidth(src, srcLevel),
+    .srcHeight = lovrImageGetHeight(src, srcLevel),
+    .dstWidth = lovrImageGetWidth(dst, dstLevel),
+    .dstHeight = lovrImageGetHeight(dst, dstLevel)
+  };
+
+  job.srgb = (src->flags & IMAGE_SRGB) && job.normalized;
+  getRowFunctions(src->format, &job.getRow, &job.setRow);
+  initKernel(&job.horizontal, job.srcWidth, job.dstWidth, filter);
+  initKernel(&job.vertical, job.srcHeight, job.dstHeight, filter);
+  job.scratch = lovrMalloc((size_t) job.dstWidth * job.srcHeight * 4 * sizeof(float));
+
+#ifndef LOVR_DISABLE_THREAD
+  job_parallel_for(job.srcHeight, 16, resizeRows, &job);
+  job_parallel_for(job.dstHeight, 16, resizeColumns, &job);
+#else
+  resizeRows(&job, 0, job.srcHeight);
+  resizeColumns(&job, 0, job.dstHeight);
+#endif
+
+  lovrFree(job.horizontal.indices);
+  lovrFree(job.horizontal.weights);
+  lovrFree(job.vertical.indices);
+  lovrFree(job.vertical.weights);
+  lovrFree(job.scratch);
+}
+
+Image* lovrImageResize(Image* image, uint32_t width, uint32_t height, ImageFilter filter) {
+  GetRow* getRow;
+  SetRow* setRow;
+  lovrCheck(width > 0 && height > 0, "Image dimensions must be positive");
+  lovrAssert(getRowFunctions(image->format, &getRow, &setRow), "Unsupported format for Image:resize");
+  Image* result = allocateImage(width, height, image->layers, 1, image->format, image->flags, "Image");
+  for (uint32_t layer = 0; layer < image->layers; layer++) {
+    resizeLayer(image, 0, result, 0, layer, filter);
+  }
+  return result;
+}
+
+// Each level is filtered from the one above it, any existing levels are replaced
+Image* lovrImageGenerateMipmaps(Image* image, ImageFilter filter) {
+  GetRow* getRow;
+  SetRow* setRow;
+  lovrAssert(getRowFunctions(image->format, &getRow, &setRow), "Unsupported format for Image:generateMipmaps");
+  uint32_t levels = 1;
+  while ((image->width | image->height) >> levels) levels++;
+  Image* result = allocateImage(image->width, image->height, image->layers, levels, image->format, image->flags, "Image");
+  for (uint32_t layer = 0; layer < image->layers; layer++) {
+    memcpy(lovrImageGetLayerData(result, 0, layer), lovrImageGetLayerData(image, 0, layer), result->mipmaps[0].size);
+    for (uint32_t level = 1; level < levels; level++) {
+      resizeLayer(result, level - 1, result, level, layer, filter);
+    }
+  }
+  return result;
+}
+
 static uint32_t crc_lookup[256];
 static bool crc_ready = false;
 static void crc_init(void) {
@@ -447,6 +817,572 @@ Blob* lovrImageEncode(Image* image) {
   return lovrBlobCreate(data - size, size, "Encoded Image");
 }
 
+// Bulk operations
+
+typedef enum {
+  PIXEL_FILL,
+  PIXEL_TRANSFORM,
+  PIXEL_COMBINE
+} PixelOpType;
+
+typedef struct {
+  PixelOpType type;
+  ImageOp op;
+  Image* dst;
+  Image* src;
+  GetRow* getDst;
+  SetRow* setDst;
+  GetRow* getSrc;
+  bool normalized;
+  uint32_t dstOffset[2];
+  uint32_t srcOffset[2];
+  uint32_t extent[2];
+  float matrix[16];
+  float bias[4];
+  uint8_t value[16];
+} PixelJob;
+
+// Rows are decoded to floats, operated on, clamped if the format is normalized, and encoded back.
+// Fills skip all of that, since they copy the same encoded pixel everywhere.
+static void processRows(void* arg, uint32_t start, uint32_t end) {
+  PixelJob* job = arg;
+  uint32_t width = job->extent[0];
+  size_t dstPixelSize = measure(1, 1, job->dst->format);
+  size_t srcPixelSize = job->src ? measure(1, 1, job->src->format) : 0;
+
+  if (width == 0) {
+    return;
+  }
+
+  if (job->type == PIXEL_FILL) {
+    size_t size = width * dstPixelSize;
+    for (uint32_t y = start; y < end; y++) {
+      size_t dstIndex = (size_t) (job->dstOffset[1] + y) * job->dst->width + job->dstOffset[0];
+      uint8_t* p = (uint8_t*) job->dst->mipmaps[0].data + dstIndex * dstPixelSize;
+      memcpy(p, job->value, dstPixelSize);
+      for (size_t filled = dstPixelSize; filled < size; filled *= 2) {
+        memcpy(p + filled, p, MIN(filled, size - filled));
+      }
+    }
+    return;
+  }
+
+  size_t count = (size_t) width * 4;
+  float* row = lovrMalloc(count * sizeof(float) * (job->src ? 2 : 1));
+  float* other = row + count;
+
+  for (uint32_t y = start; y < end; y++) {
+    size_t dstIndex = (size_t) (job->dstOffset[1] + y) * job->dst->width + job->dstOffset[0];
+    uint8_t* p = (uint8_t*) job->dst->mipmaps[0].data + dstIndex * dstPixelSize;
+    job->getDst(p, row, width);
+
+    if (job->type == PIXEL_TRANSFORM) {
+      for (uint32_t x = 0; x < width; x++) {
+        float* pixel = row + 4 * x;
+        float result[4];
+        for (uint32_t r = 0; r < 4; r++) {
+          const float* m = job->matrix + 4 * r;
+          result[r] = m[0] * pixel[0] + m[1] * pixel[1] + m[2] * pixel[2] + m[3] * pixel[3] + job->bias[r];
+        }
+        memcpy(pixel, result, sizeof(result));
+      }
+    } else {
+      size_t srcIndex = (size_t) (job->srcOffset[1] + y) * job->src->width + job->srcOffset[0];
+      job->getSrc((uint8_t*) job->src->mipmaps[0].data + srcIndex * srcPixelSize, other, width);
+      switch (job->op) {
+        case IMAGE_OP_ADD: for (size_t i = 0; i < count; i++) row[i] += other[i]; break;
+        case IMAGE_OP_SUBTRACT: for (size_t i = 0; i < count; i++) row[i] -= other[i]; break;
+        case IMAGE_OP_MULTIPLY: for (size_t i = 0; i < count; i++) row[i] *= other[i]; break;
+        case IMAGE_OP_MIN: for (size_t i = 0; i < count; i++) row[i] = MIN(row[i], other[i]); break;
+        case IMAGE_OP_MAX: for (size_t i = 0; i < count; i++) row[i] = MAX(row[i], other[i]); break;
+        case IMAGE_OP_BLEND:
+          for (size_t i = 0; i < count; i += 4) {
+            float* a = row + i;
+            const float* b = other + i;
+            for (uint32_t c = 0; c < 3; c++) a[c] = b[c] * b[3] + a[c] * (1.f - b[3]);
+            a[3] = b[3] + a[3] * (1.f - b[3]);
+          }
+          break;
+        default: lovrUnreachable();
+      }
+    }
+
+    if (job->normalized) {
+      for (size_t i = 0; i < count; i++) row[i] = CLAMP(row[i], 0.f, 1.f);
+    }
+
+    job->setDst(row, p, width);
+  }
+
+  lovrFree(row);
+}
+
+static void runPixelJob(PixelJob* job) {
+#ifndef LOVR_DISABLE_THREAD
+  job_parallel_for(job->extent[1], 16, processRows, job);
+#else
+  processRows(job, 0, job->extent[1]);
+#endif
+}
+
+bool lovrImageFill(Image* image, uint32_t offset[2], uint32_t extent[2], float color[4]) {
+  PixelJob job = { .type = PIXEL_FILL, .dst = image };
+  lovrAssert(getRowFunctions(image->format, &job.getDst, &job.setDst), "Unsupported format for Image:fill");
+  lovrCheck(offset[0] + extent[0] <= image->width, "Pixel rectangle must be within Image bounds");
+  lovrCheck(offset[1] + extent[1] <= image->height, "Pixel rectangle must be within Image bounds");
+  memcpy(job.dstOffset, offset, sizeof(job.dstOffset));
+  memcpy(job.extent, extent, sizeof(job.extent));
+
+  // Every pixel is the same, so it only needs to be encoded once
+  float clamped[4];
+  for (uint32_t c = 0; c < 4; c++) {
+    clamped[c] = image->format <= FORMAT_RGBA16 ? CLAMP(color[c], 0.f, 1.f) : color[c];
+  }
+  job.setDst(clamped, job.value, 1);
+
+  runPixelJob(&job);
+  return true;
+}
+
+// The matrix is row major, so each output channel is a row dotted with the input color, plus bias
+bool lovrImageTransform(Image* image, uint32_t offset[2], uint32_t extent[2], float matrix[16], float bias[4]) {
+  PixelJob job = { .type = PIXEL_TRANSFORM, .dst = image, .normalized = image->format <= FORMAT_RGBA16 };
+  lovrAssert(getRowFunctions(image->format, &job.getDst, &job.setDst), "Unsupported format for Image:transform");
+  lovrCheck(offset[0] + extent[0] <= image->width, "Pixel rectangle must be within Image bounds");
+  lovrCheck(offset[1] + extent[1] <= image->height, "Pixel rectangle must be within Image bounds");
+  memcpy(job.dstOffset, offset, sizeof(job.dstOffset));
+  memcpy(job.extent, extent, sizeof(job.extent));
+  memcpy(job.matrix, matrix, sizeof(job.matrix));
+  memcpy(job.bias, bias, sizeof(job.bias));
+  runPixelJob(&job);
+  return true;
+}
+
+// The Images can have different formats, since pixels are converted to floats to combine them
+bool lovrImageCombine(Image* dst, Image* src, ImageOp op, uint32_t srcOffset[2], uint32_t dstOffset[2], uint32_t extent[2]) {
+  SetRow* setRow;
+  PixelJob job = { .type = PIXEL_COMBINE, .op = op, .dst = dst, .src = src, .normalized = dst->format <= FORMAT_RGBA16 };
+  lovrCheck(src != dst, "An Image can not be combined with itself");
+  lovrAssert(getRowFunctions(dst->format, &job.getDst, &job.setDst), "Unsupported format for Image:combine");
+  lovrAssert(getRowFunctions(src->format, &job.getSrc, &setRow), "Unsupported format for Image:combine");
+  lovrCheck(dstOffset[0] + extent[0] <= dst->width, "Image region extends past the destination image width");
+  lovrCheck(dstOffset[1] + extent[1] <= dst->height, "Image region extends past the destination image height");
+  lovrCheck(srcOffset[0] + extent[0] <= src->width, "Image region extends past the source image width");
+  lovrCheck(srcOffset[1] + extent[1] <= src->height, "Image region extends past the source image height");
+  memcpy(job.dstOffset, dstOffset, sizeof(job.dstOffset));
+  memcpy(job.srcOffset, srcOffset, sizeof(job.srcOffset));
+  memcpy(job.extent, extent, sizeof(job.extent));
+  runPixelJob(&job);
+  return true;
+}
+
+typedef struct {
+  Image* src;
+  Image* dst;
+  GetRow* getRow;
+  SetRow* setRow;
+  bool normalized;
+  uint32_t level;
+  uint32_t layer;
+} ConvertJob;
+
+static void convertRows(void* arg, uint32_t start, uint32_t end) {
+  ConvertJob* job = arg;
+  uint32_t width = lovrImageGetWidth(job->src, job->level);
+  size_t srcRowSize = measure(width, 1, job->src->format);
+  size_t dstRowSize = measure(width, 1, job->dst->format);
+  const uint8_t* p = (const uint8_t*) lovrImageGetLayerData(job->src, job->level, job->layer) + start * srcRowSize;
+  uint8_t* q = (uint8_t*) lovrImageGetLayerData(job->dst, job->level, job->layer) + start * dstRowSize;
+  size_t count = (size_t) width * 4;
+  float* row = lovrMalloc(count * sizeof(float));
+
+  for (uint32_t y = start; y < end; y++, p += srcRowSize, q += dstRowSize) {
+    job->getRow(p, row, width);
+    if (job->normalized) {
+      for (size_t i = 0; i < count; i++) row[i] = CLAMP(row[i], 0.f, 1.f);
+    }
+    job->setRow(row, q, width);
+  }
+
+  lovrFree(row);
+}
+
+Image* lovrImageConvert(Image* image, TextureFormat format) {
+  GetRow* getRow;
+  SetRow* setRow;
+  ConvertJob job = { .src = image, .normalized = format <= FORMAT_RGBA16 };
+  lovrAssert(getRowFunctions(image->format, &job.getRow, &setRow), "Unsupported format for Image:convert");
+  lovrAssert(getRowFunctions(format, &getRow, &job.setRow), "Unsupported format for Image:convert");
+  job.dst = allocateImage(image->width, image->height, image->layers, image->levels, format, image->flags, "Image");
+
+  for (job.level = 0; job.level < image->levels; job.level++) {
+    uint32_t height = lovrImageGetHeight(image, job.level);
+    for (job.layer = 0; job.layer < image->layers; job.layer++) {
+#ifndef LOVR_DISABLE_THREAD
+      job_parallel_for(height, 16, convertRows, &job);
+#else
+      convertRows(&job, 0, height);
+#endif
+    }
+  }
+
+  return job.dst;
+}
+
+// Compression
+
+// Finds the line through a block's colors that captures the most variance, using a few rounds of
+// power iteration on the covariance matrix.  Returns false if the block is a single color.
+static bool fitBlock(float pixels[16][4], uint32_t count, uint32_t channels, float mean[4], float axis[4], float* tmin, float* tmax) {
+  float cov[4][4] = { 0 };
+
+  for (uint32_t c = 0; c < channels; c++) {
+    mean[c] = 0.f;
+    for (uint32_t i = 0; i < count; i++) mean[c] += pixels[i][c];
+    mean[c] /= count;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    for (uint32_t a = 0; a < channels; a++) {
+      for (uint32_t b = a; b < channels; b++) {
+        cov[a][b] += (pixels[i][a] - mean[a]) * (pixels[i][b] - mean[b]);
+      }
+    }
+  }
+
+  for (uint32_t a = 0; a < channels; a++) {
+    for (uint32_t b = 0; b < a; b++) {
+      cov[a][b] = cov[b][a];
+    }
+  }
+
+  // Starting from the covariance row of the channel that varies the most, since a fixed starting
+  // vector can be orthogonal to the axis (e.g. when two channels are anticorrelated)
+  uint32_t widest = 0;
+  for (uint32_t c = 1; c < channels; c++) {
+    if (cov[c][c] > cov[widest][widest]) widest = c;
+  }
+
+  float v[4] = { 0.f };
+  memcpy(v, cov[widest], channels * sizeof(float));
+  float length = 0.f;
+
+  for (uint32_t iteration = 0; iteration < 8; iteration++) {
+    float w[4] = { 0.f };
+    length = 0.f;
+    for (uint32_t a = 0; a < channels; a++) {
+      for (uint32_t b = 0; b < channels; b++) w[a] += cov[a][b] * v[b];
+      length += w[a] * w[a];
+    }
+    if (length < 1e-6f) break;
+    length = sqrtf(length);
+    for (uint32_t a = 0; a < channels; a++) v[a] = w[a] / length;
+  }
+
+  if (length < 1e-6f) {
+    memset(axis, 0, channels * sizeof(float));
+    *tmin = *tmax = 0.f;
+    return false;
+  }
+
+  *tmin = FLT_MAX;
+  *tmax = -FLT_MAX;
+  for (uint32_t i = 0; i < count; i++) {
+    float t = 0.f;
+    for (uint32_t c = 0; c < channels; c++) t += (pixels[i][c] - mean[c]) * v[c];
+    *tmin = MIN(*tmin, t);
+    *tmax = MAX(*tmax, t);
+  }
+
+  memcpy(axis, v, channels * sizeof(float));
+  return true;
+}
+
+static uint32_t nearestColor(float pixel[4], int palette[][4], uint32_t count, uint32_t channels) {
+  uint32_t best = 0;
+  float bestError = FLT_MAX;
+  for (uint32_t i = 0; i < count; i++) {
+    float error = 0.f;
+    for (uint32_t c = 0; c < channels; c++) {
+      float d = pixel[c] - palette[i][c];
+      error += d * d;
+    }
+    if (error < bestError) {
+      bestError = error;
+      best = i;
+    }
+  }
+  return best;
+}
+
+static uint16_t pack565(float color[3]) {
+  uint32_t r = (uint32_t) (CLAMP(color[0], 0.f, 255.f) * 31.f / 255.f + .5f);
+  uint32_t g = (uint32_t) (CLAMP(color[1], 0.f, 255.f) * 63.f / 255.f + .5f);
+  uint32_t b = (uint32_t) (CLAMP(color[2], 0.f, 255.f) * 31.f / 255.f + .5f);
+  return (uint16_t) (r << 11 | g << 5 | b);
+}
+
+static void unpack565(uint16_t color, int rgb[4]) {
+  uint32_t r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+  rgb[0] = (int) (r << 3 | r >> 2);
+  rgb[1] = (int) (g << 2 | g >> 4);
+  rgb[2] = (int) (b << 3 | b >> 2);
+  rgb[3] = 255;
+}
+
+// With punchthrough, pixels with alpha below 128 use the transparent entry of the 3 color mode
+static void encodeBC1(float block[16][4], uint8_t out[8], bool punchthrough) {
+  float pixels[16][4];
+  uint32_t count = 0;
+  bool transparent = false;
+
+  for (uint32_t i = 0; i < 16; i++) {
+    if (punchthrough && block[i][3] < 128.f) {
+      transparent = true;
+    } else {
+      memcpy(pixels[count++], block[i], sizeof(pixels[0]));
+    }
+  }
+
+  if (count == 0) {
+    memcpy(out, (uint8_t[8]) { 0, 0, 0, 0, 0xff, 0xff, 0xff, 0xff }, 8);
+    return;
+  }
+
+  float mean[4], axis[4], tmin, tmax, lo[3], hi[3];
+  fitBlock(pixels, count, 3, mean, axis, &tmin, &tmax);
+  for (uint32_t c = 0; c < 3; c++) {
+    lo[c] = mean[c] + axis[c] * tmin;
+    hi[c] = mean[c] + axis[c] * tmax;
+  }
+
+  uint16_t c0 = pack565(hi);
+  uint16_t c1 = pack565(lo);
+
+  // 4 color mode needs c0 > c1 and 3 color mode needs c0 <= c1
+  if (transparent ? c0 > c1 : c0 < c1) {
+    uint16_t tmp = c0;
+    c0 = c1;
+    c1 = tmp;
+  }
+
+  int palette[4][4];
+  unpack565(c0, palette[0]);
+  unpack565(c1, palette[1]);
+  for (uint32_t c = 0; c < 3; c++) {
+    if (c0 > c1) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    } else {
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+    }
+  }
+
+  uint32_t indices = 0;
+  for (uint32_t i = 0; i < 16; i++) {
+    uint32_t index;
+    if (punchthrough && block[i][3] < 128.f) {
+      index = 3;
+    } else {
+      index = nearestColor(block[i], palette, c0 > c1 ? 4 : 3, 3);
+    }
+    indices |= index << (2 * i);
+  }
+
+  memcpy(out + 0, &c0, 2);
+  memcpy(out + 2, &c1, 2);
+  memcpy(out + 4, &indices, 4);
+}
+
+static void encodeBC4(float block[16][4], uint32_t channel, uint8_t out[8]) {
+  uint8_t lo = 255, hi = 0;
+  for (uint32_t i = 0; i < 16; i++) {
+    uint8_t v = (uint8_t) block[i][channel];
+    lo = MIN(lo, v);
+    hi = MAX(hi, v);
+  }
+
+  // Using the 8 value mode, index 0 is hi, 1 is lo, and 2-7 step from hi to lo
+  uint64_t indices = 0;
+  if (hi > lo) {
+    for (uint32_t i = 0; i < 16; i++) {
+      uint32_t step = ((hi - (uint32_t) block[i][channel]) * 14 + (hi - lo)) / (2 * (hi - lo));
+      uint64_t index = step == 0 ? 0 : (step == 7 ? 1 : step + 1);
+      indices |= index << (3 * i);
+    }
+  }
+
+  out[0] = hi;
+  out[1] = lo;
+  for (uint32_t i = 0; i < 6; i++) {
+    out[2 + i] = (uint8_t) (indices >> (8 * i));
+  }
+}
+
+static void writeBits(uint8_t* out, uint32_t* cursor, uint32_t value, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++, (*cursor)++) {
+    out[*cursor >> 3] |= ((value >> i) & 1) << (*cursor & 7);
+  }
+}
+
+// Only uses mode 6, which has one RGBA line with 7 bit endpoints + a p-bit each and 4 bit indices.
+// It's the most versatile single mode, and avoids searching partitions.
+static void encodeBC7(float block[16][4], uint8_t out[16]) {
+  static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+  float mean[4], axis[4], tmin, tmax, ends[2][4];
+  fitBlock(block, 16, 4, mean, axis, &tmin, &tmax);
+  for (uint32_t c = 0; c < 4; c++) {
+    ends[0][c] = CLAMP(mean[c] + axis[c] * tmin, 0.f, 255.f);
+    ends[1][c] = CLAMP(mean[c] + axis[c] * tmax, 0.f, 255.f);
+  }
+
+  // The p-bit is the shared low bit of every channel in an endpoint, pick whichever is closer
+  uint32_t q[2][4], p[2];
+  for (uint32_t e = 0; e < 2; e++) {
+    float bestError = FLT_MAX;
+    for (uint32_t bit = 0; bit < 2; bit++) {
+      float error = 0.f;
+      uint32_t candidate[4];
+      for (uint32_t c = 0; c < 4; c++) {
+        candidate[c] = (uint32_t) CLAMP((ends[e][c] - bit) / 2.f + .5f, 0.f, 127.f);
+        float d = (float) (candidate[c] << 1 | bit) - ends[e][c];
+        error += d * d;
+      }
+      if (error < bestError) {
+        bestError = error;
+        memcpy(q[e], candidate, sizeof(candidate));
+        p[e] = bit;
+      }
+    }
+  }
+
+  int palette[16][4];
+  for (uint32_t i = 0; i < 16; i++) {
+    for (uint32_t c = 0; c < 4; c++) {
+      int a = (int) (q[0][c] << 1 | p[0]);
+      int b = (int) (q[1][c] << 1 | p[1]);
+      palette[i][c] = ((64 - weights[i]) * a + weights[i] * b + 32) >> 6;
+    }
+  }
+
+  uint32_t indices[16];
+  for (uint32_t i = 0; i < 16; i++) {
+    indices[i] = nearestColor(block[i], palette, 16, 4);
+  }
+
+  // The first index only has 3 bits, so its high bit has to be zero
+  if (indices[0] & 8) {
+    uint32_t tq[4];
+    memcpy(tq, q[0], sizeof(tq));
+    memcpy(q[0], q[1], sizeof(tq));
+    memcpy(q[1], tq, sizeof(tq));
+    uint32_t tp = p[0];
+    p[0] = p[1];
+    p[1] = tp;
+    for (uint32_t i = 0; i < 16; i++) indices[i] = 15 - indices[i];
+  }
+
+  uint32_t cursor = 0;
+  memset(out, 0, 16);
+  writeBits(out, &cursor, 1 << 6, 7);
+  for (uint32_t c = 0; c < 4; c++) {
+    writeBits(out, &cursor, q[0][c], 7);
+    writeBits(out, &cursor, q[1][c], 7);
+  }
+  writeBits(out, &cursor, p[0], 1);
+  writeBits(out, &cursor, p[1], 1);
+  for (uint32_t i = 0; i < 16; i++) {
+    writeBits(out, &cursor, indices[i], i == 0 ? 3 : 4);
+  }
+}
+
+typedef struct {
+  const uint8_t* pixels;
+  uint8_t* blocks;
+  uint32_t width;
+  uint32_t height;
+  uint32_t channels;
+  TextureFormat format;
+} CompressJob;
+
+// Blocks along the right and bottom edges repeat the last row/column to fill out the 4x4 block
+static void compressRows(void* arg, uint32_t start, uint32_t end) {
+  CompressJob* job = arg;
+  uint32_t blocksWide = (job->width + 3) / 4;
+  size_t blockSize = job->format == FORMAT_BC1 || job->format == FORMAT_BC4U ? 8 : 16;
+  float block[16][4];
+
+  for (uint32_t by = start; by < end; by++) {
+    uint8_t* out = job->blocks + by * blocksWide * blockSize;
+    for (uint32_t bx = 0; bx < blocksWide; bx++, out += blockSize) {
+      for (uint32_t i = 0; i < 16; i++) {
+        uint32_t x = MIN(bx * 4 + (i & 3), job->width - 1);
+        uint32_t y = MIN(by * 4 + (i >> 2), job->height - 1);
+        const uint8_t* p = job->pixels + ((size_t) y * job->width + x) * job->channels;
+        block[i][0] = p[0];
+        block[i][1] = job->channels > 1 ? p[1] : 0.f;
+        block[i][2] = job->channels > 2 ? p[2] : 0.f;
+        block[i][3] = job->channels > 3 ? p[3] : 255.f;
+      }
+
+      switch (job->format) {
+        case FORMAT_BC1: encodeBC1(block, out, true); break;
+        case FORMAT_BC3: encodeBC4(block, 3, out); encodeBC1(block, out + 8, false); break;
+        case FORMAT_BC4U: encodeBC4(block, 0, out); break;
+        case FORMAT_BC5U: encodeBC4(block, 0, out); encodeBC4(block, 1, out + 8); break;
+        case FORMAT_BC7: encodeBC7(block, out); break;
+        default: lovrUnreachable();
+      }
+    }
+  }
+}
+
+Image* lovrImageCompress(Image* image, TextureFormat format) {
+  uint32_t channels;
+  switch (image->format) {
+    case FORMAT_R8: channels = 1; break;
+    case FORMAT_RG8: channels = 2; break;
+    case FORMAT_RGBA8: channels = 4; break;
+    default: lovrSetError("Only r8, rg8, and rgba8 images can be compressed"); return NULL;
+  }
+
+  switch (format) {
+    case FORMAT_BC1: case FORMAT_BC3: case FORMAT_BC4U: case FORMAT_BC5U: case FORMAT_BC7: break;
+    default: lovrSetError("Images can only be compressed to bc1, bc3, bc4u, bc5u, or bc7"); return NULL;
+  }
+
+  Image* result = allocateImage(image->width, image->height, image->layers, image->levels, format, image->flags, "Compressed Image");
+
+  // BC4 and BC5 don't have sRGB variants
+  if (format == FORMAT_BC4U || format == FORMAT_BC5U) {
+    result->flags &= ~IMAGE_SRGB;
+  }
+
+  for (uint32_t i = 0; i < image->levels; i++) {
+    uint32_t width = lovrImageGetWidth(image, i);
+    uint32_t height = lovrImageGetHeight(image, i);
+
+    for (uint32_t layer = 0; layer < image->layers; layer++) {
+      CompressJob job = {
+        .pixels = lovrImageGetLayerData(image, i, layer),
+        .blocks = lovrImageGetLayerData(result, i, layer),
+        .width = width,
+        .height = height,
+        .channels = channels,
+        .format = format
+      };
+
+#ifndef LOVR_DISABLE_THREAD
+      job_parallel_for((height + 3) / 4, 4, compressRows, &job);
+#else
+      compressRows(&job, 0, (height + 3) / 4);
+#endif
+    }
+  }
+
+  return result;
+}
+
 static bool loadDDS(Blob* blob, Image** result) {
   enum { DDPF_FOURCC = 0x4, DDPF_RGB = 0x40 };
   enum { DDSD_DEPTH = 0x800000 };
@@ -1213,45 +2149,99 @@ static bool loadKTX2(Blob* blob, Image** result) {
   return true;
 }
 
-static bool loadSTB(Blob* blob, Image** result) {
-  void* data;
-  uint32_t flags = 0;
-  TextureFormat format;
-  int width, height, channels;
+// Picks the format stb_image will decode the file to, compact keeps 1 and 2 channel images small.
+// The width is zero if stb_image doesn't recognize the file.
+static bool getSTBInfo(Blob* blob, bool compact, ImageFileInfo* info, int* channels) {
+  int w, h, n;
+  info->width = 0;
+
+  if (blob->size > INT_MAX || !stbi_info_from_memory(blob->data, (int) blob->size, &w, &h, &n)) {
+    return true;
+  }
+
   if (stbi_is_16_bit_from_memory(blob->data, (int) blob->size)) {
-    data = stbi_load_16_from_memory(blob->data, (int) blob->size, &width, &height, &channels, 0);
-    switch (channels) {
-      case 1: format = FORMAT_R16; break;
-      case 2: format = FORMAT_RG16; break;
-      case 4: format = FORMAT_RGBA16; break;
-      default: return lovrSetError("Unsupported channel count for 16 bit image: %d", channels);
+    switch (n) {
+      case 1: info->format = FORMAT_R16; break;
+      case 2: info->format = FORMAT_RG16; break;
+      case 4: info->format = FORMAT_RGBA16; break;
+      default: return lovrSetError("Unsupported channel count for 16 bit image: %d", n);
     }
-    flags = IMAGE_SRGB;
+    *channels = 0;
   } else if (stbi_is_hdr_from_memory(blob->data, (int) blob->size)) {
-    data = stbi_loadf_from_memory(blob->data, (int) blob->size, &width, &height, NULL, 4);
-    format = FORMAT_RGBA32F;
+    info->format = FORMAT_RGBA32F;
+    *channels = 4;
+  } else if (compact && n <= 2) {
+    info->format = n == 1 ? FORMAT_R8 : FORMAT_RG8;
+    *channels = n;
   } else {
-    data = stbi_load_from_memory(blob->data, (int) blob->size, &width, &height, NULL, 4);
-    format = FORMAT_RGBA8;
-    flags = IMAGE_SRGB;
+    info->format = FORMAT_RGBA8;
+    *channels = 4;
   }
 
+  info->width = w;
+  info->height = h;
+  info->srgb = info->format != FORMAT_RGBA32F;
+  info->size = measure(w, h, info->format);
+  return true;
+}
+
+static void* loadSTBPixels(Blob* blob, TextureFormat format, int channels) {
+  int width, height, n;
+  switch (format) {
+    case FORMAT_R16: case FORMAT_RG16: case FORMAT_RGBA16:
+      return stbi_load_16_from_memory(blob->data, (int) blob->size, &width, &height, &n, channels);
+    case FORMAT_RGBA32F:
+      return stbi_loadf_from_memory(blob->data, (int) blob->size, &width, &height, &n, channels);
+    default:
+      return stbi_load_from_memory(blob->data, (int) blob->size, &width, &height, &n, channels);
+  }
+}
+
+static bool loadSTB(Blob* blob, bool compact, Image** result) {
+  int channels;
+  ImageFileInfo info;
+
+  if (!getSTBInfo(blob, compact, &info, &channels)) {
+    return false;
+  }
+
+  void* data = info.width > 0 ? loadSTBPixels(blob, info.format, channels) : NULL;
+
   if (!data) {
     return true;
   }
 
-  size_t size = measure(width, height, format);
-
   Image* image = lovrCalloc(sizeof(Image));
   image->ref = 1;
-  image->flags = flags;
-  image->width = width;
-  image->height = height;
-  image->format = format;
+  image->flags = info.srgb ? IMAGE_SRGB : 0;
+  image->width = info.width;
+  image->height = info.height;
+  image->format = info.format;
   image->layers = 1;
   image->levels = 1;
-  image->blob = lovrBlobCreate(data, size, blob->name);
-  image->mipmaps[0] = (Mipmap) { data, size, 0 };
+  image->blob = lovrBlobCreate(data, info.size, blob->name);
+  image->mipmaps[0] = (Mipmap) { data, info.size, 0 };
   *result = image;
   return true;
 }
+
+// The width is zero for files that lovrImageDecode can't handle (anything other than PNG/JPG/HDR),
+// those have to go through lovrImageCreateFromFile instead
+bool lovrImageGetFileInfo(Blob* blob, bool compact, ImageFileInfo* info) {
+  int channels;
+  return getSTBInfo(blob, compact, info, &channels);
+}
+
+// Decodes straight into memory owned by the caller (e.g. a mapped staging buffer), skipping the Blob
+bool lovrImageDecode(Blob* blob, bool compact, void* buffer, size_t size) {
+  int channels;
+  ImageFileInfo info;
+  if (!getSTBInfo(blob, compact, &info, &channels)) return false;
+  lovrAssert(info.width > 0, "Could not decode image from '%s': Only PNG, JPG, and HDR files are supported", blob->name);
+  lovrCheck(size >= info.size, "Buffer is too small to decode image (need %d bytes, got %d)", (int) info.size, (int) size);
+  void* data = loadSTBPixels(blob, info.format, channels);
+  lovrAssert(data, "Could not decode image from '%s': %s", blob->name, stbi_failure_reason());
+  memcpy(buffer, data, info.size);
+  stbi_image_free(data);
+  return true;
+}
@@ -54,12 +54,38 @@ typedef enum {
   FORMAT_ASTC_12x12
 } TextureFormat;
 
+typedef enum {
+  IMAGE_FILTER_BOX,
+  IMAGE_FILTER_KAISER,
+  IMAGE_FILTER_LANCZOS
+} ImageFilter;
+
+typedef enum {
+  IMAGE_OP_ADD,
+  IMAGE_OP_SUBTRACT,
+  IMAGE_OP_MULTIPLY,
+  IMAGE_OP_MIN,
+  IMAGE_OP_MAX,
+  IMAGE_OP_BLEND
+} ImageOp;
+
 typedef void MapPixelCallback(void* userdata, uint32_t x, uint32_t y, float pixel[4]);
 
 typedef struct Image Image;
 
+typedef struct {
+  uint32_t width;
+  uint32_t height;
+  TextureFormat format;
+  bool srgb;
+  size_t size;
+} ImageFileInfo;
+
 Image* lovrImageCreateRaw(uint32_t width, uint32_t height, TextureFormat format, bool srgb);
 Image* lovrImageCreateFromFile(struct Blob* blob);
+bool lovrImageCreateFromFiles(struct Blob** blobs, uint32_t count, bool compact, Image** images);
+bool lovrImageGetFileInfo(struct Blob* blob, bool compact, ImageFileInfo* info);
+bool lovrImageDecode(struct Blob* blob, bool compact, void* buffer, size_t size);
 void lovrImageDestroy(void* ref);
 bool lovrImageIsSRGB(Image* image);
 bool lovrImageIsPremultiplied(Image* image);
@@ -78,4 +104,11 @@ bool lovrImageGetPixel(Image* image, uint32_t x, uint32_t y, float pixel[4]);
 bool lovrImageSetPixel(Image* image, uint32_t x, uint32_t y, float pixel[4]);
 bool lovrImageMapPixel(Image* image, uint32_t x, uint32_t y, uint32_t w, uint32_t h, MapPixelCallback* callback, void* userdata);
 bool lovrImageCopy(Image* src, Image* dst, uint32_t srcOffset[2], uint32_t dstOffset[2], uint32_t extent[2]);
+Image* lovrImageResize(Image* image, uint32_t width, uint32_t height, ImageFilter filter);
+Image* lovrImageGenerateMipmaps(Image* image, ImageFilter filter);
+bool lovrImageFill(Image* image, uint32_t offset[2], uint32_t extent[2], float color[4]);
+bool lovrImageTransform(Image* image, uint32_t offset[2], uint32_t extent[2], float matrix[16], float bias[4]);
+bool lovrImageCombine(Image* dst, Image* src, ImageOp op, uint32_t srcOffset[2], uint32_t dstOffset[2], uint32_t extent[2]);
+Image* lovrImageConvert(Image* image, TextureFormat format);
 struct Blob* lovrImageEncode(Image* image);
+Image* lovrImageCompress(Image* image, TextureFormat format);
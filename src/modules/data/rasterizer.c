@@ -32,6 +32,7 @@ struct Rasterizer {
   map_t kerning;
   Blob* blob;
   Image* atlas;
+  uint64_t hash;
   stbtt_fontinfo font;
   arr_t(Glyph) glyphs;
   map_t glyphLookup;
@@ -350,6 +351,18 @@ RasterizerType lovrRasterizerGetType(Rasterizer* rasterizer) {
   return rasterizer->type;
 }
 
+// Identifies the font data and size, computed on first use since hashing a big font isn't free
+uint64_t lovrRasterizerGetHash(Rasterizer* rasterizer) {
+  if (!rasterizer->hash) {
+    const void* data = rasterizer->blob ? rasterizer->blob->data : etc_VarelaRound_ttf;
+    size_t size = rasterizer->blob ? rasterizer->blob->size : etc_VarelaRound_ttf_len;
+    struct { uint64_t data; uint32_t type; float size; } key = { hash64(data, size), rasterizer->type, rasterizer->size };
+    rasterizer->hash = hash64(&key, sizeof(key));
+  }
+
+  return rasterizer->hash;
+}
+
 float lovrRasterizerGetFontSize(Rasterizer* rasterizer) {
   return rasterizer->size;
 }
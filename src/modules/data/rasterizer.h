@@ -20,6 +20,7 @@ Rasterizer* lovrRasterizerCreate(struct Blob* blob, float size, RasterizerIO* io
 void lovrRasterizerDestroy(void* ref);
 RasterizerType lovrRasterizerGetType(Rasterizer* rasterizer);
 float lovrRasterizerGetFontSize(Rasterizer* rasterizer);
+uint64_t lovrRasterizerGetHash(Rasterizer* rasterizer);
 size_t lovrRasterizerGetGlyphCount(Rasterizer* rasterizer);
 bool lovrRasterizerHasGlyph(Rasterizer* rasterizer, uint32_t codepoint);
 bool lovrRasterizerHasGlyphs(Rasterizer* rasterizer, const char* str, size_t length);
@@ -22,8 +22,8 @@ typedef struct {
   uint32_t nextSibling;
   const char* filename;
   const void* data;
-  uint32_t compressedSize;
-  uint32_t uncompressedSize;
+  uint64_t compressedSize;
+  uint64_t uncompressedSize;
   uint16_t filenameLength;
   uint16_t mtime;
   uint16_t mdate;
@@ -31,12 +31,24 @@ typedef struct {
   bool compressed;
 } zip_node;
 
+#define ZIP_CHECKPOINT_INTERVAL (1 << 20)
+
+// A snapshot of the inflate state at a chunk boundary, so seeks can resume from it
+typedef struct {
+  size_t inputCursor;
+  size_t outputCursor;
+  tinfl_decompressor decompressor;
+  uint8_t window[TINFL_LZ_DICT_SIZE];
+} zip_checkpoint;
+
 typedef struct {
   size_t inputCursor;
   size_t outputCursor;
   size_t bufferExtent;
-  uint8_t buffer[32768];
+  uint8_t buffer[TINFL_LZ_DICT_SIZE];
   tinfl_decompressor decompressor;
+  bool indexing;
+  arr_t(zip_checkpoint*) checkpoints;
 } zip_stream;
 
 typedef struct {
@@ -674,6 +686,7 @@ static void dir_list(Archive* archive, const char* path, fs_list_cb callback, vo
 
 static uint16_t readu16(const uint8_t* p) { uint16_t x; memcpy(&x, p, sizeof(x)); return x; }
 static uint32_t readu32(const uint8_t* p) { uint32_t x; memcpy(&x, p, sizeof(x)); return x; }
+static uint64_t readu64(const uint8_t* p) { uint64_t x; memcpy(&x, p, sizeof(x)); return x; }
 
 static void zip_free(Archive* archive) {
   arr_free(&archive->nodes);
@@ -687,26 +700,63 @@ static bool zip_init(Archive* archive, const char* filename, const char* root) {
     return false;
   }
 
-  // Check the end of the file for the magic zip footer
-  const uint8_t* p = archive->data + archive->size - 22;
-  if (archive->size < 22 || readu32(p) != 0x06054b50) {
+  // Search backwards from the end of the file for the magic zip footer, skipping past the comment
+  const uint8_t* p = NULL;
+  if (archive->size >= 22) {
+    size_t limit = archive->size - 22 > 65535 ? archive->size - 22 - 65535 : 0;
+    for (size_t offset = archive->size - 22; !p; offset--) {
+      const uint8_t* footer = archive->data + offset;
+      if (readu32(footer) == 0x06054b50 && offset + 22 + readu16(footer + 20) <= archive->size) {
+        p = footer;
+      }
+      if (offset == limit) break;
+    }
+  }
+
+  if (!p) {
     fs_unmap(archive->data, archive->size);
-    return lovrSetError("End of central directory signature not found (note: zip files with comments are not supported)");
+    return lovrSetError("End of central directory signature not found");
   }
 
-  // Parse the number of file entries and reserve memory
-  uint16_t nodeCount = readu16(p + 10);
+  uint64_t nodeCount = readu16(p + 10);
+  uint64_t directorySize = readu32(p + 12);
+  uint64_t cursor = readu32(p + 16);
+  uint64_t footerOffset = p - archive->data;
+
+  // Zip64 archives put the real counts and offsets in a second footer, found using a locator that
+  // comes right before the regular one
+  if (footerOffset >= 20 && readu32(p - 20) == 0x07064b50) {
+    uint64_t offset = readu64(p - 20 + 8);
+    const uint8_t* footer = archive->data + offset;
+
+    if (footerOffset < 76 || offset > footerOffset - 76 || readu32(footer) != 0x06064b50) {
+      fs_unmap(archive->data, archive->size);
+      return lovrSetError("Corrupt ZIP: invalid Zip64 end of central directory");
+    }
+
+    nodeCount = readu64(footer + 32);
+    directorySize = readu64(footer + 40);
+    cursor = readu64(footer + 48);
+    footerOffset = offset;
+  }
+
+  // Every entry takes at least 46 bytes, which bounds the count for the allocations below
+  if (nodeCount > archive->size / 46) {
+    fs_unmap(archive->data, archive->size);
+    return lovrSetError("Corrupt ZIP: too many files");
+  }
+
+  // Reserve memory for the nodes (directories are added as they're found)
   arr_init(&archive->nodes);
-  arr_reserve(&archive->nodes, nodeCount);
-  map_init(&archive->lookup, nodeCount);
+  arr_reserve(&archive->nodes, nodeCount + 1);
+  map_init(&archive->lookup, (uint32_t) nodeCount);
 
   zip_node rootNode;
   memset(&rootNode, 0xff, sizeof(zip_node));
   arr_push(&archive->nodes, rootNode);
 
   // See where the zip thinks its central directory is
-  uint64_t cursor = readu32(p + 16);
-  if (cursor + 4 > archive->size) {
+  if (cursor > archive->size - 4) {
     zip_free(archive);
     return lovrSetError("Corrupt ZIP: central directory is located past the end of the file");
   }
@@ -714,14 +764,14 @@ static bool zip_init(Archive* archive, const char* filename, const char* root) {
   // See if the central directory starts where the endOfCentralDirectory said it would.
   // If it doesn't, then it might be a self-extracting archive with broken offsets (common).
   // In this case, assume the central directory is directly adjacent to the endOfCentralDirectory,
-  // located at (offsetOfEndOfCentralDirectory (aka size - 22) - sizeOfCentralDirectory).
+  // located at (offsetOfEndOfCentralDirectory - sizeOfCentralDirectory).
   // If we find a central directory there, then compute a "base" offset that equals the difference
   // between where it is and where it was supposed to be, and apply this offset to everything else.
   uint64_t base = 0;
   if (readu32(archive->data + cursor) != 0x02014b50) {
-    size_t offsetOfEndOfCentralDirectory = archive->size - 22;
-    size_t sizeOfCentralDirectory = readu32(p + 12);
-    size_t centralDirectoryOffset = offsetOfEndOfCentralDirectory - sizeOfCentralDirectory;
+    uint64_t offsetOfEndOfCentralDirectory = footerOffset;
+    uint64_t sizeOfCentralDirectory = directorySize;
+    uint64_t centralDirectoryOffset = offsetOfEndOfCentralDirectory - sizeOfCentralDirectory;
 
     if (sizeOfCentralDirectory > offsetOfEndOfCentralDirectory || centralDirectoryOffset + 4 > archive->size) {
       zip_free(archive);
@@ -744,7 +794,7 @@ static bool zip_init(Archive* archive, const char* filename, const char* root) {
   while (root && root[rootLength - 1] == '/') rootLength--;
 
   // Iterate the list of files in the zip and build up a tree of nodes
-  for (uint32_t i = 0; i < nodeCount; i++) {
+  for (uint64_t i = 0; i < nodeCount; i++) {
     p = archive->data + cursor;
     if (cursor + 46 > archive->size || readu32(p) != 0x02014b50) {
       zip_free(archive);
@@ -762,10 +812,35 @@ static bool zip_init(Archive* archive, const char* filename, const char* root) {
     node.directory = false;
     size_t length = readu16(p + 28);
     const char* path = (const char*) (p + 46);
+    uint64_t headerOffset = readu32(p + 42);
+    uint16_t extraLength = readu16(p + 30);
     cursor += 46 + readu16(p + 28) + readu16(p + 30) + readu16(p + 32);
 
+    if (cursor > archive->size) {
+      zip_free(archive);
+      return lovrSetError("Corrupt ZIP: central directory entry extends past the end of the file");
+    }
+
+    // Fields that don't fit in 32 bits are 0xffffffff, with the real values in the Zip64 extra field
+    const uint8_t* extra = p + 46 + length;
+    for (const uint8_t* e = extra; e + 4 <= extra + extraLength; e += 4 + readu16(e + 2)) {
+      const uint8_t* field = e + 4;
+      const uint8_t* end = field + readu16(e + 2);
+
+      if (end > extra + extraLength) {
+        break;
+      }
+
+      if (readu16(e) == 0x0001) {
+        if (node.uncompressedSize == 0xffffffff && field + 8 <= end) node.uncompressedSize = readu64(field), field += 8;
+        if (node.compressedSize == 0xffffffff && field + 8 <= end) node.compressedSize = readu64(field), field += 8;
+        if (headerOffset == 0xffffffff && field + 8 <= end) headerOffset = readu64(field), field += 8;
+        break;
+      }
+    }
+
     // Sanity check the local file header
-    uint64_t headerOffset = base + readu32(p + 42);
+    headerOffset += base;
     uint8_t* header = archive->data + headerOffset;
     if (headerOffset > archive->size - 30 || readu32(header) != 0x04034b50) {
       zip_free(archive);
@@ -777,7 +852,7 @@ static bool zip_init(Archive* archive, const char* filename, const char* root) {
     node.data = archive->data + dataOffset;
 
     // Make sure data is actually contained in the zip
-    if (dataOffset + node.compressedSize > archive->size) {
+    if (dataOffset > archive->size || node.compressedSize > archive->size - dataOffset) {
       zip_free(archive);
       return lovrSetError("Corrupt ZIP: zip file data is not contained in the zip");
     }
@@ -873,6 +948,8 @@ static bool zip_open(Archive* archive, const char* path, Handle* handle) {
     stream->inputCursor = 0;
     stream->outputCursor = 0;
     stream->bufferExtent = 0;
+    stream->indexing = false;
+    arr_init(&stream->checkpoints);
   } else {
     handle->stream = NULL;
   }
@@ -882,10 +959,46 @@ static bool zip_open(Archive* archive, const char* path, Handle* handle) {
 }
 
 static bool zip_close(Archive* archive, Handle* handle) {
-  lovrFree(handle->stream);
+  if (handle->stream) {
+    for (size_t i = 0; i < handle->stream->checkpoints.length; i++) {
+      lovrFree(handle->stream->checkpoints.data[i]);
+    }
+    arr_free(&handle->stream->checkpoints);
+    lovrFree(handle->stream);
+  }
   return true;
 }
 
+// Moves the stream to the closest checkpoint at or before offset, or the beginning of the file.
+// Going forward only happens if it skips past data that would otherwise have to be inflated.
+static void zip_rewind(zip_stream* stream, uint64_t offset, bool forward) {
+  zip_checkpoint* checkpoint = NULL;
+
+  for (size_t i = stream->checkpoints.length; i > 0; i--) {
+    if (stream->checkpoints.data[i - 1]->outputCursor <= offset) {
+      checkpoint = stream->checkpoints.data[i - 1];
+      break;
+    }
+  }
+
+  if (forward && (!checkpoint || checkpoint->outputCursor <= stream->outputCursor + stream->bufferExtent)) {
+    return;
+  }
+
+  if (checkpoint) {
+    memcpy(&stream->decompressor, &checkpoint->decompressor, sizeof(tinfl_decompressor));
+    memcpy(stream->buffer, checkpoint->window, sizeof(stream->buffer));
+    stream->inputCursor = checkpoint->inputCursor;
+    stream->outputCursor = checkpoint->outputCursor;
+  } else {
+    tinfl_init(&stream->decompressor);
+    stream->inputCursor = 0;
+    stream->outputCursor = 0;
+  }
+
+  stream->bufferExtent = 0;
+}
+
 static bool decompress(zip_node* node, zip_stream* stream, uint8_t* data, size_t size, size_t* count) {
   if (size > 0 && stream->bufferExtent > 0) {
     lovrUnreachable(); // Data in the buffer must be copied out first!
@@ -899,6 +1012,19 @@ static bool decompress(zip_node* node, zip_stream* stream, uint8_t* data, size_t
     uint32_t flags = stream->outputCursor + outSize < node->uncompressedSize ? TINFL_FLAG_HAS_MORE_INPUT : 0;
     int status = tinfl_decompress(&stream->decompressor, input, &inSize, output, output, &outSize, flags);
     if (status < 0) return lovrSetError("Could not decompress file");
+
+    // The buffer holds the whole inflate window after a full chunk, which is all a checkpoint needs
+    size_t chunkEnd = stream->outputCursor + outSize;
+    size_t lastCheckpoint = stream->checkpoints.length > 0 ? stream->checkpoints.data[stream->checkpoints.length - 1]->outputCursor : 0;
+    if (stream->indexing && outSize == sizeof(stream->buffer) && chunkEnd % ZIP_CHECKPOINT_INTERVAL == 0 && chunkEnd > lastCheckpoint) {
+      zip_checkpoint* checkpoint = lovrMalloc(sizeof(zip_checkpoint));
+      checkpoint->inputCursor = stream->inputCursor + inSize;
+      checkpoint->outputCursor = chunkEnd;
+      memcpy(&checkpoint->decompressor, &stream->decompressor, sizeof(tinfl_decompressor));
+      memcpy(checkpoint->window, stream->buffer, sizeof(checkpoint->window));
+      arr_push(&stream->checkpoints, checkpoint);
+    }
+
     size_t n = MIN(outSize, size);
     if (data) memcpy(data, stream->buffer, n), data += n;
     stream->inputCursor += inSize;
@@ -933,6 +1059,9 @@ static bool zip_read(Archive* archive, Handle* handle, uint8_t* data, size_t siz
   if (handle->offset == 0 && size == node->uncompressedSize) {
     size_t inputSize = node->compressedSize;
     uint32_t flags = TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF;
+    tinfl_init(&stream->decompressor);
+    stream->inputCursor = 0;
+    stream->bufferExtent = 0;
     int status = tinfl_decompress(&stream->decompressor, node->data, &inputSize, data, data, &size, flags);
     if (status != TINFL_STATUS_DONE) return lovrSetError("Could not decompress file");
     stream->outputCursor = size;
@@ -941,12 +1070,13 @@ static bool zip_read(Archive* archive, Handle* handle, uint8_t* data, size_t siz
     return true;
   }
 
-  // If the file seeked backwards, gotta rewind to the beginning
+  // If the file seeked backwards, rewind to a checkpoint.  Checkpoints only get recorded after the
+  // first backwards seek, so files that are only read front to back don't pay for them.
   if (stream->outputCursor > handle->offset) {
-    tinfl_init(&stream->decompressor);
-    stream->inputCursor = 0;
-    stream->outputCursor = 0;
-    stream->bufferExtent = 0;
+    stream->indexing = true;
+    zip_rewind(stream, handle->offset, false);
+  } else if (handle->offset > stream->outputCursor) {
+    zip_rewind(stream, handle->offset, true);
   }
 
   // Decompress and throw away data until reaching the current seek position
@@ -7,6 +7,7 @@
 #include "headset/headset.h"
 #include "math/math.h"
 #include "core/gpu.h"
+#include "core/job.h"
 #include "core/maf.h"
 #include "core/spv.h"
 #include "core/os.h"
@@ -15,6 +16,7 @@
 #include "shaders.h"
 #include <math.h>
 #include <stdatomic.h>
+#include <threads.h>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -23,14 +25,28 @@
 #include "glslang_c_interface.h"
 #include "resource_limits_c.h"
 #endif
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_IX86)
+#include <xmmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#endif
 
 #define MAX_PIPELINES 65536
+#define PIPELINE_CACHE_MAGIC 0x43504c4c
+#define PIPELINE_CACHE_VERSION 1
+#define FONT_CACHE_MAGIC 0x544e4f46
+#define FONT_CACHE_VERSION 1
+#define FONT_CACHE_FILE_MAGIC 0x53544e46
+#define MAX_FONT_CACHES 16
 #define MAX_TALLIES 255
 #define TRANSFORM_STACK_SIZE 16
 #define PIPELINE_STACK_SIZE 8
 #define MAX_SHADER_RESOURCES 32
 #define MAX_CUSTOM_ATTRIBUTES 10
 #define FLOAT_BITS(f) ((union { float f; uint32_t u; }) { f }).u
+#define BUFFER_BLOCK_SIZE (1 << 22)
+#define BUFFER_BLOCK_CLASSES 6
+#define BUFFER_TRIM_TICKS 120
 
 typedef struct {
   void* next;
@@ -47,6 +63,16 @@ typedef struct {
   uint32_t cursor;
 } BufferAllocator;
 
+// Free blocks are queued by size class, oldest first, and recycled once the GPU is done with them
+typedef struct {
+  BufferBlock* head[BUFFER_BLOCK_CLASSES];
+  BufferBlock* tail[BUFFER_BLOCK_CLASSES];
+  uint32_t blockCount;
+  uint64_t memory;
+  uint64_t active;
+  uint64_t peak;
+} BufferPool;
+
 typedef struct {
   BufferBlock* block;
   gpu_buffer* buffer;
@@ -142,8 +168,10 @@ struct Shader {
   gpu_pipeline* computePipeline;
   ShaderInfo info;
   Layout* layout;
+  uint64_t hash;
   uint32_t workgroupSize[3];
   bool hasCustomAttributes;
+  bool batchable;
   uint32_t attributeCount;
   uint32_t resourceCount;
   uint32_t bufferMask;
@@ -177,12 +205,56 @@ struct Material {
 };
 
 typedef struct {
+  uint32_t codepoint;
   float advance;
   uint16_t x, y;
   uint16_t uv[4];
   float box[4];
 } Glyph;
 
+typedef struct {
+  uint32_t codepoint;
+  uint32_t width;
+  uint32_t height;
+  uint32_t offset;
+  uint16_t x, y;
+  float advance;
+  float box[4];
+  const uint8_t* cached;
+} GlyphTask;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t key;
+  uint32_t atlasWidth;
+  uint32_t atlasHeight;
+  uint32_t atlasX;
+  uint32_t atlasY;
+  uint32_t rowHeight;
+  uint32_t glyphCount;
+} FontCacheHeader;
+
+typedef struct {
+  uint32_t codepoint;
+  float advance;
+  float box[4];
+  uint16_t x, y;
+} FontCacheGlyph;
+
+// Glyphs being rasterized in the background, they get added to the atlas once they're all done
+typedef struct {
+  job_group group;
+  atomic_uint next;
+  Rasterizer* rasterizer;
+  double spread;
+  GlyphTask* tasks;
+  uint32_t count;
+  uint32_t size;
+  uint8_t* pixels;
+  uint32_t cacheStride;
+} GlyphBatch;
+
 struct Font {
   uint32_t ref;
   FontInfo info;
@@ -198,6 +270,11 @@ struct Font {
   uint32_t rowHeight;
   uint32_t atlasX;
   uint32_t atlasY;
+  const FontCacheHeader* cache;
+  size_t cacheSize;
+  map_t cacheLookup;
+  bool dirty;
+  GlyphBatch* prewarm;
 };
 
 struct Mesh {
@@ -377,7 +454,8 @@ enum {
   DIRTY_CAMERA = (1 << 2),
   DIRTY_VIEWPORT = (1 << 3),
   DIRTY_SCISSOR = (1 << 4),
-  NEEDS_VIEW_CULL = (1 << 5)
+  NEEDS_VIEW_CULL = (1 << 5),
+  DIRTY_PIPELINES = (1 << 6)
 };
 
 typedef struct {
@@ -556,6 +634,14 @@ struct Pass {
   Draw* draws;
   PassStats stats;
   char* label;
+  bool sort;
+  Pass* parent;
+  Pass* forks;
+  Pass* lastFork;
+  Pass* sibling;
+  uint32_t forkDraw;
+  uint32_t forkCompute;
+  bool merged;
 };
 
 typedef struct {
@@ -573,6 +659,19 @@ typedef struct {
   uint32_t tick;
 } ScratchTexture;
 
+// Pipelines are saved to disk without their pointers and recreated when a matching Shader loads
+typedef struct {
+  uint64_t shader;
+  bool flags;
+  gpu_pass_info pass;
+  gpu_pipeline_info pipeline;
+} PipelineRecord;
+
+// Forks can record on other threads, but anything touching global temporary state (the frame's temp
+// memory, the stream, layouts, pipeline cache) has to happen on the thread that owns the graphics
+// module
+static thread_local bool mainThread;
+
 static struct {
   uint32_t ref;
   bool glslang;
@@ -595,6 +694,7 @@ static struct {
   Texture* window;
   Pass* windowPass;
   Font* defaultFont;
+  arr_t(Font*) fonts;
   Buffer* defaultBuffer;
   Texture* defaultTexture;
   Sampler* defaultSamplers[2];
@@ -606,16 +706,25 @@ static struct {
   size_t materialBlock;
   arr_t(MaterialBlock) materialBlocks;
   BufferAllocator bufferAllocators[4];
+  BufferPool bufferPools[4];
   arr_t(ScratchTexture) scratchTextures;
   map_t passLookup;
   map_t pipelineLookup;
   gpu_pipeline* pipelines;
   uint32_t pipelineCount;
+  arr_t(gpu_shader*) pipelineOwners;
+  arr_t(uint32_t) pipelineFreelist;
+  arr_t(PipelineRecord) pipelineCache;
+  char* fontCacheData;
+  map_t fontCacheLookup;
+  arr_t(PipelineRecord) pipelineRecords;
+  map_t pipelineRecordLookup;
   Layout* layouts;
   Layout* builtinLayout;
   Layout* materialLayout;
   Layout* uniformLayout;
   Allocator allocator;
+  mtx_t lock;
 } state;
 
 // Helpers
@@ -624,8 +733,13 @@ static void* tempAlloc(Allocator* allocator, size_t size);
 static size_t tempPush(Allocator* allocator);
 static void tempPop(Allocator* allocator, size_t stack);
 static gpu_pipeline* getPipeline(uint32_t index);
+static bool reservePipeline(gpu_shader* shader, uint32_t* index);
+static void freePipeline(uint32_t index);
+static void evictPipelines(gpu_shader* shader);
 static BufferBlock* getBlock(gpu_buffer_type type, uint32_t size);
-static void freeBlock(BufferAllocator* allocator, BufferBlock* block);
+static void freeBlock(gpu_buffer_type type, BufferBlock* block);
+static void freeBlocks(gpu_buffer_type type, BufferBlock* list);
+static void trimBlocks(void);
 static BufferView allocateBuffer(BufferAllocator* allocator, gpu_buffer_type type, uint32_t size, size_t align);
 static BufferView getBuffer(gpu_buffer_type type, uint32_t size, size_t align);
 static int u64cmp(const void* a, const void* b);
@@ -633,7 +747,14 @@ static uint32_t lcm(uint32_t a, uint32_t b);
 static bool beginFrame(void);
 static void flushTransfers(void);
 static void processReadbacks(void);
+static void getPassInfo(Canvas* canvas, gpu_pass_info* info);
 static gpu_pass* getPass(Canvas* canvas);
+static gpu_pass* lookupPass(gpu_pass_info* info);
+static void recordPipeline(Shader* shader, Canvas* canvas, gpu_pipeline_info* info);
+static void prewarmPipelines(Shader* shader);
+static bool mergeForks(Pass* pass);
+static uint64_t getFontCacheKey(Font* font);
+static bool checkFontCache(Font* font, const void* data, size_t size);
 static Layout* getLayout(gpu_slot* slots, uint32_t count);
 static gpu_bundle* getBundle(Layout* layout, gpu_binding* bindings, uint32_t count);
 static gpu_texture* getScratchTexture(gpu_stream* stream, Canvas* canvas, Attachment* attachment);
@@ -659,6 +780,8 @@ static void onMessage(void* context, const char* message);
 bool lovrGraphicsInit(GraphicsConfig* config) {
   if (atomic_fetch_add(&state.ref, 1)) return false;
 
+  mainThread = true;
+
   gpu_config gpu = {
     .debug = config->debug,
     .fnLog = onMessage,
@@ -695,6 +818,9 @@ bool lovrGraphicsInit(GraphicsConfig* config) {
   state.config = *config;
   state.timingEnabled = config->debug;
 
+  mtx_init(&state.lock, mtx_plain);
+  arr_init(&state.fonts);
+
   // Temporary frame memory uses a large 1GiB virtual memory allocation, committing pages as needed
   state.allocator.length = 1 << 14;
   state.allocator.limit = 1 << 30;
@@ -706,6 +832,45 @@ bool lovrGraphicsInit(GraphicsConfig* config) {
 
   map_init(&state.passLookup, 4);
   map_init(&state.pipelineLookup, 64);
+  map_init(&state.pipelineRecordLookup, 64);
+  arr_init(&state.pipelineOwners);
+  arr_init(&state.pipelineFreelist);
+  arr_init(&state.pipelineCache);
+  arr_init(&state.pipelineRecords);
+
+  // Pipeline cache is a header (magic, version, record size, record count) followed by records
+  if (config->pipelineSize >= 4 * sizeof(uint32_t)) {
+    uint32_t header[4];
+    memcpy(header, config->pipelineData, sizeof(header));
+    size_t size = config->pipelineSize - sizeof(header);
+    if (header[0] == PIPELINE_CACHE_MAGIC && header[1] == PIPELINE_CACHE_VERSION && header[2] == sizeof(PipelineRecord) && header[3] <= size / sizeof(PipelineRecord)) {
+      arr_append(&state.pipelineCache, (PipelineRecord*) ((char*) config->pipelineData + sizeof(header)), header[3]);
+    }
+  }
+
+  // Font cache is a header (magic, version, entry count, padding) followed by entries, which are
+  // a 64 bit size and a Font's cache padded to 8 bytes.  Entries are looked up by their cache key,
+  // and the low bit of the offset gets set once a Font uses the entry.
+  map_init(&state.fontCacheLookup, 0);
+  if (config->fontCacheSize >= 4 * sizeof(uint32_t)) {
+    uint32_t header[4];
+    memcpy(header, config->fontCacheData, sizeof(header));
+    if (header[0] == FONT_CACHE_FILE_MAGIC && header[1] == FONT_CACHE_VERSION) {
+      size_t size = config->fontCacheSize;
+      size_t offset = sizeof(header);
+      state.fontCacheData = lovrMalloc(size);
+      memcpy(state.fontCacheData, config->fontCacheData, size);
+      for (uint32_t i = 0; i < header[2] && size - offset >= sizeof(uint64_t); i++) {
+        uint64_t entrySize;
+        memcpy(&entrySize, state.fontCacheData + offset, sizeof(entrySize));
+        size_t remaining = size - offset - sizeof(uint64_t);
+        if (entrySize < sizeof(FontCacheHeader) || entrySize > remaining || ALIGN(entrySize, 8) > remaining) break;
+        const FontCacheHeader* cache = (const FontCacheHeader*) (state.fontCacheData + offset + sizeof(uint64_t));
+        map_set(&state.fontCacheLookup, cache->key, offset);
+        offset += sizeof(uint64_t) + ALIGN(entrySize, 8);
+      }
+    }
+  }
   arr_init(&state.materialBlocks);
   arr_init(&state.scratchTextures);
 
@@ -899,6 +1064,7 @@ void lovrGraphicsDestroy(void) {
   lovrRelease(state.window, lovrTextureDestroy);
   lovrRelease(state.windowPass, lovrPassDestroy);
   lovrRelease(state.defaultFont, lovrFontDestroy);
+  arr_free(&state.fonts);
   lovrRelease(state.defaultBuffer, lovrBufferDestroy);
   lovrRelease(state.defaultTexture, lovrTextureDestroy);
   lovrRelease(state.defaultSamplers[0], lovrSamplerDestroy);
@@ -911,7 +1077,7 @@ void lovrGraphicsDestroy(void) {
     MaterialBlock* block = &state.materialBlocks.data[i];
     BufferBlock* current = state.bufferAllocators[GPU_BUFFER_STATIC].current;
     if (block->view.block != current && atomic_fetch_sub(&block->view.block->ref, 1) == 1) {
-      freeBlock(&state.bufferAllocators[GPU_BUFFER_STATIC], block->view.block);
+      freeBlock(GPU_BUFFER_STATIC, block->view.block);
     }
     gpu_bundle_pool_destroy(block->bundlePool);
     lovrFree(block->list);
@@ -929,6 +1095,13 @@ void lovrGraphicsDestroy(void) {
   }
   os_vm_free(state.pipelines, MAX_PIPELINES * gpu_sizeof_pipeline());
   map_free(&state.pipelineLookup);
+  map_free(&state.pipelineRecordLookup);
+  arr_free(&state.pipelineOwners);
+  arr_free(&state.pipelineFreelist);
+  arr_free(&state.pipelineCache);
+  arr_free(&state.pipelineRecords);
+  map_free(&state.fontCacheLookup);
+  lovrFree(state.fontCacheData);
   for (size_t i = 0; i < state.passLookup.size; i++) {
     if (state.passLookup.values[i] != MAP_NIL) {
       gpu_pass* pass = (gpu_pass*) (uintptr_t) state.passLookup.values[i];
@@ -938,12 +1111,14 @@ void lovrGraphicsDestroy(void) {
   }
   map_free(&state.passLookup);
   for (size_t i = 0; i < COUNTOF(state.bufferAllocators); i++) {
-    BufferBlock* block = state.bufferAllocators[i].freelist;
-    while (block) {
-      gpu_buffer_destroy(block->handle);
-      BufferBlock* next = block->next;
-      lovrFree(block);
-      block = next;
+    for (uint32_t c = 0; c < BUFFER_BLOCK_CLASSES; c++) {
+      BufferBlock* block = state.bufferPools[i].head[c];
+      while (block) {
+        gpu_buffer_destroy(block->handle);
+        BufferBlock* next = block->next;
+        lovrFree(block);
+        block = next;
+      }
     }
 
     BufferBlock* current = state.bufferAllocators[i].current;
@@ -974,6 +1149,7 @@ void lovrGraphicsDestroy(void) {
   if (state.glslang) glslang_finalize_process();
 #endif
   os_vm_free(state.allocator.memory, state.allocator.limit);
+  mtx_destroy(&state.lock);
   memset(&state, 0, sizeof(state));
 }
 
@@ -1038,6 +1214,32 @@ void lovrGraphicsGetLimits(GraphicsLimits* limits) {
   limits->pointSize = state.limits.pointSize;
 }
 
+uint32_t lovrGraphicsGetHeaps(GraphicsHeap* heaps, uint32_t capacity) {
+  gpu_heap_stats stats[16];
+  uint32_t count = gpu_get_memory_stats(stats, MIN(capacity, COUNTOF(stats)));
+  for (uint32_t i = 0; i < count; i++) {
+    heaps[i].size = stats[i].size;
+    heaps[i].allocated = stats[i].allocated;
+    heaps[i].used = stats[i].used;
+    heaps[i].largestFree = stats[i].largestFree;
+    heaps[i].blocks = stats[i].blocks;
+    heaps[i].allocations = stats[i].allocations;
+    heaps[i].deviceLocal = stats[i].deviceLocal;
+  }
+  return count;
+}
+
+void lovrGraphicsGetBufferPools(GraphicsBufferPool pools[BUFFER_POOL_COUNT]) {
+  mtx_lock(&state.lock);
+  for (uint32_t i = 0; i < BUFFER_POOL_COUNT; i++) {
+    pools[i].blocks = state.bufferPools[i].blockCount;
+    pools[i].memory = state.bufferPools[i].memory;
+    pools[i].active = state.bufferPools[i].active;
+    pools[i].peak = state.bufferPools[i].peak;
+  }
+  mtx_unlock(&state.lock);
+}
+
 uint32_t lovrGraphicsGetFormatSupport(uint32_t format, uint32_t features) {
   uint32_t support = 0;
   for (uint32_t i = 0; i < 2; i++) {
@@ -1059,6 +1261,130 @@ void lovrGraphicsGetShaderCache(void* data, size_t* size) {
   gpu_pipeline_get_cache(data, size);
 }
 
+void lovrGraphicsGetPipelineCache(void* data, size_t* size) {
+  uint32_t header[4] = {
+    PIPELINE_CACHE_MAGIC,
+    PIPELINE_CACHE_VERSION,
+    sizeof(PipelineRecord),
+    (uint32_t) state.pipelineRecords.length
+  };
+
+  size_t total = state.pipelineRecords.length > 0 ? sizeof(header) + state.pipelineRecords.length * sizeof(PipelineRecord) : 0;
+
+  if (!data) {
+    *size = total;
+    return;
+  }
+
+  if (*size < total) {
+    *size = 0;
+    return;
+  }
+
+  if (total > 0) {
+    memcpy(data, header, sizeof(header));
+    memcpy((char*) data + sizeof(header), state.pipelineRecords.data, state.pipelineRecords.length * sizeof(PipelineRecord));
+  }
+
+  *size = total;
+}
+
+// The font cache has the caches of the Fonts that are still alive, plus entries from the previous
+// cache that got used again.  Entries nothing used are dropped, and only MAX_FONT_CACHES are kept.
+// Returns NULL when no Font rasterized any new glyphs, since the old cache is still good then.
+void* lovrGraphicsGetFontCache(size_t* size) {
+  static const char zero[8] = { 0 };
+  bool dirty = false;
+  *size = 0;
+
+  mtx_lock(&state.lock);
+  size_t count = state.fonts.length;
+  Font** fonts = lovrMalloc(MAX(count, 1) * sizeof(Font*));
+  for (size_t i = 0; i < count; i++) {
+    fonts[i] = state.fonts.data[i];
+    dirty |= fonts[i]->dirty;
+    lovrRetain(fonts[i]);
+  }
+  mtx_unlock(&state.lock);
+
+  arr_t(char) buffer;
+  arr_init(&buffer);
+
+  map_t written;
+  map_init(&written, 0);
+
+  uint32_t header[4] = { FONT_CACHE_FILE_MAGIC, FONT_CACHE_VERSION, 0, 0 };
+
+  if (dirty) {
+    arr_append(&buffer, (char*) header, sizeof(header));
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    Font* font = fonts[i];
+    uint64_t key = getFontCacheKey(font);
+
+    if (
+      dirty &&
+      header[2] < MAX_FONT_CACHES &&
+      font->glyphs.length > 0 &&
+      lovrRasterizerGetType(font->info.rasterizer) == RASTERIZER_TTF &&
+      map_get(&written, key) == MAP_NIL
+    ) {
+      void* data = NULL;
+      size_t dataSize;
+      const void* entry = font->cache;
+      uint64_t entrySize = font->cacheSize;
+
+      if (font->dirty && (data = lovrFontGetCache(font, &dataSize)) != NULL) {
+        entry = data;
+        entrySize = dataSize;
+      }
+
+      if (entry) {
+        size_t padding = ALIGN(entrySize, 8) - entrySize;
+        arr_append(&buffer, (char*) &entrySize, sizeof(entrySize));
+        arr_append(&buffer, (const char*) entry, entrySize);
+        arr_append(&buffer, zero, padding);
+        map_set(&written, key, 1);
+        header[2]++;
+      }
+
+      lovrFree(data);
+    }
+
+    lovrRelease(font, lovrFontDestroy);
+  }
+
+  lovrFree(fonts);
+
+  if (!dirty) {
+    map_free(&written);
+    return NULL;
+  }
+
+  mtx_lock(&state.lock);
+  for (uint32_t i = 0; i < state.fontCacheLookup.size && header[2] < MAX_FONT_CACHES; i++) {
+    uint64_t key = state.fontCacheLookup.hashes[i];
+    uint64_t offset = state.fontCacheLookup.values[i];
+
+    if (key == MAP_NIL || (offset & 1) == 0 || map_get(&written, key) != MAP_NIL) {
+      continue;
+    }
+
+    uint64_t entrySize;
+    const char* entry = state.fontCacheData + (offset & ~1ull);
+    memcpy(&entrySize, entry, sizeof(entrySize));
+    arr_append(&buffer, entry, sizeof(uint64_t) + ALIGN(entrySize, 8));
+    header[2]++;
+  }
+  mtx_unlock(&state.lock);
+
+  map_free(&written);
+  memcpy(buffer.data, header, sizeof(header));
+  *size = buffer.length;
+  return buffer.data;
+}
+
 void lovrGraphicsGetBackgroundColor(float background[4]) {
   background[0] = lovrMathLinearToGamma(state.background[0]);
   background[1] = lovrMathLinearToGamma(state.background[1]);
@@ -1081,6 +1407,234 @@ void lovrGraphicsSetTimingEnabled(bool enable) {
   state.timingEnabled = enable;
 }
 
+// Frustum planes for all of a camera's views, stored as a structure of arrays so that 4 planes can
+// be tested at once.  There are up to 6 views with 6 planes each.
+typedef struct {
+  float x[36];
+  float y[36];
+  float z[36];
+  float w[36];
+} Frustum;
+
+typedef struct {
+  Draw* draws;
+  Frustum* frusta;
+  uint32_t views;
+  uint32_t groups;
+  uint8_t* visible;
+} CullContext;
+
+// Returns a bitmask of the planes that a box is completely outside of.  The box is given by its
+// center and its 3 axes scaled by its half-extents.  A box is outside of a plane when the distance
+// from its center to the plane is less than its radius projected onto the plane normal.
+static uint64_t cullBox(Frustum* frustum, uint32_t groups, float center[3], float axes[3][3]) {
+  uint64_t mask = 0;
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_IX86)
+  __m128 sign = _mm_set1_ps(-0.f);
+  __m128 zero = _mm_setzero_ps();
+  __m128 c[3], a[3][3];
+
+  for (uint32_t i = 0; i < 3; i++) {
+    c[i] = _mm_set1_ps(center[i]);
+    a[i][0] = _mm_set1_ps(axes[i][0]);
+    a[i][1] = _mm_set1_ps(axes[i][1]);
+    a[i][2] = _mm_set1_ps(axes[i][2]);
+  }
+
+  for (uint32_t i = 0; i < groups; i++) {
+    __m128 x = _mm_loadu_ps(frustum->x + 4 * i);
+    __m128 y = _mm_loadu_ps(frustum->y + 4 * i);
+    __m128 z = _mm_loadu_ps(frustum->z + 4 * i);
+    __m128 w = _mm_loadu_ps(frustum->w + 4 * i);
+    __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, c[0]), _mm_mul_ps(y, c[1])), _mm_add_ps(_mm_mul_ps(z, c[2]), w));
+    __m128 radius = zero;
+    for (uint32_t j = 0; j < 3; j++) {
+      __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, a[j][0]), _mm_mul_ps(y, a[j][1])), _mm_mul_ps(z, a[j][2]));
+      radius = _mm_add_ps(radius, _mm_andnot_ps(sign, dot));
+    }
+    mask |= (uint64_t) _mm_movemask_ps(_mm_cmple_ps(_mm_add_ps(distance, radius), zero)) << (4 * i);
+  }
+#elif defined(__aarch64__) || defined(_M_ARM64)
+  static const uint32_t bits[4] = { 1, 2, 4, 8 };
+  uint32x4_t bit = vld1q_u32(bits);
+  float32x4_t zero = vdupq_n_f32(0.f);
+
+  for (uint32_t i = 0; i < groups; i++) {
+    float32x4_t x = vld1q_f32(frustum->x + 4 * i);
+    float32x4_t y = vld1q_f32(frustum->y + 4 * i);
+    float32x4_t z = vld1q_f32(frustum->z + 4 * i);
+    float32x4_t distance = vld1q_f32(frustum->w + 4 * i);
+    distance = vfmaq_n_f32(distance, x, center[0]);
+    distance = vfmaq_n_f32(distance, y, center[1]);
+    distance = vfmaq_n_f32(distance, z, center[2]);
+    for (uint32_t j = 0; j < 3; j++) {
+      float32x4_t dot = vmulq_n_f32(x, axes[j][0]);
+      dot = vfmaq_n_f32(dot, y, axes[j][1]);
+      dot = vfmaq_n_f32(dot, z, axes[j][2]);
+      distance = vaddq_f32(distance, vabsq_f32(dot));
+    }
+    mask |= (uint64_t) vaddvq_u32(vandq_u32(vcleq_f32(distance, zero), bit)) << (4 * i);
+  }
+#else
+  for (uint32_t p = 0; p < 4 * groups; p++) {
+    float distance = frustum->x[p] * center[0] + frustum->y[p] * center[1] + frustum->z[p] * center[2] + frustum->w[p];
+    for (uint32_t j = 0; j < 3; j++) {
+      distance += fabsf(frustum->x[p] * axes[j][0] + frustum->y[p] * axes[j][1] + frustum->z[p] * axes[j][2]);
+    }
+    mask |= (uint64_t) (distance <= 0.f) << p;
+  }
+#endif
+  return mask;
+}
+
+static void cullDraws(void* arg, uint32_t start, uint32_t end) {
+  CullContext* cull = arg;
+
+  for (uint32_t i = start; i < end; i++) {
+    Draw* draw = &cull->draws[i];
+
+    if (~draw->flags & DRAW_HAS_BOUNDS) {
+      cull->visible[i] = true;
+      continue;
+    }
+
+    float* m = draw->transform;
+    float* c = draw->bounds + 0;
+    float* e = draw->bounds + 3;
+
+    float center[3] = {
+      m[0] * c[0] + m[4] * c[1] + m[8] * c[2] + m[12],
+      m[1] * c[0] + m[5] * c[1] + m[9] * c[2] + m[13],
+      m[2] * c[0] + m[6] * c[1] + m[10] * c[2] + m[14]
+    };
+
+    float axes[3][3] = {
+      { m[0] * e[0], m[1] * e[0], m[2] * e[0] },
+      { m[4] * e[1], m[5] * e[1], m[6] * e[1] },
+      { m[8] * e[2], m[9] * e[2], m[10] * e[2] }
+    };
+
+    uint64_t outside = cullBox(&cull->frusta[draw->camera], cull->groups, center, axes);
+
+    // Visible if it's inside all the planes of at least one view
+    cull->visible[i] = false;
+    for (uint32_t v = 0; v < cull->views; v++) {
+      if (((outside >> (6 * v)) & 0x3f) == 0) {
+        cull->visible[i] = true;
+        break;
+      }
+    }
+  }
+}
+
+typedef struct {
+  Draw* draw;
+  uint32_t segment;
+  bool transparent;
+  float depth;
+  uint16_t index;
+} DrawSortKey;
+
+static int drawcmp(const void* a, const void* b) {
+  const DrawSortKey* x = a;
+  const DrawSortKey* y = b;
+
+  if (x->segment != y->segment) return x->segment < y->segment ? -1 : 1;
+  if (x->transparent != y->transparent) return x->transparent ? 1 : -1;
+
+  if (x->transparent) {
+    if (x->depth != y->depth) return x->depth > y->depth ? -1 : 1;
+  } else {
+    if (x->draw->pipeline != y->draw->pipeline) return (uintptr_t) x->draw->pipeline < (uintptr_t) y->draw->pipeline ? -1 : 1;
+    if (x->draw->material != y->draw->material) return (uintptr_t) x->draw->material < (uintptr_t) y->draw->material ? -1 : 1;
+    if (x->draw->bundleInfo != y->draw->bundleInfo) return (uintptr_t) x->draw->bundleInfo < (uintptr_t) y->draw->bundleInfo ? -1 : 1;
+    if (x->draw->vertexBuffer != y->draw->vertexBuffer) return (uintptr_t) x->draw->vertexBuffer < (uintptr_t) y->draw->vertexBuffer ? -1 : 1;
+    if (x->depth != y->depth) return x->depth < y->depth ? -1 : 1;
+  }
+
+  return x->index < y->index ? -1 : 1;
+}
+
+// Reorders draws to reduce state changes.  Draws that write depth are grouped by pipeline, material,
+// bindings, and vertex buffer, then sorted front-to-back.  Draws that don't write depth are drawn
+// after them, back-to-front.  Draws that depend on order (stencil, no depth test, tally changes)
+// stay in place and split the draw list into segments that are sorted separately.
+static void sortDraws(Pass* pass, uint16_t* activeDraws, uint32_t count) {
+  DrawSortKey* keys = tempAlloc(&state.allocator, count * sizeof(DrawSortKey));
+  uint32_t segment = 0;
+  uint8_t tally = pass->draws[activeDraws[0]].tally;
+
+  for (uint32_t i = 0; i < count; i++) {
+    Draw* draw = &pass->draws[activeDraws[i]];
+    gpu_pipeline_info* info = draw->pipelineInfo;
+    gpu_stencil_state* stencil = &info->stencil;
+    bool ordered = info->depth.test == GPU_COMPARE_NONE || stencil->test || stencil->failOp || stencil->depthFailOp || stencil->passOp;
+
+    if (ordered || draw->tally != tally) {
+      segment++;
+      tally = draw->tally;
+    }
+
+    float position[3] = { 0.f, 0.f, 0.f };
+    if (draw->flags & DRAW_HAS_BOUNDS) vec3_init(position, draw->bounds);
+    mat4_mulPoint(draw->transform, position);
+    float* view = pass->cameras[draw->camera * pass->canvas.views].viewMatrix;
+
+    keys[i] = (DrawSortKey) {
+      .draw = draw,
+      .segment = segment,
+      .transparent = !info->depth.write,
+      .depth = -(view[2] * position[0] + view[6] * position[1] + view[10] * position[2] + view[14]),
+      .index = activeDraws[i]
+    };
+
+    segment += ordered;
+  }
+
+  qsort(keys, count, sizeof(DrawSortKey), drawcmp);
+
+  for (uint32_t i = 0; i < count; i++) {
+    activeDraws[i] = keys[i].index;
+  }
+}
+
+static uint32_t countStateChanges(Draw* draws, uint16_t* activeDraws, uint32_t count) {
+  uint32_t changes = 0;
+
+  for (uint32_t i = 1; i < count; i++) {
+    Draw* prev = &draws[activeDraws[i - 1]];
+    Draw* draw = &draws[activeDraws[i]];
+    changes += draw->pipeline != prev->pipeline;
+    changes += draw->material != prev->material;
+    changes += draw->bundleInfo != prev->bundleInfo;
+    changes += draw->vertexBuffer != prev->vertexBuffer || draw->vertexBufferOffset != prev->vertexBufferOffset;
+  }
+
+  return changes;
+}
+
+static bool canBatch(Draw* a, Draw* b) {
+  return
+    a->pipeline == b->pipeline &&
+    a->shader == b->shader &&
+    a->material == b->material &&
+    a->bundle == b->bundle &&
+    a->camera == b->camera &&
+    a->viewport == b->viewport &&
+    a->scissor == b->scissor &&
+    a->tally == b->tally &&
+    a->flags == b->flags &&
+    a->vertexBuffer == b->vertexBuffer &&
+    a->vertexBufferOffset == b->vertexBufferOffset &&
+    a->indexBuffer == b->indexBuffer &&
+    a->uniformBuffer == b->uniformBuffer &&
+    a->uniformOffset == b->uniformOffset &&
+    a->start == b->start &&
+    a->count == b->count &&
+    a->instances == b->instances &&
+    a->baseVertex == b->baseVertex;
+}
+
 static bool recordComputePass(Pass* pass, gpu_stream* stream) {
   if (pass->computeCount == 0) {
     return true;
@@ -1229,78 +1783,56 @@ static bool recordRenderPass(Pass* pass, gpu_stream* stream) {
   uint16_t* activeDraws = tempAlloc(&state.allocator, pass->drawCount * sizeof(uint16_t));
 
   if (pass->flags & NEEDS_VIEW_CULL) {
-    typedef struct { float planes[6][4]; } Frustum;
-    Frustum* frusta = tempAlloc(&state.allocator, canvas->views * sizeof(Frustum));
-    uint32_t drawIndex = 0;
+    uint32_t views = canvas->views;
+    Frustum* frusta = tempAlloc(&state.allocator, pass->cameraCount * sizeof(Frustum));
 
+    // Each camera gets one frustum with the planes of all its views.  Draws from forked passes are
+    // spliced in with their own cameras, so draws are not necessarily sorted by camera.
     for (uint32_t c = 0; c < pass->cameraCount; c++) {
-      for (uint32_t v = 0; v < canvas->views; v++) {
-        float* m = pass->cameras[c * canvas->views + v].viewProjection;
-        memcpy(frusta[v].planes, (float[6][4]) {
+      Frustum* frustum = &frusta[c];
+
+      for (uint32_t p = 0; p < COUNTOF(frustum->w); p++) {
+        frustum->x[p] = frustum->y[p] = frustum->z[p] = 0.f;
+        frustum->w[p] = 1.f; // Padding planes always pass
+      }
+
+      for (uint32_t v = 0; v < views; v++) {
+        float* m = pass->cameras[c * views + v].viewProjection;
+        float planes[6][4] = {
           { (m[3] + m[0]), (m[7] + m[4]), (m[11] + m[8]), (m[15] + m[12]) }, // Left
           { (m[3] - m[0]), (m[7] - m[4]), (m[11] - m[8]), (m[15] - m[12]) }, // Right
           { (m[3] + m[1]), (m[7] + m[5]), (m[11] + m[9]), (m[15] + m[13]) }, // Bottom
           { (m[3] - m[1]), (m[7] - m[5]), (m[11] - m[9]), (m[15] - m[13]) }, // Top
           { m[2], m[6], m[10], m[14] }, // Near
           { (m[3] - m[2]), (m[7] - m[6]), (m[11] - m[10]), (m[15] - m[14]) } // Far
-        }, sizeof(Frustum));
-      }
-
-      while (drawIndex < pass->drawCount) {
-        Draw* draw = &pass->draws[drawIndex];
-
-        if (draw->camera != c) {
-          break;
-        }
-
-        if (~draw->flags & DRAW_HAS_BOUNDS) {
-          activeDraws[activeDrawCount++] = drawIndex++;
-          continue;
-        }
-
-        float* center = draw->bounds + 0;
-        float* extent = draw->bounds + 3;
-
-        float corners[8][3] = {
-          { center[0] - extent[0], center[1] - extent[1], center[2] - extent[2] },
-          { center[0] - extent[0], center[1] - extent[1], center[2] + extent[2] },
-          { center[0] - extent[0], center[1] + extent[1], center[2] - extent[2] },
-          { center[0] - extent[0], center[1] + extent[1], center[2] + extent[2] },
-          { center[0] + extent[0], center[1] - extent[1], center[2] - extent[2] },
-          { center[0] + extent[0], center[1] - extent[1], center[2] + extent[2] },
-          { center[0] + extent[0], center[1] + extent[1], center[2] - extent[2] },
-          { center[0] + extent[0], center[1] + extent[1], center[2] + extent[2] }
         };
 
-        for (uint32_t i = 0; i < COUNTOF(corners); i++) {
-          mat4_mulPoint(draw->transform, corners[i]);
+        for (uint32_t p = 0; p < 6; p++) {
+          frustum->x[v * 6 + p] = planes[p][0];
+          frustum->y[v * 6 + p] = planes[p][1];
+          frustum->z[v * 6 + p] = planes[p][2];
+          frustum->w[v * 6 + p] = planes[p][3];
         }
+      }
+    }
 
-        uint32_t visible = canvas->views;
-
-        for (uint32_t v = 0; v < canvas->views; v++) {
-          for (uint32_t p = 0; p < 6; p++) {
-            bool inside = false;
-
-            for (uint32_t c = 0; c < COUNTOF(corners); c++) {
-              if (vec3_dot(corners[c], frusta[v].planes[p]) + frusta[v].planes[p][3] > 0.f) {
-                inside = true;
-                break;
-              }
-            }
-
-            if (!inside) {
-              visible--;
-              break;
-            }
-          }
-        }
+    CullContext cull = {
+      .draws = pass->draws,
+      .frusta = frusta,
+      .views = views,
+      .groups = (6 * views + 3) / 4,
+      .visible = tempAlloc(&state.allocator, pass->drawCount * sizeof(uint8_t))
+    };
 
-        if (visible) {
-          activeDraws[activeDrawCount++] = drawIndex;
-        }
+#ifndef LOVR_DISABLE_THREAD
+    job_parallel_for(pass->drawCount, 1024, cullDraws, &cull);
+#else
+    cullDraws(&cull, 0, pass->drawCount);
+#endif
 
-        drawIndex++;
+    for (uint32_t i = 0; i < pass->drawCount; i++) {
+      if (cull.visible[i]) {
+        activeDraws[activeDrawCount++] = i;
       }
     }
   } else {
@@ -1310,6 +1842,7 @@ static bool recordRenderPass(Pass* pass, gpu_stream* stream) {
   }
 
   pass->stats.drawsCulled = pass->drawCount - activeDrawCount;
+  pass->stats.drawsBatched = 0;
 
   if (activeDrawCount == 0) {
     gpu_render_begin(stream, &target);
@@ -1317,6 +1850,52 @@ static bool recordRenderPass(Pass* pass, gpu_stream* stream) {
     return true;
   }
 
+  // Pipelines
+
+  if ((pass->flags & DIRTY_PIPELINES) || !pass->draws[pass->drawCount - 1].pipeline) {
+    uint32_t first = 0;
+
+    while (first < pass->drawCount && pass->draws[first].pipeline) {
+      first++; // TODO could binary search or cache
+    }
+
+    pass->flags &= ~DIRTY_PIPELINES;
+
+    for (uint32_t i = first; i < pass->drawCount; i++) {
+      Draw* prev = &pass->draws[i - 1];
+      Draw* draw = &pass->draws[i];
+
+      if (i > 0 && draw->pipelineInfo == prev->pipelineInfo) {
+        draw->pipeline = prev->pipeline;
+        continue;
+      }
+
+      uint64_t hash = hash64(draw->pipelineInfo, sizeof(gpu_pipeline_info));
+      uint64_t value = map_get(&state.pipelineLookup, hash);
+      uint32_t index = (uint32_t) value;
+
+      if (value == MAP_NIL) {
+        if (!reservePipeline(draw->pipelineInfo->shader, &index)) return false;
+        lovrAssert(gpu_pipeline_init_graphics(getPipeline(index), draw->pipelineInfo), "Failed to create GPU pipeline: %s", gpu_get_error());
+        map_set(&state.pipelineLookup, hash, index);
+        recordPipeline(draw->shader, &pass->canvas, draw->pipelineInfo);
+      }
+
+      draw->pipeline = getPipeline(index);
+    }
+  }
+
+  // Sorting
+
+  if (pass->sort && activeDrawCount > 1) {
+    uint32_t before = countStateChanges(pass->draws, activeDraws, activeDrawCount);
+    sortDraws(pass, activeDraws, activeDrawCount);
+    uint32_t after = countStateChanges(pass->draws, activeDraws, activeDrawCount);
+    pass->stats.stateChangesSaved = before > after ? before - after : 0;
+  } else {
+    pass->stats.stateChangesSaved = 0;
+  }
+
   // Builtins
 
   gpu_binding builtins[] = {
@@ -1376,39 +1955,6 @@ static bool recordRenderPass(Pass* pass, gpu_stream* stream) {
   gpu_bundle* builtinBundle = getBundle(state.builtinLayout, builtins, COUNTOF(builtins));
   if (!builtinBundle) return false;
 
-  // Pipelines
-
-  if (!pass->draws[pass->drawCount - 1].pipeline) {
-    uint32_t first = 0;
-
-    while (pass->draws[first].pipeline) {
-      first++; // TODO could binary search or cache
-    }
-
-    for (uint32_t i = first; i < pass->drawCount; i++) {
-      Draw* prev = &pass->draws[i - 1];
-      Draw* draw = &pass->draws[i];
-
-      if (i > 0 && draw->pipelineInfo == prev->pipelineInfo) {
-        draw->pipeline = prev->pipeline;
-        continue;
-      }
-
-      uint64_t hash = hash64(draw->pipelineInfo, sizeof(gpu_pipeline_info));
-      uint64_t index = map_get(&state.pipelineLookup, hash);
-
-      if (index == MAP_NIL) {
-        index = state.pipelineCount++;
-        lovrAssert(index < MAX_PIPELINES, "Too many pipelines!");
-        lovrAssert(os_vm_commit(state.pipelines, state.pipelineCount * gpu_sizeof_pipeline()), "Out of memory");
-        lovrAssert(gpu_pipeline_init_graphics(getPipeline(index), draw->pipelineInfo), "Failed to create GPU pipeline: %s", gpu_get_error());
-        map_set(&state.pipelineLookup, hash, index);
-      }
-
-      draw->pipeline = getPipeline(index);
-    }
-  }
-
   // Bundles
 
   Draw* prev = NULL;
@@ -1557,11 +2103,28 @@ static bool recordRenderPass(Pass* pass, gpu_stream* stream) {
       }
     }
 
+    // Runs of identical draws become a single instanced draw (without crossing a DrawData block)
+    uint32_t batch = 1;
+    if (draw->shader->batchable && draw->instances == 1 && ~draw->flags & DRAW_INDIRECT) {
+      while (i + batch < activeDrawCount && ((i + batch) & 0xff) != 0 && canBatch(draw, &pass->draws[activeDraws[i + batch]])) {
+        batch++;
+      }
+    }
+
     if (draw->shader->pushConstantSize >= 4) {
-      gpu_push_constants(stream, draw->shader->gpu, (uint32_t[1]) { i & 0xff }, 4);
+      gpu_push_constants(stream, draw->shader->gpu, (uint32_t[1]) { (i & 0xff) | (batch > 1 ? 0x80000000u : 0) }, 4);
     }
 
-    if (draw->flags & DRAW_INDIRECT) {
+    if (batch > 1) {
+      if (draw->indexBuffer) {
+        gpu_draw_indexed(stream, draw->count, batch, draw->start, draw->baseVertex, i & 0xff);
+      } else {
+        gpu_draw(stream, draw->count, batch, draw->start, i & 0xff);
+      }
+
+      pass->stats.drawsBatched += batch - 1;
+      i += batch - 1;
+    } else if (draw->flags & DRAW_INDIRECT) {
       if (draw->indexBuffer) {
         gpu_draw_indirect_indexed(stream, draw->indirect.buffer, draw->indirect.offset, draw->indirect.count, draw->indirect.stride);
       } else {
@@ -1696,6 +2259,12 @@ static void syncAttachment(Attachment* attachment, Texture* texture, bool depth,
 }
 
 bool lovrGraphicsSubmit(Pass** passes, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    if (passes[i]->forks && !mergeForks(passes[i])) {
+      return false;
+    }
+  }
+
   if (!beginFrame()) {
     return false;
   }
@@ -2138,7 +2707,8 @@ void lovrBufferDestroy(void* ref) {
   Buffer* buffer = ref;
   BufferAllocator* allocator = &state.bufferAllocators[GPU_BUFFER_STATIC];
   if (buffer->block != allocator->current && atomic_fetch_sub(&buffer->block->ref, 1) == 1) {
-    freeBlock(allocator, buffer->block);
+    buffer->block->tick = state.tick;
+    freeBlock(GPU_BUFFER_STATIC, buffer->block);
   }
   lovrFree(buffer);
 }
@@ -2409,6 +2979,18 @@ Texture* lovrTextureCreate(const TextureInfo* info) {
       }
       levelOffsets[level] += view.offset;
     }
+  } else if (info->file) {
+    // Image files are decoded right into the staging buffer, without making an Image first
+    levelCount = 1;
+    levelSizes[0] = measureTexture(info->format, info->width, info->height, 1);
+    view = getBuffer(GPU_BUFFER_UPLOAD, levelSizes[0], 64);
+
+    if (!view.buffer || !lovrImageDecode(info->file, false, view.pointer, levelSizes[0])) {
+      lovrTextureDestroy(texture);
+      return NULL;
+    }
+
+    levelOffsets[0] = view.offset;
   }
 
   // Render targets with mipmaps get transfer usage for automipmapping
@@ -3169,10 +3751,12 @@ static bool lovrShaderInit(Shader* shader) {
       .flagCount = shader->overrideCount
     };
 
-    lovrAssert(state.pipelineCount < MAX_PIPELINES, "Too many pipelines!");
-    shader->computePipeline = getPipeline(state.pipelineCount++);
-    lovrAssert(os_vm_commit(state.pipelines, state.pipelineCount * gpu_sizeof_pipeline()), "Out of pipeline memory");
+    uint32_t index;
+    if (!reservePipeline(shader->gpu, &index)) return false;
+    shader->computePipeline = getPipeline(index);
     lovrAssert(gpu_pipeline_init_compute(shader->computePipeline, &pipelineInfo), "Failed to create compute shader pipeline: %s", gpu_get_error());
+  } else if (state.pipelineCache.length > 0) {
+    prewarmPipelines(shader);
   }
 
   return true;
@@ -3231,11 +3815,14 @@ Shader* lovrGraphicsGetDefaultShader(DefaultShader type) {
     return state.defaultShaders[type];
   }
 
+  // Forks create all of the default graphics shaders up front, so this only happens on main thread
+  lovrCheck(mainThread, "Default shaders can only be created on the main thread");
+
   switch (type) {
     case SHADER_ANIMATOR:
     case SHADER_BLENDER:
     case SHADER_TALLY_MERGE:
-      return state.defaultShaders[type] = lovrShaderCreate(&(ShaderInfo) {
+      state.defaultShaders[type] = lovrShaderCreate(&(ShaderInfo) {
         .type = SHADER_COMPUTE,
         .stages = (ShaderSource[1]) {
           lovrGraphicsGetDefaultShaderSource(type, STAGE_COMPUTE)
@@ -3245,8 +3832,9 @@ Shader* lovrGraphicsGetDefaultShader(DefaultShader type) {
         .flagCount = 1,
         .isDefault = true
       });
+      break;
     default:
-      return state.defaultShaders[type] = lovrShaderCreate(&(ShaderInfo) {
+      state.defaultShaders[type] = lovrShaderCreate(&(ShaderInfo) {
         .type = SHADER_GRAPHICS,
         .stages = (ShaderSource[2]) {
           lovrGraphicsGetDefaultShaderSource(type, STAGE_VERTEX),
@@ -3255,7 +3843,10 @@ Shader* lovrGraphicsGetDefaultShader(DefaultShader type) {
         .stageCount = 2,
         .isDefault = true
       });
+      break;
   }
+
+  return state.defaultShaders[type];
 }
 
 Shader* lovrShaderCreate(const ShaderInfo* info) {
@@ -3291,6 +3882,13 @@ Shader* lovrShaderCreate(const ShaderInfo* info) {
     memcpy(source[i], info->stages[i].code, info->stages[i].size);
   }
 
+  // Hash the source, used to match pipelines saved in the pipeline cache
+  uint64_t hashes[2] = { 0 };
+  for (uint32_t i = 0; i < info->stageCount; i++) {
+    hashes[i] = hash64(info->stages[i].code, info->stages[i].size);
+  }
+  shader->hash = hash64(hashes, sizeof(hashes));
+
   // Parse SPIR-V
   spv_result result;
   spv_info spv[2] = { 0 };
@@ -3638,6 +4236,23 @@ Shader* lovrShaderCreate(const ShaderInfo* info) {
 
   shader->pushConstantSize = gpu.pushConstantSize;
 
+  // Draws can only be batched if the vertex shader knows how to find the DrawData for an instance,
+  // which shaders written against older versions of the builtins don't.  The other stages only see
+  // the DrawID of the first draw in a batch, so shaders that read it outside of the vertex stage
+  // can't be batched either.
+  for (uint32_t i = 0; i < info->stageCount; i++) {
+    if (info->stages[i].stage == STAGE_VERTEX && spv[i].pushConstants && spv[i].pushConstants->fieldCount > 0) {
+      const char* name = spv[i].pushConstants->fields[0].name;
+      shader->batchable = name && !strcmp(name, "DrawBits");
+    }
+  }
+
+  for (uint32_t i = 0; i < info->stageCount; i++) {
+    if (info->stages[i].stage != STAGE_VERTEX && spv[i].pushConstantsUsed) {
+      shader->batchable = false;
+    }
+  }
+
   if (info->type == SHADER_GRAPHICS) {
     gpu.layouts[0] = state.builtinLayout->gpu;
     gpu.layouts[1] = state.materialLayout->gpu;
@@ -3671,8 +4286,10 @@ Shader* lovrShaderClone(Shader* parent, ShaderFlag* flags, uint32_t count) {
   shader->info.flags = flags;
   shader->info.flagCount = count;
   shader->layout = parent->layout;
+  shader->hash = parent->hash;
   memcpy(shader->workgroupSize, parent->workgroupSize, sizeof(shader->workgroupSize));
   shader->hasCustomAttributes = parent->hasCustomAttributes;
+  shader->batchable = parent->batchable;
   shader->attributeCount = parent->attributeCount;
   shader->resourceCount = parent->resourceCount;
   shader->bufferMask = parent->bufferMask;
@@ -3700,9 +4317,13 @@ Shader* lovrShaderClone(Shader* parent, ShaderFlag* flags, uint32_t count) {
 
 void lovrShaderDestroy(void* ref) {
   Shader* shader = ref;
+  if (shader->computePipeline) {
+    freePipeline((uint32_t) (((char*) shader->computePipeline - (char*) state.pipelines) / gpu_sizeof_pipeline()));
+  }
   if (shader->parent) {
     lovrRelease(shader->parent, lovrShaderDestroy);
   } else {
+    evictPipelines(shader->gpu);
     gpu_shader_destroy(shader->gpu);
     lovrFree(shader->attributes);
     lovrFree(shader->resources);
@@ -4012,6 +4633,7 @@ Font* lovrFontCreate(const FontInfo* info) {
       arr_expand(&font->glyphs, 1);
       Glyph* glyph = &font->glyphs.data[font->glyphs.length++];
       uint32_t codepoint = lovrRasterizerGetAtlasGlyph(info->rasterizer, i, &glyph->x, &glyph->y);
+      glyph->codepoint = codepoint;
       map_set(&font->glyphLookup, hash64(&codepoint, 4), font->glyphs.length - 1);
 
       lovrRasterizerGetGlyphBoundingBox(info->rasterizer, codepoint, glyph->box);
@@ -4036,207 +4658,738 @@ Font* lovrFontCreate(const FontInfo* info) {
       font->atlasWidth <<= 1;
       font->atlasHeight <<= 1;
     }
+
+    uint64_t key = getFontCacheKey(font);
+
+    mtx_lock(&state.lock);
+    arr_push(&state.fonts, font);
+    uint64_t offset = map_get(&state.fontCacheLookup, key);
+    if (offset != MAP_NIL) map_set(&state.fontCacheLookup, key, offset | 1);
+    mtx_unlock(&state.lock);
+
+    // The cache entry is only read from here on, glyphs get copied out of it as they're loaded
+    if (offset != MAP_NIL) {
+      uint64_t size;
+      const char* entry = state.fontCacheData + (offset & ~1ull);
+      memcpy(&size, entry, sizeof(size));
+
+      if (checkFontCache(font, entry + sizeof(size), size)) {
+        font->cache = (const FontCacheHeader*) (entry + sizeof(size));
+        font->cacheSize = size;
+        map_init(&font->cacheLookup, font->cache->glyphCount);
+        const FontCacheGlyph* glyphs = (const FontCacheGlyph*) (font->cache + 1);
+        for (uint32_t i = 0; i < font->cache->glyphCount; i++) {
+          map_set(&font->cacheLookup, hash64(&glyphs[i].codepoint, 4), i);
+        }
+      }
+    }
+  }
+
+  return font;
+}
+
+void lovrFontDestroy(void* ref) {
+  Font* font = ref;
+  if (state.ref) {
+    mtx_lock(&state.lock);
+    for (size_t i = 0; i < state.fonts.length; i++) {
+      if (state.fonts.data[i] == font) {
+        state.fonts.data[i] = arr_pop(&state.fonts);
+        break;
+      }
+    }
+    mtx_unlock(&state.lock);
+  }
+#ifndef LOVR_DISABLE_THREAD
+  if (font->prewarm) {
+    job_group_wait(&font->prewarm->group);
+    lovrFree(font->prewarm->tasks);
+    lovrFree(font->prewarm->pixels);
+    lovrFree(font->prewarm);
+  }
+#endif
+  lovrRelease(font->info.rasterizer, lovrRasterizerDestroy);
+  lovrRelease(font->material, lovrMaterialDestroy);
+  lovrRelease(font->atlas, lovrTextureDestroy);
+  arr_free(&font->glyphs);
+  map_free(&font->glyphLookup);
+  map_free(&font->cacheLookup);
+  lovrFree(font);
+}
+
+const FontInfo* lovrFontGetInfo(Font* font) {
+  return &font->info;
+}
+
+float lovrFontGetPixelDensity(Font* font) {
+  return font->pixelDensity;
+}
+
+void lovrFontSetPixelDensity(Font* font, float pixelDensity) {
+  font->pixelDensity = pixelDensity;
+}
+
+float lovrFontGetLineSpacing(Font* font) {
+  return font->lineSpacing;
+}
+
+void lovrFontSetLineSpacing(Font* font, float spacing) {
+  font->lineSpacing = spacing;
+}
+
+static int u32cmp(const void* a, const void* b) {
+  uint32_t x = *(uint32_t*) a, y = *(uint32_t*) b;
+  return (x > y) - (x < y);
+}
+
+// Glyphs in the Font's cache get copied out of the cached atlas instead of being rasterized again.
+// They still get packed the same way as rasterized glyphs, so the cache doesn't change the results.
+static const uint8_t* getCachedGlyph(Font* font, GlyphTask* task) {
+  if (!font->cache) {
+    return NULL;
+  }
+
+  uint64_t index = map_get(&font->cacheLookup, hash64(&task->codepoint, 4));
+
+  if (index == MAP_NIL) {
+    return NULL;
+  }
+
+  const FontCacheHeader* header = font->cache;
+  const FontCacheGlyph* glyphs = (const FontCacheGlyph*) (header + 1);
+  const FontCacheGlyph* glyph = &glyphs[index];
+
+  if (memcmp(glyph->box, task->box, sizeof(task->box)) || glyph->x < font->padding || glyph->y < font->padding) {
+    return NULL;
+  }
+
+  uint32_t x = glyph->x - font->padding;
+  uint32_t y = glyph->y - font->padding;
+
+  if (x + task->width > header->atlasWidth || y + task->height > header->atlasHeight) {
+    return NULL;
+  }
+
+  const uint8_t* pixels = (const uint8_t*) (glyphs + header->glyphCount);
+  return pixels + ((size_t) y * header->atlasWidth + x) * 4;
+}
+
+// Sorts out the glyphs that need to be rasterized.  Empty glyphs don't need any space in the atlas,
+// so they get added right away.  The codepoints are sorted in place to remove duplicates.
+static uint32_t measureGlyphs(Font* font, uint32_t* codepoints, uint32_t count, GlyphTask* tasks, uint32_t* size) {
+  uint32_t taskCount = 0;
+  *size = 0;
+
+  qsort(codepoints, count, sizeof(uint32_t), u32cmp);
+
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t codepoint = codepoints[i];
+    uint64_t hash = hash64(&codepoint, 4);
+
+    if ((i > 0 && codepoint == codepoints[i - 1]) || map_get(&font->glyphLookup, hash) != MAP_NIL) {
+      continue;
+    }
+
+    if (lovrRasterizerIsGlyphEmpty(font->info.rasterizer, codepoint)) {
+      arr_expand(&font->glyphs, 1);
+      Glyph* glyph = &font->glyphs.data[font->glyphs.length];
+      memset(glyph, 0, sizeof(Glyph));
+      glyph->codepoint = codepoint;
+      glyph->advance = lovrRasterizerGetAdvance(font->info.rasterizer, codepoint);
+      map_set(&font->glyphLookup, hash, font->glyphs.length++);
+      continue;
+    }
+
+    GlyphTask* task = &tasks[taskCount++];
+    task->codepoint = codepoint;
+    task->advance = lovrRasterizerGetAdvance(font->info.rasterizer, codepoint);
+    lovrRasterizerGetGlyphBoundingBox(font->info.rasterizer, codepoint, task->box);
+    task->width = 2 * font->padding + (uint32_t) ceilf(task->box[2] - task->box[0]);
+    task->height = 2 * font->padding + (uint32_t) ceilf(task->box[3] - task->box[1]);
+    task->offset = *size;
+    task->cached = getCachedGlyph(font, task);
+    font->dirty |= !task->cached;
+    *size += task->width * task->height * 4;
+  }
+
+  return taskCount;
+}
+
+// Rasterizers are only read from here, so this can run on any thread
+static void rasterizeGlyphs(void* arg, uint32_t start, uint32_t end) {
+  GlyphBatch* batch = arg;
+  for (uint32_t i = start; i < end; i++) {
+    GlyphTask* task = &batch->tasks[i];
+    uint8_t* dst = batch->pixels + task->offset;
+
+    if (task->cached) {
+      for (uint32_t y = 0; y < task->height; y++) {
+        memcpy(dst + y * task->width * 4, task->cached + y * batch->cacheStride, task->width * 4);
+      }
+      continue;
+    }
+
+    uint32_t count = task->width * task->height * 4;
+    float* pixels = lovrCalloc(count * sizeof(float));
+    lovrRasterizerGetPixels(batch->rasterizer, task->codepoint, pixels, task->width, task->height, batch->spread);
+    for (uint32_t j = 0; j < count; j++) {
+      float f = pixels[j]; // CLAMP would evaluate this multiple times
+      dst[j] = (uint8_t) (CLAMP(f, 0.f, 1.f) * 255.f + .5f);
+    }
+    lovrFree(pixels);
+  }
+}
+
+#ifndef LOVR_DISABLE_THREAD
+static void rasterizeJob(void* arg) {
+  GlyphBatch* batch = arg;
+  uint32_t i;
+  while ((i = atomic_fetch_add(&batch->next, 1)) < batch->count) {
+    rasterizeGlyphs(batch, i, i + 1);
+  }
+}
+#endif
+
+static bool createAtlas(Font* font, uint32_t width, uint32_t height, Texture** atlas, Material** material) {
+  *atlas = lovrTextureCreate(&(TextureInfo) {
+    .type = TEXTURE_2D,
+    .format = FORMAT_RGBA8,
+    .width = width,
+    .height = height,
+    .layers = 1,
+    .mipmaps = 1,
+    .samples = 1,
+    .usage = TEXTURE_SAMPLE | TEXTURE_TRANSFER,
+    .label = "Font Atlas"
+  });
+
+  if (!*atlas) {
+    return false;
+  }
+
+  *material = lovrMaterialCreate(&(MaterialInfo) {
+    .data.color = { 1.f, 1.f, 1.f, 1.f },
+    .data.uvScale = { 1.f, 1.f },
+    .data.sdfRange = { font->info.spread / width, font->info.spread / height },
+    .texture = *atlas
+  });
+
+  if (!*material) {
+    lovrTextureDestroy(*atlas);
+    return false;
+  }
+
+  return true;
+}
+
+static bool resizeAtlas(Font* font) {
+  uint32_t newWidth = font->atlasWidth << (font->atlasWidth == font->atlasHeight);
+  uint32_t newHeight = font->atlasHeight << (font->atlasWidth != font->atlasHeight);
+  lovrCheck(newWidth <= 65536, "Font atlas is way too big!");
+
+  Texture* atlas;
+  Material* material;
+  if (!createAtlas(font, newWidth, newHeight, &atlas, &material)) {
+    return false;
+  }
+
+  float clear[4] = { 0.f, 0.f, 0.f, 0.f };
+  gpu_clear_texture(state.stream, atlas->gpu, clear, 0, ~0u, 0, ~0u);
+
+  // This barrier serves 2 purposes:
+  // - Ensure new atlas clear is finished/flushed before copying to it
+  // - Ensure any unsynchronized pending uploads to old atlas finish before copying to new atlas
+  gpu_barrier barrier;
+  barrier.prev = GPU_PHASE_COPY | GPU_PHASE_CLEAR;
+  barrier.next = GPU_PHASE_COPY;
+  barrier.flush = GPU_CACHE_TRANSFER_WRITE;
+  barrier.clear = GPU_CACHE_TRANSFER_READ | GPU_CACHE_TRANSFER_WRITE;
+  gpu_sync(state.stream, &barrier, 1);
+
+  if (font->atlas) {
+    uint32_t srcOffset[4] = { 0, 0, 0, 0 };
+    uint32_t dstOffset[4] = { 0, 0, 0, 0 };
+    uint32_t extent[3] = { font->atlasWidth, font->atlasHeight, 1 };
+    gpu_copy_textures(state.stream, font->atlas->gpu, atlas->gpu, srcOffset, dstOffset, extent);
+  }
+
+  lovrRelease(font->material, lovrMaterialDestroy);
+  lovrRelease(font->atlas, lovrTextureDestroy);
+  font->material = material;
+  font->atlas = atlas;
+  font->atlasWidth = newWidth;
+  font->atlasHeight = newHeight;
+  font->rowHeight = 0;
+
+  // Adjust the cursor after a successful resize, but only if this isn't the first glyph
+  if (font->atlasX > 0 || font->atlasY > 0) {
+    if (newWidth == newHeight) {
+      font->atlasX = 0;
+      font->atlasY = newHeight / 2;
+    } else {
+      font->atlasX = newWidth / 2;
+      font->atlasY = 0;
+    }
+  }
+
+  // Recompute all glyph uvs after atlas resize
+  for (size_t i = 0; i < font->glyphs.length; i++) {
+    Glyph* g = &font->glyphs.data[i];
+    if (g->box[2] - g->box[0] > 0.f) {
+      g->uv[0] = (uint16_t) ((float) g->x / newWidth * 65535.f + .5f);
+      g->uv[1] = (uint16_t) ((float) g->y / newHeight * 65535.f + .5f);
+      g->uv[2] = (uint16_t) ((float) (g->x + g->box[2] - g->box[0]) / newWidth * 65535.f + .5f);
+      g->uv[3] = (uint16_t) ((float) (g->y + g->box[3] - g->box[1]) / newHeight * 65535.f + .5f);
+    }
+  }
+
+  return true;
+}
+
+// Packs glyphs into the atlas and adds them to the Font, growing the atlas as needed
+static bool placeGlyphs(Font* font, GlyphTask* tasks, uint32_t count, bool* resized) {
+  for (uint32_t i = 0; i < count; i++) {
+    GlyphTask* task = &tasks[i];
+    bool wrap = font->atlasX + task->width > font->atlasWidth;
+    bool resize = font->atlasY + (wrap ? font->rowHeight : 0) + task->height > font->atlasHeight;
+
+    if (!font->atlas || resize) {
+      if (!resizeAtlas(font)) {
+        return false;
+      }
+
+      if (resized) *resized = true;
+      wrap = false;
+    }
+
+    if (wrap) {
+      font->atlasX = font->atlasWidth == font->atlasHeight ? 0 : font->atlasWidth >> 1;
+      font->atlasY += font->rowHeight;
+    }
+
+    task->x = font->atlasX;
+    task->y = font->atlasY;
+
+    float width = task->box[2] - task->box[0];
+    float height = task->box[3] - task->box[1];
+
+    arr_expand(&font->glyphs, 1);
+    Glyph* glyph = &font->glyphs.data[font->glyphs.length];
+    glyph->codepoint = task->codepoint;
+    glyph->advance = task->advance;
+    memcpy(glyph->box, task->box, sizeof(glyph->box));
+    glyph->x = font->atlasX + font->padding;
+    glyph->y = font->atlasY + font->padding;
+    glyph->uv[0] = (uint16_t) ((float) glyph->x / font->atlasWidth * 65535.f + .5f);
+    glyph->uv[1] = (uint16_t) ((float) glyph->y / font->atlasHeight * 65535.f + .5f);
+    glyph->uv[2] = (uint16_t) ((float) (glyph->x + width) / font->atlasWidth * 65535.f + .5f);
+    glyph->uv[3] = (uint16_t) ((float) (glyph->y + height) / font->atlasHeight * 65535.f + .5f);
+    map_set(&font->glyphLookup, hash64(&task->codepoint, 4), font->glyphs.length++);
+
+    font->atlasX += task->width;
+    font->rowHeight = MAX(font->rowHeight, task->height);
+  }
+
+  return true;
+}
+
+// Copies all of the glyphs from the staging buffer to the atlas, with a single barrier
+static void uploadGlyphs(Font* font, GlyphTask* tasks, uint32_t count, BufferView* view) {
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t dstOffset[4] = { tasks[i].x, tasks[i].y, 0, 0 };
+    uint32_t extent[3] = { tasks[i].width, tasks[i].height, 1 };
+    gpu_copy_buffer_texture(state.stream, view->buffer, font->atlas->gpu, view->offset + tasks[i].offset, dstOffset, extent);
+  }
+
+  state.barrier.prev |= GPU_PHASE_COPY;
+  state.barrier.next |= GPU_PHASE_SHADER_FRAGMENT;
+  state.barrier.flush |= GPU_CACHE_TRANSFER_WRITE;
+  state.barrier.clear |= GPU_CACHE_TEXTURE;
+}
+
+// Adds prewarmed glyphs to the atlas once they're ready, or right away if wait is true
+static bool flushGlyphs(Font* font, bool wait) {
+#ifndef LOVR_DISABLE_THREAD
+  GlyphBatch* batch = font->prewarm;
+
+  if (!batch || (!wait && atomic_load(&batch->group.pending) > 0)) {
+    return true;
+  }
+
+  job_group_wait(&batch->group);
+  font->prewarm = NULL;
+
+  // Skip any glyphs that got loaded some other way in the meantime
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < batch->count; i++) {
+    if (map_get(&font->glyphLookup, hash64(&batch->tasks[i].codepoint, 4)) == MAP_NIL) {
+      batch->tasks[count++] = batch->tasks[i];
+    }
+  }
+
+  BufferView view = { 0 };
+  bool success = true;
+
+  if (count > 0) {
+    if (!beginFrame() || (view = getBuffer(GPU_BUFFER_UPLOAD, batch->size, 64)).buffer == NULL) {
+      success = false;
+    } else {
+      memcpy(view.pointer, batch->pixels, batch->size);
+      success = placeGlyphs(font, batch->tasks, count, NULL);
+      if (success) uploadGlyphs(font, batch->tasks, count, &view);
+    }
+  }
+
+  lovrFree(batch->tasks);
+  lovrFree(batch->pixels);
+  lovrFree(batch);
+  return success;
+#else
+  return true;
+#endif
+}
+
+// Rasterizes glyphs in parallel straight into the staging buffer
+static bool loadGlyphs(Font* font, uint32_t* codepoints, uint32_t count, bool* resized) {
+  if (count == 0) {
+    return true;
+  }
+
+  // If any of the glyphs are already being prewarmed, wait for those instead of doing them twice
+  for (uint32_t i = 0; font->prewarm && i < count; i++) {
+    if (bsearch(&codepoints[i], font->prewarm->tasks, font->prewarm->count, sizeof(GlyphTask), u32cmp)) {
+      if (!flushGlyphs(font, true)) return false;
+      break;
+    }
+  }
+
+  size_t stack = tempPush(&state.allocator);
+  GlyphTask* tasks = tempAlloc(&state.allocator, count * sizeof(GlyphTask));
+  uint32_t size;
+  uint32_t taskCount = measureGlyphs(font, codepoints, count, tasks, &size);
+
+  if (taskCount == 0) {
+    tempPop(&state.allocator, stack);
+    return true;
+  }
+
+  BufferView view = { 0 };
+
+  if (!beginFrame() || (view = getBuffer(GPU_BUFFER_UPLOAD, size, 64)).buffer == NULL) {
+    tempPop(&state.allocator, stack);
+    return false;
+  }
+
+  GlyphBatch batch = {
+    .rasterizer = font->info.rasterizer,
+    .spread = font->info.spread,
+    .tasks = tasks,
+    .count = taskCount,
+    .size = size,
+    .pixels = view.pointer,
+    .cacheStride = font->cache ? font->cache->atlasWidth * 4 : 0
+  };
+
+#ifndef LOVR_DISABLE_THREAD
+  job_parallel_for(taskCount, 1, rasterizeGlyphs, &batch);
+#else
+  rasterizeGlyphs(&batch, 0, taskCount);
+#endif
+
+  bool success = placeGlyphs(font, tasks, taskCount, resized);
+  if (success) uploadGlyphs(font, tasks, taskCount, &view);
+  tempPop(&state.allocator, stack);
+  return success;
+}
+
+static Glyph* lovrFontGetGlyph(Font* font, uint32_t codepoint, bool* resized) {
+  uint64_t hash = hash64(&codepoint, 4);
+  uint64_t index = map_get(&font->glyphLookup, hash);
+
+  if (resized) *resized = false;
+
+  if (index == MAP_NIL) {
+    if (!loadGlyphs(font, &codepoint, 1, resized)) {
+      return NULL;
+    }
+
+    index = map_get(&font->glyphLookup, hash);
+  }
+
+  return &font->glyphs.data[index];
+}
+
+// Loads all of the glyphs the strings need up front, so they get rasterized in parallel
+static bool prepareGlyphs(Font* font, ColoredString* strings, uint32_t count) {
+  size_t stack = tempPush(&state.allocator);
+  uint32_t* missing = NULL;
+  uint32_t missingCount = 0;
+  size_t totalLength = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    totalLength += strings[i].length;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    size_t bytes;
+    uint32_t codepoint;
+    const char* str = strings[i].string;
+    const char* end = strings[i].string + strings[i].length;
+    while ((bytes = utf8_decode(str, end, &codepoint)) > 0) {
+      str += bytes;
+      if (codepoint == ' ' || codepoint == '\t' || codepoint == '\n' || codepoint == '\r') continue;
+      if (map_get(&font->glyphLookup, hash64(&codepoint, 4)) != MAP_NIL) continue;
+      if (!missing) missing = tempAlloc(&state.allocator, totalLength * sizeof(uint32_t));
+      missing[missingCount++] = codepoint;
+    }
   }
 
-  return font;
+  bool success = loadGlyphs(font, missing, missingCount, NULL) && flushGlyphs(font, false);
+  tempPop(&state.allocator, stack);
+  return success;
 }
 
-void lovrFontDestroy(void* ref) {
-  Font* font = ref;
-  lovrRelease(font->info.rasterizer, lovrRasterizerDestroy);
-  lovrRelease(font->material, lovrMaterialDestroy);
-  lovrRelease(font->atlas, lovrTextureDestroy);
-  arr_free(&font->glyphs);
-  map_free(&font->glyphLookup);
-  lovrFree(font);
-}
+bool lovrFontPrewarm(Font* font, uint32_t* codepoints, uint32_t count) {
+#ifndef LOVR_DISABLE_THREAD
+  if (!flushGlyphs(font, true)) {
+    return false;
+  }
 
-const FontInfo* lovrFontGetInfo(Font* font) {
-  return &font->info;
-}
+  uint32_t present = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    if (lovrRasterizerHasGlyph(font->info.rasterizer, codepoints[i])) {
+      codepoints[present++] = codepoints[i];
+    }
+  }
 
-float lovrFontGetPixelDensity(Font* font) {
-  return font->pixelDensity;
-}
+  GlyphTask* tasks = lovrMalloc(MAX(present, 1) * sizeof(GlyphTask));
+  uint32_t size;
+  uint32_t taskCount = measureGlyphs(font, codepoints, present, tasks, &size);
 
-void lovrFontSetPixelDensity(Font* font, float pixelDensity) {
-  font->pixelDensity = pixelDensity;
-}
+  if (taskCount == 0) {
+    lovrFree(tasks);
+    return true;
+  }
 
-float lovrFontGetLineSpacing(Font* font) {
-  return font->lineSpacing;
+  GlyphBatch* batch = lovrCalloc(sizeof(GlyphBatch));
+  batch->rasterizer = font->info.rasterizer;
+  batch->spread = font->info.spread;
+  batch->tasks = tasks;
+  batch->count = taskCount;
+  batch->size = size;
+  batch->pixels = lovrMalloc(size);
+  batch->cacheStride = font->cache ? font->cache->atlasWidth * 4 : 0;
+  font->prewarm = batch;
+
+  // Each job keeps grabbing glyphs until they're all claimed, so this is just an upper bound
+  job_group_init(&batch->group);
+  for (uint32_t i = 0; i < MIN(taskCount, 16); i++) {
+    job_group_add(&batch->group, rasterizeJob, batch);
+  }
+  job_group_then(&batch->group, NULL, NULL, NULL);
+  return true;
+#else
+  return loadGlyphs(font, codepoints, count, NULL);
+#endif
 }
 
-void lovrFontSetLineSpacing(Font* font, float spacing) {
-  font->lineSpacing = spacing;
+static uint64_t getFontCacheKey(Font* font) {
+  struct { uint64_t rasterizer; double spread; uint64_t padding; } key = {
+    lovrRasterizerGetHash(font->info.rasterizer),
+    font->info.spread,
+    font->padding
+  };
+  return hash64(&key, sizeof(key));
 }
 
-static Glyph* lovrFontGetGlyph(Font* font, uint32_t codepoint, bool* resized) {
-  uint64_t hash = hash64(&codepoint, 4);
-  uint64_t index = map_get(&font->glyphLookup, hash);
+// The cache is the atlas image along with the glyph metrics and where they are in the atlas
+void* lovrFontGetCache(Font* font, size_t* size) {
+  lovrCheck(lovrRasterizerGetType(font->info.rasterizer) == RASTERIZER_TTF, "Only TTF fonts can be cached");
 
-  if (index != MAP_NIL) {
-    if (resized) *resized = false;
-    return &font->glyphs.data[index];
+  if (!flushGlyphs(font, true)) {
+    return NULL;
   }
 
-  arr_expand(&font->glyphs, 1);
-  Glyph* glyph = &font->glyphs.data[font->glyphs.length];
-  glyph->advance = lovrRasterizerGetAdvance(font->info.rasterizer, codepoint);
+  Image* image = NULL;
 
-  if (lovrRasterizerIsGlyphEmpty(font->info.rasterizer, codepoint)) {
-    memset(glyph->box, 0, sizeof(glyph->box));
-    if (resized) *resized = false;
-    map_set(&font->glyphLookup, hash, font->glyphs.length++);
-    return glyph;
+  if (font->atlas) {
+    uint32_t offset[4] = { 0, 0, 0, 0 };
+    uint32_t extent[3] = { font->atlasWidth, font->atlasHeight, 1 };
+    if ((image = lovrTextureGetPixels(font->atlas, offset, extent)) == NULL) {
+      return NULL;
+    }
   }
 
-  lovrRasterizerGetGlyphBoundingBox(font->info.rasterizer, codepoint, glyph->box);
+  FontCacheHeader header = {
+    .magic = FONT_CACHE_MAGIC,
+    .version = FONT_CACHE_VERSION,
+    .key = getFontCacheKey(font),
+    .atlasWidth = font->atlas ? font->atlasWidth : 0,
+    .atlasHeight = font->atlas ? font->atlasHeight : 0,
+    .atlasX = font->atlasX,
+    .atlasY = font->atlasY,
+    .rowHeight = font->rowHeight,
+    .glyphCount = (uint32_t) font->glyphs.length
+  };
 
-  float width = glyph->box[2] - glyph->box[0];
-  float height = glyph->box[3] - glyph->box[1];
-  uint32_t pixelWidth = 2 * font->padding + (uint32_t) ceilf(width);
-  uint32_t pixelHeight = 2 * font->padding + (uint32_t) ceilf(height);
+  size_t pixelSize = (size_t) header.atlasWidth * header.atlasHeight * 4;
+  *size = sizeof(header) + header.glyphCount * sizeof(FontCacheGlyph) + pixelSize;
+  char* data = lovrMalloc(*size);
+  memcpy(data, &header, sizeof(header));
 
-  if (!beginFrame()) {
-    return NULL;
+  FontCacheGlyph* glyphs = (FontCacheGlyph*) (data + sizeof(header));
+  for (size_t i = 0; i < font->glyphs.length; i++) {
+    glyphs[i].codepoint = font->glyphs.data[i].codepoint;
+    glyphs[i].advance = font->glyphs.data[i].advance;
+    memcpy(glyphs[i].box, font->glyphs.data[i].box, sizeof(glyphs[i].box));
+    glyphs[i].x = font->glyphs.data[i].x;
+    glyphs[i].y = font->glyphs.data[i].y;
+  }
+
+  if (image) {
+    memcpy(data + sizeof(header) + header.glyphCount * sizeof(FontCacheGlyph), lovrImageGetLayerData(image, 0, 0), pixelSize);
+    lovrRelease(image, lovrImageDestroy);
   }
 
-  BufferView bufferView = getBuffer(GPU_BUFFER_UPLOAD, pixelWidth * pixelHeight * 4 * sizeof(uint8_t), 64);
+  return data;
+}
 
-  if (!bufferView.buffer) {
-    return NULL;
+// Checks that a cache is for this Font and that everything in it fits in its atlas, otherwise glyph
+// UVs (or glyphs copied out of the cached atlas) would read outside of it
+static bool checkFontCache(Font* font, const void* data, size_t size) {
+  FontCacheHeader header;
+
+  if (size < sizeof(header) || lovrRasterizerGetType(font->info.rasterizer) != RASTERIZER_TTF) {
+    return false;
   }
 
-  bool wrap = font->atlasX + pixelWidth > font->atlasWidth;
-  bool resize = font->atlasY + (wrap ? font->rowHeight : 0) + pixelHeight > font->atlasHeight;
+  memcpy(&header, data, sizeof(header));
 
-  if (!font->atlas || resize) {
-    uint32_t newWidth = font->atlasWidth << (font->atlasWidth == font->atlasHeight);
-    uint32_t newHeight = font->atlasHeight << (font->atlasWidth != font->atlasHeight);
-    lovrCheck(newWidth <= 65536, "Font atlas is way too big!");
+  size_t pixelSize = (size_t) header.atlasWidth * header.atlasHeight * 4;
 
-    Texture* atlas = lovrTextureCreate(&(TextureInfo) {
-      .type = TEXTURE_2D,
-      .format = FORMAT_RGBA8,
-      .width = newWidth,
-      .height = newHeight,
-      .layers = 1,
-      .mipmaps = 1,
-      .samples = 1,
-      .usage = TEXTURE_SAMPLE | TEXTURE_TRANSFER,
-      .label = "Font Atlas"
-    });
+  if (
+    header.magic != FONT_CACHE_MAGIC ||
+    header.version != FONT_CACHE_VERSION ||
+    header.key != getFontCacheKey(font) ||
+    header.atlasWidth > 65536 ||
+    header.atlasHeight > 65536 ||
+    header.glyphCount > (size - sizeof(header)) / sizeof(FontCacheGlyph) ||
+    pixelSize != size - sizeof(header) - header.glyphCount * sizeof(FontCacheGlyph)
+  ) {
+    return false;
+  }
 
-    if (!atlas) {
-      return NULL;
+  const FontCacheGlyph* glyphs = (const FontCacheGlyph*) ((const char*) data + sizeof(header));
+
+  if (header.atlasWidth > 0) {
+    if (header.atlasX > header.atlasWidth || header.atlasY > header.atlasHeight || header.rowHeight > header.atlasHeight) {
+      return false;
     }
 
-    Material* material = lovrMaterialCreate(&(MaterialInfo) {
-      .data.color = { 1.f, 1.f, 1.f, 1.f },
-      .data.uvScale = { 1.f, 1.f },
-      .data.sdfRange = { font->info.spread / newWidth, font->info.spread / newHeight },
-      .texture = atlas
-    });
+    for (uint32_t i = 0; i < header.glyphCount; i++) {
+      float width = glyphs[i].box[2] - glyphs[i].box[0];
+      float height = glyphs[i].box[3] - glyphs[i].box[1];
 
-    if (!material) {
-      lovrTextureDestroy(atlas);
-      return NULL;
+      if (
+        !(width >= 0.f && height >= 0.f) ||
+        glyphs[i].x + width > header.atlasWidth ||
+        glyphs[i].y + height > header.atlasHeight
+      ) {
+        return false;
+      }
     }
+  }
 
-    float clear[4] = { 0.f, 0.f, 0.f, 0.f };
-    gpu_clear_texture(state.stream, atlas->gpu, clear, 0, ~0u, 0, ~0u);
+  return true;
+}
 
-    // This barrier serves 2 purposes:
-    // - Ensure new atlas clear is finished/flushed before copying to it
-    // - Ensure any unsynchronized pending uploads to old atlas finish before copying to new atlas
-    gpu_barrier barrier;
-    barrier.prev = GPU_PHASE_COPY | GPU_PHASE_CLEAR;
-    barrier.next = GPU_PHASE_COPY;
-    barrier.flush = GPU_CACHE_TRANSFER_WRITE;
-    barrier.clear = GPU_CACHE_TRANSFER_READ | GPU_CACHE_TRANSFER_WRITE;
-    gpu_sync(state.stream, &barrier, 1);
+// Caches that are for a different font or are malformed are ignored, and so are caches for Fonts
+// that have already put glyphs in their atlas
+bool lovrFontLoadCache(Font* font, const void* data, size_t size, bool* loaded) {
+  lovrCheck(mainThread, "Font caches can only be loaded on the main thread");
+  FontCacheHeader header;
+  *loaded = false;
 
-    if (font->atlas) {
-      uint32_t srcOffset[4] = { 0, 0, 0, 0 };
-      uint32_t dstOffset[4] = { 0, 0, 0, 0 };
-      uint32_t extent[3] = { font->atlasWidth, font->atlasHeight, 1 };
-      gpu_copy_textures(state.stream, font->atlas->gpu, atlas->gpu, srcOffset, dstOffset, extent);
-    }
+  if (!flushGlyphs(font, true)) {
+    return false;
+  }
 
-    lovrRelease(font->material, lovrMaterialDestroy);
-    lovrRelease(font->atlas, lovrTextureDestroy);
-    font->material = material;
-    font->atlas = atlas;
-    font->atlasWidth = newWidth;
-    font->atlasHeight = newHeight;
-    font->rowHeight = 0;
-
-    // Adjust the cursor after a successful resize, but only if this isn't the first glyph
-    if (font->atlasX > 0 || font->atlasY > 0) {
-      if (newWidth == newHeight) {
-        font->atlasX = 0;
-        font->atlasY = newHeight / 2;
-      } else {
-        font->atlasX = newWidth / 2;
-        font->atlasY = 0;
-      }
+  if (font->atlas || !checkFontCache(font, data, size)) {
+    return true;
+  }
+
+  memcpy(&header, data, sizeof(header));
+
+  size_t pixelSize = (size_t) header.atlasWidth * header.atlasHeight * 4;
+  const FontCacheGlyph* glyphs = (const FontCacheGlyph*) ((const char*) data + sizeof(header));
+  const void* pixels = glyphs + header.glyphCount;
+
+  if (header.atlasWidth > 0) {
+    Texture* atlas;
+    Material* material;
+    BufferView view;
+
+    if (!beginFrame() || !createAtlas(font, header.atlasWidth, header.atlasHeight, &atlas, &material)) {
+      return false;
     }
 
-    // Recompute all glyph uvs after atlas resize
-    for (size_t i = 0; i < font->glyphs.length; i++) {
-      Glyph* g = &font->glyphs.data[i];
-      if (g->box[2] - g->box[0] > 0.f) {
-        g->uv[0] = (uint16_t) ((float) g->x / newWidth * 65535.f + .5f);
-        g->uv[1] = (uint16_t) ((float) g->y / newHeight * 65535.f + .5f);
-        g->uv[2] = (uint16_t) ((float) (g->x + g->box[2] - g->box[0]) / newWidth * 65535.f + .5f);
-        g->uv[3] = (uint16_t) ((float) (g->y + g->box[3] - g->box[1]) / newHeight * 65535.f + .5f);
-      }
+    if ((view = getBuffer(GPU_BUFFER_UPLOAD, (uint32_t) pixelSize, 64)).buffer == NULL) {
+      lovrRelease(material, lovrMaterialDestroy);
+      lovrRelease(atlas, lovrTextureDestroy);
+      return false;
     }
 
-    if (resized) *resized = true;
-    wrap = false;
-  }
+    memcpy(view.pointer, pixels, pixelSize);
+    uint32_t dstOffset[4] = { 0, 0, 0, 0 };
+    uint32_t extent[3] = { header.atlasWidth, header.atlasHeight, 1 };
+    gpu_copy_buffer_texture(state.stream, view.buffer, atlas->gpu, view.offset, dstOffset, extent);
 
-  if (wrap) {
-    font->atlasX = font->atlasWidth == font->atlasHeight ? 0 : font->atlasWidth >> 1;
-    font->atlasY += font->rowHeight;
+    state.barrier.prev |= GPU_PHASE_COPY;
+    state.barrier.next |= GPU_PHASE_SHADER_FRAGMENT;
+    state.barrier.flush |= GPU_CACHE_TRANSFER_WRITE;
+    state.barrier.clear |= GPU_CACHE_TEXTURE;
+
+    font->atlas = atlas;
+    font->material = material;
+    font->atlasWidth = header.atlasWidth;
+    font->atlasHeight = header.atlasHeight;
+    font->atlasX = header.atlasX;
+    font->atlasY = header.atlasY;
+    font->rowHeight = header.rowHeight;
   }
 
-  glyph->x = font->atlasX + font->padding;
-  glyph->y = font->atlasY + font->padding;
-  glyph->uv[0] = (uint16_t) ((float) glyph->x / font->atlasWidth * 65535.f + .5f);
-  glyph->uv[1] = (uint16_t) ((float) glyph->y / font->atlasHeight * 65535.f + .5f);
-  glyph->uv[2] = (uint16_t) ((float) (glyph->x + width) / font->atlasWidth * 65535.f + .5f);
-  glyph->uv[3] = (uint16_t) ((float) (glyph->y + height) / font->atlasHeight * 65535.f + .5f);
+  for (uint32_t i = 0; i < header.glyphCount; i++) {
+    uint64_t hash = hash64(&glyphs[i].codepoint, 4);
+
+    if (map_get(&font->glyphLookup, hash) != MAP_NIL) {
+      continue;
+    }
 
-  font->atlasX += pixelWidth;
-  font->rowHeight = MAX(font->rowHeight, pixelHeight);
+    arr_expand(&font->glyphs, 1);
+    Glyph* glyph = &font->glyphs.data[font->glyphs.length];
+    glyph->codepoint = glyphs[i].codepoint;
+    glyph->advance = glyphs[i].advance;
+    memcpy(glyph->box, glyphs[i].box, sizeof(glyph->box));
+    glyph->x = glyphs[i].x;
+    glyph->y = glyphs[i].y;
 
-  size_t stack = tempPush(&state.allocator);
-  float* pixels = tempAlloc(&state.allocator, pixelWidth * pixelHeight * 4 * sizeof(float));
-  lovrRasterizerGetPixels(font->info.rasterizer, codepoint, pixels, pixelWidth, pixelHeight, font->info.spread);
-  float* src = pixels;
-  uint8_t* dst = bufferView.pointer;
-  for (uint32_t y = 0; y < pixelHeight; y++) {
-    for (uint32_t x = 0; x < pixelWidth; x++) {
-      for (uint32_t c = 0; c < 4; c++) {
-        float f = *src++; // CLAMP would evaluate this multiple times
-        *dst++ = (uint8_t) (CLAMP(f, 0.f, 1.f) * 255.f + .5f);
-      }
+    float width = glyph->box[2] - glyph->box[0];
+    float height = glyph->box[3] - glyph->box[1];
+    if (width > 0.f && font->atlas) {
+      glyph->uv[0] = (uint16_t) ((float) glyph->x / font->atlasWidth * 65535.f + .5f);
+      glyph->uv[1] = (uint16_t) ((float) glyph->y / font->atlasHeight * 65535.f + .5f);
+      glyph->uv[2] = (uint16_t) ((float) (glyph->x + width) / font->atlasWidth * 65535.f + .5f);
+      glyph->uv[3] = (uint16_t) ((float) (glyph->y + height) / font->atlasHeight * 65535.f + .5f);
+    } else {
+      memset(glyph->box, 0, sizeof(glyph->box));
+      memset(glyph->uv, 0, sizeof(glyph->uv));
     }
+
+    map_set(&font->glyphLookup, hash, font->glyphs.length++);
   }
-  uint32_t dstOffset[4] = { glyph->x - font->padding, glyph->y - font->padding, 0, 0 };
-  uint32_t extent[3] = { pixelWidth, pixelHeight, 1 };
-  gpu_copy_buffer_texture(state.stream, bufferView.buffer, font->atlas->gpu, bufferView.offset, dstOffset, extent);
-  tempPop(&state.allocator, stack);
 
-  state.barrier.prev |= GPU_PHASE_COPY;
-  state.barrier.next |= GPU_PHASE_SHADER_FRAGMENT;
-  state.barrier.flush |= GPU_CACHE_TRANSFER_WRITE;
-  state.barrier.clear |= GPU_CACHE_TEXTURE;
-  map_set(&font->glyphLookup, hash, font->glyphs.length++);
-  return glyph;
+  *loaded = true;
+  return true;
 }
 
 float lovrFontGetWidth(Font* font, ColoredString* strings, uint32_t count) {
@@ -4381,6 +5534,10 @@ bool lovrFontGetVertices(Font* font, ColoredString* strings, uint32_t count, flo
   float leading = lovrRasterizerGetLeading(font->info.rasterizer) * font->lineSpacing;
   float space = lovrRasterizerGetAdvance(font->info.rasterizer, ' ');
 
+  if (!prepareGlyphs(font, strings, count)) {
+    return false;
+  }
+
   for (uint32_t i = 0; i < count; i++) {
     size_t bytes;
     uint32_t codepoint;
@@ -5759,11 +6916,9 @@ static BufferView lovrPassGetBuffer(Pass* pass, uint32_t size, size_t align) {
 }
 
 static void lovrPassRelease(Pass* pass) {
-  // Chain all of the Pass's full buffers onto the end of the global freelist
+  // Return all of the Pass's full buffers to the global pool
   if (pass->buffers.freelist) {
-    BufferBlock** list = &state.bufferAllocators[GPU_BUFFER_STREAM].freelist;
-    while (*list) list = (BufferBlock**) &(*list)->next;
-    *list = pass->buffers.freelist;
+    freeBlocks(GPU_BUFFER_STREAM, pass->buffers.freelist);
     pass->buffers.freelist = NULL;
   }
 
@@ -5798,6 +6953,19 @@ static void lovrPassRelease(Pass* pass) {
       }
     }
   }
+
+  // Forks are released after the parent, since merged draws and accesses live in their memory
+  for (Pass* fork = pass->forks, *next; fork; fork = next) {
+    next = fork->sibling;
+    fork->parent = NULL;
+    fork->sibling = NULL;
+    fork->merged = false;
+    lovrPassReset(fork);
+    lovrRelease(fork, lovrPassDestroy);
+  }
+
+  pass->forks = NULL;
+  pass->lastFork = NULL;
 }
 
 bool lovrGraphicsGetWindowPass(Pass** pass) {
@@ -5845,6 +7013,75 @@ Pass* lovrPassCreate(const char* label) {
   return pass;
 }
 
+Pass* lovrPassFork(Pass* pass) {
+  lovrCheck(!pass->parent, "Unable to fork a Pass that is already a fork");
+  lovrCheck(!pass->tally.active, "Unable to fork a Pass while a tally is active");
+  lovrCheck(mainThread, "Passes can only be forked on the main thread");
+
+  // Forks may draw on other threads, where default shaders can't be created
+  for (uint32_t i = 0; i < SHADER_ANIMATOR; i++) {
+    if (!lovrGraphicsGetDefaultShader(i)) {
+      return NULL;
+    }
+  }
+
+  Pass* fork = lovrPassCreate(pass->label);
+  fork->canvas = pass->canvas;
+  fork->gpu = pass->gpu;
+
+  for (uint32_t i = 0; i < fork->canvas.count; i++) {
+    lovrRetain(fork->canvas.color[i].texture);
+    lovrRetain(fork->canvas.color[i].resolve);
+  }
+
+  lovrRetain(fork->canvas.depth.texture);
+  lovrRetain(fork->canvas.depth.resolve);
+  lovrRetain(fork->canvas.foveation);
+
+  lovrPassReset(fork);
+
+  // The fork starts out with the parent's current state
+  mat4_init(fork->transform, pass->transform);
+
+  memcpy(fork->pipeline, pass->pipeline, sizeof(Pipeline));
+  fork->pipeline->dirty = true;
+  lovrRetain(fork->pipeline->font);
+  lovrRetain(fork->pipeline->shader);
+  lovrRetain(fork->pipeline->material);
+
+  memcpy(fork->bindings, pass->bindings, 32 * sizeof(gpu_binding));
+  fork->flags |= DIRTY_BINDINGS;
+
+  Shader* shader = pass->pipeline->shader;
+  if (shader && shader->uniformCount > 0) {
+    fork->uniforms = lovrPassAllocate(fork, shader->uniformSize);
+    memcpy(fork->uniforms, pass->uniforms, shader->uniformSize);
+    fork->flags |= DIRTY_UNIFORMS;
+  }
+
+  if (pass->cameraCount > 0) {
+    uint32_t views = pass->canvas.views;
+    memcpy(fork->cameras, pass->cameras + (pass->cameraCount - 1) * views, views * sizeof(Camera));
+  }
+
+  lovrPassSetViewport(fork, pass->viewports + (pass->viewportCount - 1) * 6);
+  lovrPassSetScissor(fork, pass->scissors + (pass->scissorCount - 1) * 4);
+
+  fork->parent = pass;
+  fork->forkDraw = pass->drawCount;
+  fork->forkCompute = pass->computeCount;
+
+  if (pass->lastFork) {
+    pass->lastFork->sibling = fork;
+  } else {
+    pass->forks = fork;
+  }
+
+  pass->lastFork = fork;
+  lovrRetain(fork);
+  return fork;
+}
+
 void lovrPassDestroy(void* ref) {
   Pass* pass = ref;
   lovrPassRelease(pass);
@@ -5862,14 +7099,15 @@ void lovrPassDestroy(void* ref) {
   }
   if (pass->buffers.current) {
     pass->buffers.current->tick = state.tick;
-    freeBlock(&state.bufferAllocators[GPU_BUFFER_STREAM], pass->buffers.current);
+    freeBlock(GPU_BUFFER_STREAM, pass->buffers.current);
   }
   os_vm_free(pass->allocator.memory, pass->allocator.limit);
   lovrFree(pass->label);
   lovrFree(pass);
 }
 
-void lovrPassReset(Pass* pass) {
+bool lovrPassReset(Pass* pass) {
+  lovrCheck(!pass->parent, "Forked passes are reset by their parent");
   lovrPassRelease(pass);
 
   pass->allocator.cursor = 0;
@@ -5933,6 +7171,7 @@ void lovrPassReset(Pass* pass) {
   lovrPassSetScissor(pass, (uint32_t[4]) { 0, 0, canvas->width, canvas->height });
 
   pass->sampler = NULL;
+  return true;
 }
 
 const PassStats* lovrPassGetStats(Pass* pass) {
@@ -5960,6 +7199,7 @@ void lovrPassGetCanvas(Pass* pass, CanvasTexture color[4], CanvasTexture* depth,
 }
 
 bool lovrPassSetCanvas(Pass* pass, CanvasTexture color[4], CanvasTexture* depth, uint32_t depthFormat, Texture* foveation, uint32_t samples) {
+  lovrCheck(!pass->parent, "Unable to change the canvas of a forked Pass");
   Canvas* canvas = &pass->canvas;
 
   for (uint32_t i = 0; i < canvas->count; i++) {
@@ -6522,6 +7762,14 @@ bool lovrPassSetStencilWrite(Pass* pass, StencilAction actions[3], uint8_t value
   return true;
 }
 
+bool lovrPassIsSorting(Pass* pass) {
+  return pass->sort;
+}
+
+void lovrPassSetSorting(Pass* pass, bool enable) {
+  pass->sort = enable;
+}
+
 void lovrPassSetViewCull(Pass* pass, bool enable) {
   pass->pipeline->viewCull = enable;
 }
@@ -6875,6 +8123,8 @@ static bool lovrPassResolveVertices(Pass* pass, DrawInfo* info, Draw* draw) {
 }
 
 bool lovrPassDraw(Pass* pass, DrawInfo* info) {
+  lovrCheck(!pass->merged, "Unable to record draws in a forked Pass after its parent was submitted");
+
   if (pass->drawCount >= pass->drawCapacity) {
     lovrAssert(pass->drawCount < 1 << 16, "Pass has too many draws!");
     pass->drawCapacity = pass->drawCapacity > 0 ? pass->drawCapacity << 1 : 1;
@@ -7771,6 +9021,7 @@ bool lovrPassTorus(Pass* pass, float* transform, uint32_t segmentsT, uint32_t se
 }
 
 bool lovrPassText(Pass* pass, ColoredString* strings, uint32_t count, float* transform, float wrap, HorizontalAlign halign, VerticalAlign valign) {
+  lovrCheck(mainThread, "Text can only be drawn on the main thread");
   Font* font = pass->pipeline->font ? pass->pipeline->font : lovrGraphicsGetDefaultFont();
 
   if (!font) {
@@ -8105,6 +9356,7 @@ bool lovrPassMeshIndirect(Pass* pass, Buffer* vertices, Buffer* indices, Buffer*
 }
 
 bool lovrPassBeginTally(Pass* pass, uint32_t* index) {
+  lovrCheck(!pass->parent, "Tallies can not be used in a forked Pass");
   lovrCheck(pass->tally.count < MAX_TALLIES, "Pass has too many tallies!");
   lovrCheck(!pass->tally.active, "Trying to start a tally, but the previous tally wasn't finished");
   pass->tally.active = true;
@@ -8134,6 +9386,8 @@ bool lovrPassSetTallyBuffer(Pass* pass, Buffer* buffer, uint32_t offset) {
 }
 
 bool lovrPassCompute(Pass* pass, uint32_t x, uint32_t y, uint32_t z, Buffer* indirect, uint32_t offset) {
+  lovrCheck(!pass->merged, "Unable to record computes in a forked Pass after its parent was submitted");
+
   if ((pass->computeCount & (pass->computeCount - 1)) == 0) {
     Compute* computes = lovrPassAllocate(pass, MAX(pass->computeCount << 1, 1) * sizeof(Compute));
     if (pass->computes) memcpy(computes, pass->computes, pass->computeCount * sizeof(Compute));
@@ -8208,19 +9462,82 @@ static gpu_pipeline* getPipeline(uint32_t index) {
   return (gpu_pipeline*) ((char*) state.pipelines + index * gpu_sizeof_pipeline());
 }
 
+static bool reservePipeline(gpu_shader* shader, uint32_t* index) {
+  if (state.pipelineFreelist.length > 0) {
+    *index = arr_pop(&state.pipelineFreelist);
+  } else {
+    lovrAssert(state.pipelineCount < MAX_PIPELINES, "Too many pipelines!");
+    lovrAssert(os_vm_commit(state.pipelines, (state.pipelineCount + 1) * gpu_sizeof_pipeline()), "Out of pipeline memory");
+    arr_push(&state.pipelineOwners, NULL);
+    *index = state.pipelineCount++;
+  }
+
+  state.pipelineOwners.data[*index] = shader;
+  return true;
+}
+
+// Pipelines are destroyed once the GPU is done with them, and the zeroed slot is safe to destroy again
+static void freePipeline(uint32_t index) {
+  gpu_pipeline_destroy(getPipeline(index));
+  memset(getPipeline(index), 0, gpu_sizeof_pipeline());
+  state.pipelineOwners.data[index] = NULL;
+  arr_push(&state.pipelineFreelist, index);
+}
+
+// Removes the graphics pipelines that use a shader, so the lookup doesn't grow forever as shaders
+// are created and destroyed (and a new shader at the same address can't pick up stale pipelines)
+static void evictPipelines(gpu_shader* shader) {
+  map_t* lookup = &state.pipelineLookup;
+  for (uint32_t i = 0; i < lookup->size;) {
+    if (lookup->hashes[i] != MAP_NIL && state.pipelineOwners.data[lookup->values[i]] == shader) {
+      freePipeline((uint32_t) lookup->values[i]);
+      map_remove(lookup, lookup->hashes[i]);
+    } else {
+      i++;
+    }
+  }
+}
+
+static uint32_t getBlockClass(uint32_t size) {
+  uint32_t c = 0;
+  while (c < BUFFER_BLOCK_CLASSES - 1 && (uint32_t) BUFFER_BLOCK_SIZE << c < size) c++;
+  return c;
+}
+
+// Forked passes can allocate blocks from multiple threads, so the pools are protected by a lock (the
+// gpu layer locks its own memory allocator, so creating a new block off the main thread is okay)
 static BufferBlock* getBlock(gpu_buffer_type type, uint32_t size) {
-  BufferBlock* block = state.bufferAllocators[type].freelist;
+  BufferPool* pool = &state.bufferPools[type];
+  uint32_t c = getBlockClass(size);
+
+  mtx_lock(&state.lock);
+  BufferBlock* block = NULL;
+  BufferBlock* prev = NULL;
+
+  // Passes return their blocks whenever they're released, and a pass's own list is newest-first, so
+  // the pool isn't sorted by tick and the whole class is scanned for a block the GPU is done with
+  for (block = pool->head[c]; block; prev = block, block = block->next) {
+    if (block->size >= size && gpu_is_complete(block->tick)) {
+      break;
+    }
+  }
 
-  if (block && block->size >= size && gpu_is_complete(block->tick)) {
-    state.bufferAllocators[type].freelist = block->next;
+  if (block) {
+    if (prev) prev->next = block->next;
+    else pool->head[c] = block->next;
+    if (pool->tail[c] == block) pool->tail[c] = prev;
+    pool->active += block->size;
+    pool->peak = MAX(pool->peak, pool->active);
+    mtx_unlock(&state.lock);
     block->next = NULL;
     return block;
   }
 
   block = lovrMalloc(sizeof(BufferBlock) + gpu_sizeof_buffer());
   block->handle = (gpu_buffer*) (block + 1);
-  block->size = MAX(size, 1 << 22);
+  block->size = MAX(size, (uint32_t) BUFFER_BLOCK_SIZE << c);
   block->next = NULL;
+  block->tick = 0;
   block->ref = 0;
 
   gpu_buffer_info info = {
@@ -8231,19 +9548,68 @@ static BufferBlock* getBlock(gpu_buffer_type type, uint32_t size) {
   };
 
   if (!gpu_buffer_init(block->handle, &info)) {
+    mtx_unlock(&state.lock);
     lovrSetError("Failed to create GPU buffer: %s", gpu_get_error());
     lovrFree(block);
     return NULL;
   }
 
+  pool->blockCount++;
+  pool->memory += block->size;
+  pool->active += block->size;
+  pool->peak = MAX(pool->peak, pool->active);
+  mtx_unlock(&state.lock);
   return block;
 }
 
-static void freeBlock(BufferAllocator* allocator, BufferBlock* block) {
-  BufferBlock** list = &allocator->freelist;
-  while (*list) list = (BufferBlock**) &(*list)->next;
+static void freeBlock(gpu_buffer_type type, BufferBlock* block) {
   block->next = NULL;
-  *list = block;
+  freeBlocks(type, block);
+}
+
+static void freeBlocks(gpu_buffer_type type, BufferBlock* list) {
+  BufferPool* pool = &state.bufferPools[type];
+  mtx_lock(&state.lock);
+  while (list) {
+    BufferBlock* block = list;
+    uint32_t c = getBlockClass(block->size);
+    list = block->next;
+    block->next = NULL;
+    if (pool->tail[c]) pool->tail[c]->next = block;
+    else pool->head[c] = block;
+    pool->tail[c] = block;
+    pool->active -= block->size;
+  }
+  mtx_unlock(&state.lock);
+}
+
+// Destroys blocks that haven't been reused in a while, so a spike in usage doesn't hold on to memory
+static void trimBlocks(void) {
+  mtx_lock(&state.lock);
+  for (uint32_t i = 0; i < COUNTOF(state.bufferPools); i++) {
+    BufferPool* pool = &state.bufferPools[i];
+    for (uint32_t c = 0; c < BUFFER_BLOCK_CLASSES; c++) {
+      BufferBlock* prev = NULL;
+      BufferBlock* block = pool->head[c];
+      while (block) {
+        if (state.tick - block->tick <= BUFFER_TRIM_TICKS || !gpu_is_complete(block->tick)) {
+          prev = block;
+          block = block->next;
+          continue;
+        }
+        BufferBlock* next = block->next;
+        if (prev) prev->next = next;
+        else pool->head[c] = next;
+        if (pool->tail[c] == block) pool->tail[c] = prev;
+        pool->blockCount--;
+        pool->memory -= block->size;
+        gpu_buffer_destroy(block->handle);
+        lovrFree(block);
+        block = next;
+      }
+    }
+  }
+  mtx_unlock(&state.lock);
 }
 
 static BufferView allocateBuffer(BufferAllocator* allocator, gpu_buffer_type type, uint32_t size, size_t align) {
@@ -8251,9 +9617,15 @@ static BufferView allocateBuffer(BufferAllocator* allocator, gpu_buffer_type typ
   BufferBlock* block = allocator->current;
 
   if (!block || cursor + size > block->size) {
+    // Passes keep their full blocks until they're submitted, everything else is recycled right away
     if (block && type != GPU_BUFFER_STATIC) {
       block->tick = state.tick;
-      freeBlock(allocator, block);
+      if (allocator == &state.bufferAllocators[type]) {
+        freeBlock(type, block);
+      } else {
+        block->next = allocator->freelist;
+        allocator->freelist = block;
+      }
     }
 
     if ((block = getBlock(type, size)) == NULL) {
@@ -8303,6 +9675,7 @@ static bool beginFrame(void) {
     memset(&state.transferBarrier, 0, sizeof(gpu_barrier));
     state.allocator.cursor = 0;
     processReadbacks();
+    trimBlocks();
   }
 
   if (!state.stream && (state.stream = gpu_stream_begin("Internal")) == NULL) {
@@ -8360,42 +9733,174 @@ static void processReadbacks(void) {
   }
 }
 
-static gpu_pass* getPass(Canvas* canvas) {
-  gpu_pass_info info = { 0 };
+// Splices the draws and computes recorded by a Pass's forks into the Pass at the points where the
+// forks were created.  The parent takes ownership of the objects used by the spliced draws, but the
+// draw data stays in the fork's memory, so forks are kept alive until the parent is reset.
+static bool mergeForks(Pass* pass) {
+  uint32_t views = pass->canvas.views;
+  uint32_t drawCount = pass->drawCount;
+  uint32_t computeCount = pass->computeCount;
+  uint32_t cameraCount = pass->cameraCount;
+  uint32_t viewportCount = pass->viewportCount;
+  uint32_t scissorCount = pass->scissorCount;
+
+  // Forks that were merged by an earlier submit are skipped, their state already lives in the parent
+  for (Pass* fork = pass->forks; fork; fork = fork->sibling) {
+    if (fork->merged) continue;
+    drawCount += fork->drawCount;
+    computeCount += fork->computeCount;
+    cameraCount += fork->cameraCount;
+    viewportCount += fork->viewportCount;
+    scissorCount += fork->scissorCount;
+  }
+
+  if (drawCount == pass->drawCount && computeCount == pass->computeCount) {
+    for (Pass* fork = pass->forks; fork; fork = fork->sibling) fork->merged = true;
+    return true;
+  }
+
+  lovrCheck(drawCount <= 1 << 16, "Pass has too many draws!");
+
+  // Draws store camera/viewport/scissor indices in 16 bits, and one more slot of each is added below
+  lovrCheck(cameraCount < 0xffff, "Pass has too many cameras!");
+  lovrCheck(viewportCount < 0xffff, "Pass has too many viewports!");
+  lovrCheck(scissorCount < 0xffff, "Pass has too many scissors!");
+
+  // The parent's latest camera/viewport/scissor are repeated at the end, so it can keep recording
+  uint32_t computeCapacity = 1;
+  while (computeCapacity < computeCount) computeCapacity <<= 1;
+  pass->drawCapacity = MAX(pass->drawCapacity, drawCount);
+  Draw* draws = lovrPassAllocate(pass, pass->drawCapacity * sizeof(Draw));
+  Compute* computes = lovrPassAllocate(pass, computeCapacity * sizeof(Compute));
+  Camera* cameras = lovrPassAllocate(pass, (cameraCount + 1) * views * sizeof(Camera));
+  float* viewports = lovrPassAllocate(pass, (viewportCount + 1) * 6 * sizeof(float));
+  uint32_t* scissors = lovrPassAllocate(pass, (scissorCount + 1) * 4 * sizeof(uint32_t));
+
+  if (pass->cameras) memcpy(cameras, pass->cameras, pass->cameraCount * views * sizeof(Camera));
+  memcpy(viewports, pass->viewports, pass->viewportCount * 6 * sizeof(float));
+  memcpy(scissors, pass->scissors, pass->scissorCount * 4 * sizeof(uint32_t));
+
+  Draw* draw = draws;
+  Compute* compute = computes;
+  uint32_t drawCursor = 0;
+  uint32_t computeCursor = 0;
+  cameraCount = pass->cameraCount;
+  viewportCount = pass->viewportCount;
+  scissorCount = pass->scissorCount;
+
+  for (Pass* fork = pass->forks; fork; fork = fork->sibling) {
+    if (fork->merged) continue;
+    memcpy(draw, pass->draws + drawCursor, (fork->forkDraw - drawCursor) * sizeof(Draw));
+    draw += fork->forkDraw - drawCursor;
+    drawCursor = fork->forkDraw;
+
+    for (uint32_t i = 0; i < fork->drawCount; i++, draw++) {
+      *draw = fork->draws[i];
+      draw->camera += cameraCount;
+      draw->viewport += viewportCount;
+      draw->scissor += scissorCount;
+    }
+
+    if (pass->computes) memcpy(compute, pass->computes + computeCursor, (fork->forkCompute - computeCursor) * sizeof(Compute));
+    if (fork->computes) memcpy(compute + fork->forkCompute - computeCursor, fork->computes, fork->computeCount * sizeof(Compute));
+    compute += fork->forkCompute - computeCursor + fork->computeCount;
+    computeCursor = fork->forkCompute;
+
+    if (fork->cameras) memcpy(cameras + cameraCount * views, fork->cameras, fork->cameraCount * views * sizeof(Camera));
+    memcpy(viewports + viewportCount * 6, fork->viewports, fork->viewportCount * 6 * sizeof(float));
+    memcpy(scissors + scissorCount * 4, fork->scissors, fork->scissorCount * 4 * sizeof(uint32_t));
+    cameraCount += fork->cameraCount;
+    viewportCount += fork->viewportCount;
+    scissorCount += fork->scissorCount;
+
+    for (uint32_t i = 0; i < COUNTOF(fork->access); i++) {
+      AccessBlock* tail = fork->access[i];
+      if (!tail) continue;
+      while (tail->next) tail = tail->next;
+      tail->next = pass->access[i];
+      pass->access[i] = fork->access[i];
+      fork->access[i] = NULL;
+    }
+
+    if (fork->buffers.freelist) {
+      BufferBlock** list = &pass->buffers.freelist;
+      while (*list) list = (BufferBlock**) &(*list)->next;
+      *list = fork->buffers.freelist;
+      fork->buffers.freelist = NULL;
+    }
+
+    pass->flags |= fork->flags & NEEDS_VIEW_CULL;
+    fork->drawCount = 0;
+    fork->computeCount = 0;
+    fork->merged = true;
+  }
+
+  memcpy(draw, pass->draws + drawCursor, (pass->drawCount - drawCursor) * sizeof(Draw));
+  if (pass->computes) memcpy(compute, pass->computes + computeCursor, (pass->computeCount - computeCursor) * sizeof(Compute));
+
+  uint32_t lastCamera = pass->cameraCount > 0 ? 1 : 0;
+  if (lastCamera) memcpy(cameras + cameraCount * views, pass->cameras + (pass->cameraCount - 1) * views, views * sizeof(Camera));
+  memcpy(viewports + viewportCount * 6, pass->viewports + (pass->viewportCount - 1) * 6, 6 * sizeof(float));
+  memcpy(scissors + scissorCount * 4, pass->scissors + (pass->scissorCount - 1) * 4, 4 * sizeof(uint32_t));
+
+  pass->draws = draws;
+  pass->computes = computes;
+  pass->cameras = cameras;
+  pass->viewports = viewports;
+  pass->scissors = scissors;
+  pass->drawCount = drawCount;
+  pass->computeCount = computeCount;
+  pass->cameraCount = cameraCount + lastCamera;
+  pass->viewportCount = viewportCount + 1;
+  pass->scissorCount = scissorCount + 1;
+  pass->flags |= DIRTY_CAMERA | DIRTY_VIEWPORT | DIRTY_SCISSOR | DIRTY_PIPELINES;
+  return true;
+}
+
+static void getPassInfo(Canvas* canvas, gpu_pass_info* info) {
+  memset(info, 0, sizeof(*info));
 
   for (uint32_t i = 0; i < canvas->count; i++) {
     Attachment* attachment = &canvas->color[i];
-    info.color[i].format = (gpu_texture_format) attachment->texture->info.format;
-    info.color[i].srgb = attachment->texture->info.srgb;
-    info.color[i].load = (gpu_load_op) attachment->load;
-    info.color[i].save = attachment->resolve || attachment->automsaa ? GPU_SAVE_OP_DISCARD : GPU_SAVE_OP_KEEP;
-    info.color[i].resolve = attachment->resolve || attachment->automsaa;
+    info->color[i].format = (gpu_texture_format) attachment->texture->info.format;
+    info->color[i].srgb = attachment->texture->info.srgb;
+    info->color[i].load = (gpu_load_op) attachment->load;
+    info->color[i].save = attachment->resolve || attachment->automsaa ? GPU_SAVE_OP_DISCARD : GPU_SAVE_OP_KEEP;
+    info->color[i].resolve = attachment->resolve || attachment->automsaa;
   }
 
   Attachment* depth = &canvas->depth;
 
   if (depth->texture || depth->format) {
-    info.depth.format = (gpu_texture_format) (depth->texture ? depth->texture->info.format : depth->format);
-    info.depth.load = (gpu_load_op) depth->load;
-    info.depth.save = depth->resolve || depth->automsaa ? GPU_SAVE_OP_DISCARD : GPU_SAVE_OP_KEEP;
-    info.depth.stencilLoad = info.depth.load;
-    info.depth.stencilSave = info.depth.save;
-    info.depth.resolve = depth->resolve || (depth->texture && depth->automsaa);
+    info->depth.format = (gpu_texture_format) (depth->texture ? depth->texture->info.format : depth->format);
+    info->depth.load = (gpu_load_op) depth->load;
+    info->depth.save = depth->resolve || depth->automsaa ? GPU_SAVE_OP_DISCARD : GPU_SAVE_OP_KEEP;
+    info->depth.stencilLoad = info->depth.load;
+    info->depth.stencilSave = info->depth.save;
+    info->depth.resolve = depth->resolve || (depth->texture && depth->automsaa);
   }
 
-  info.colorCount = canvas->count;
-  info.samples = canvas->samples;
-  info.views = canvas->views;
-  info.foveated = !!canvas->foveation;
-  info.surface = canvas->count > 0 && canvas->color[0].texture == state.window;
+  info->colorCount = canvas->count;
+  info->samples = canvas->samples;
+  info->views = canvas->views;
+  info->foveated = !!canvas->foveation;
+  info->surface = canvas->count > 0 && canvas->color[0].texture == state.window;
+}
+
+static gpu_pass* getPass(Canvas* canvas) {
+  gpu_pass_info info;
+  getPassInfo(canvas, &info);
+  return lookupPass(&info);
+}
 
-  uint64_t hash = hash64(&info, sizeof(info));
+static gpu_pass* lookupPass(gpu_pass_info* info) {
+  uint64_t hash = hash64(info, sizeof(*info));
   uint64_t value = map_get(&state.passLookup, hash);
 
   if (value == MAP_NIL) {
     gpu_pass* pass = lovrMalloc(gpu_sizeof_pass());
 
-    if (!gpu_pass_init(pass, &info)) {
+    if (!gpu_pass_init(pass, info)) {
       lovrFree(pass);
       return NULL;
     }
@@ -8407,6 +9912,113 @@ static gpu_pass* getPass(Canvas* canvas) {
   return (gpu_pass*) (uintptr_t) value;
 }
 
+static uint64_t getShaderKey(Shader* shader) {
+  uint64_t key[2] = { shader->hash, hash64(shader->flags, shader->overrideCount * sizeof(gpu_shader_flag)) };
+  return hash64(key, sizeof(key));
+}
+
+static void savePipelineRecord(PipelineRecord* record) {
+  uint64_t hash = hash64(record, sizeof(*record));
+
+  if (map_get(&state.pipelineRecordLookup, hash) == MAP_NIL) {
+    map_set(&state.pipelineRecordLookup, hash, state.pipelineRecords.length);
+    arr_push(&state.pipelineRecords, *record);
+  }
+}
+
+static void recordPipeline(Shader* shader, Canvas* canvas, gpu_pipeline_info* info) {
+  PipelineRecord record;
+  memset(&record, 0, sizeof(record));
+  record.shader = getShaderKey(shader);
+  record.flags = !!info->flags;
+  getPassInfo(canvas, &record.pass);
+  record.pipeline = *info;
+  record.pipeline.pass = NULL;
+  record.pipeline.shader = NULL;
+  record.pipeline.flags = NULL;
+  record.pipeline.label = NULL;
+  savePipelineRecord(&record);
+}
+
+typedef struct {
+  gpu_pipeline_info* infos;
+  uint32_t* indices;
+  bool* success;
+} PrewarmContext;
+
+static void compilePipelines(void* arg, uint32_t start, uint32_t end) {
+  PrewarmContext* context = arg;
+  for (uint32_t i = start; i < end; i++) {
+    context->success[i] = gpu_pipeline_init_graphics(getPipeline(context->indices[i]), &context->infos[i]);
+  }
+}
+
+// Compiles the pipelines from previous sessions that use a Shader, so they're ready before they're
+// drawn with.  The pipelines are compiled in parallel, but only this thread touches the lookup.
+static void prewarmPipelines(Shader* shader) {
+  size_t stack = tempPush(&state.allocator);
+  size_t capacity = state.pipelineCache.length;
+  uint64_t key = getShaderKey(shader);
+  uint32_t count = 0;
+
+  PrewarmContext context;
+  context.infos = tempAlloc(&state.allocator, capacity * sizeof(gpu_pipeline_info));
+  context.indices = tempAlloc(&state.allocator, capacity * sizeof(uint32_t));
+  context.success = tempAlloc(&state.allocator, capacity * sizeof(bool));
+  PipelineRecord** records = tempAlloc(&state.allocator, capacity * sizeof(PipelineRecord*));
+  uint64_t* hashes = tempAlloc(&state.allocator, capacity * sizeof(uint64_t));
+
+  for (size_t i = 0; i < capacity; i++) {
+    PipelineRecord* record = &state.pipelineCache.data[i];
+
+    if (record->shader != key || (record->flags && record->pipeline.flagCount != shader->overrideCount)) {
+      continue;
+    }
+
+    gpu_pass* pass = lookupPass(&record->pass);
+
+    if (!pass) {
+      continue;
+    }
+
+    gpu_pipeline_info* info = &context.infos[count];
+    *info = record->pipeline;
+    info->pass = pass;
+    info->shader = shader->gpu;
+    info->flags = record->flags ? shader->flags : NULL;
+
+    uint64_t hash = hash64(info, sizeof(gpu_pipeline_info));
+
+    if (map_get(&state.pipelineLookup, hash) != MAP_NIL) {
+      continue;
+    }
+
+    if (!reservePipeline(shader->gpu, &context.indices[count])) {
+      break;
+    }
+
+    records[count] = record;
+    hashes[count++] = hash;
+  }
+
+#ifndef LOVR_DISABLE_THREAD
+  job_parallel_for(count, 1, compilePipelines, &context);
+#else
+  compilePipelines(&context, 0, count);
+#endif
+
+  for (uint32_t i = 0; i < count; i++) {
+    if (context.success[i]) {
+      map_set(&state.pipelineLookup, hashes[i], context.indices[i]);
+      savePipelineRecord(records[i]);
+    } else {
+      freePipeline(context.indices[i]);
+    }
+  }
+
+  tempPop(&state.allocator, stack);
+}
+
 static Layout* getLayout(gpu_slot* slots, uint32_t count) {
   uint64_t hash = hash64(slots, count * sizeof(gpu_slot));
 
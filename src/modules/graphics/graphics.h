@@ -27,6 +27,10 @@ typedef struct {
   bool antialias;
   void* cacheData;
   size_t cacheSize;
+  void* pipelineData;
+  size_t pipelineSize;
+  void* fontCacheData;
+  size_t fontCacheSize;
 } GraphicsConfig;
 
 typedef struct {
@@ -84,6 +88,31 @@ typedef struct {
   float pointSize;
 } GraphicsLimits;
 
+typedef struct {
+  uint64_t size;
+  uint64_t allocated;
+  uint64_t used;
+  uint64_t largestFree;
+  uint32_t blocks;
+  uint32_t allocations;
+  bool deviceLocal;
+} GraphicsHeap;
+
+typedef enum {
+  BUFFER_POOL_STATIC,
+  BUFFER_POOL_STREAM,
+  BUFFER_POOL_UPLOAD,
+  BUFFER_POOL_DOWNLOAD,
+  BUFFER_POOL_COUNT
+} BufferPoolType;
+
+typedef struct {
+  uint32_t blocks;
+  uint64_t memory;
+  uint64_t active;
+  uint64_t peak;
+} GraphicsBufferPool;
+
 enum {
   TEXTURE_FEATURE_SAMPLE  = (1 << 0),
   TEXTURE_FEATURE_RENDER  = (1 << 1),
@@ -98,8 +127,12 @@ bool lovrGraphicsIsInitialized(void);
 void lovrGraphicsGetDevice(GraphicsDevice* device);
 void lovrGraphicsGetFeatures(GraphicsFeatures* features);
 void lovrGraphicsGetLimits(GraphicsLimits* limits);
+uint32_t lovrGraphicsGetHeaps(GraphicsHeap* heaps, uint32_t capacity);
+void lovrGraphicsGetBufferPools(GraphicsBufferPool pools[BUFFER_POOL_COUNT]);
 uint32_t lovrGraphicsGetFormatSupport(uint32_t format, uint32_t features);
 void lovrGraphicsGetShaderCache(void* data, size_t* size);
+void lovrGraphicsGetPipelineCache(void* data, size_t* size);
+void* lovrGraphicsGetFontCache(size_t* size);
 
 void lovrGraphicsGetBackgroundColor(float background[4]);
 void lovrGraphicsSetBackgroundColor(float background[4]);
@@ -215,6 +248,7 @@ typedef struct {
   bool xr;
   uint32_t imageCount;
   struct Image** images;
+  struct Blob* file;
   const char* label;
   uintptr_t handle;
 } TextureInfo;
@@ -421,6 +455,9 @@ float lovrFontGetKerning(Font* font, uint32_t first, uint32_t second);
 float lovrFontGetWidth(Font* font, ColoredString* strings, uint32_t count);
 void lovrFontGetLines(Font* font, ColoredString* strings, uint32_t count, float wrap, void (*callback)(void* context, const char* string, size_t length), void* context);
 bool lovrFontGetVertices(Font* font, ColoredString* strings, uint32_t count, float wrap, HorizontalAlign halign, VerticalAlign valign, GlyphVertex* vertices, uint32_t* glyphCount, uint32_t* lineCount, Material** material, bool flip);
+bool lovrFontPrewarm(Font* font, uint32_t* codepoints, uint32_t count);
+void* lovrFontGetCache(Font* font, size_t* size);
+bool lovrFontLoadCache(Font* font, const void* data, size_t size, bool* loaded);
 
 // Mesh
 
@@ -509,6 +546,8 @@ typedef struct {
   uint32_t draws;
   uint32_t computes;
   uint32_t drawsCulled;
+  uint32_t drawsBatched;
+  uint32_t stateChangesSaved;
   size_t cpuMemoryReserved;
   size_t cpuMemoryUsed;
   double submitTime;
@@ -576,8 +615,9 @@ typedef enum {
 
 bool lovrGraphicsGetWindowPass(Pass** pass);
 Pass* lovrPassCreate(const char* label);
+Pass* lovrPassFork(Pass* pass);
 void lovrPassDestroy(void* ref);
-void lovrPassReset(Pass* pass);
+bool lovrPassReset(Pass* pass);
 const PassStats* lovrPassGetStats(Pass* pass);
 const char* lovrPassGetLabel(Pass* pass);
 
@@ -621,6 +661,8 @@ void lovrPassSetShader(Pass* pass, Shader* shader);
 bool lovrPassSetStencilTest(Pass* pass, CompareMode test, uint8_t value, uint8_t mask);
 bool lovrPassSetStencilWrite(Pass* pass, StencilAction actions[3], uint8_t value, uint8_t mask);
 void lovrPassSetViewCull(Pass* pass, bool enable);
+bool lovrPassIsSorting(Pass* pass);
+void lovrPassSetSorting(Pass* pass, bool enable);
 void lovrPassSetViewport(Pass* pass, float viewport[6]);
 void lovrPassSetWinding(Pass* pass, Winding winding);
 void lovrPassSetWireframe(Pass* pass, bool wireframe);
@@ -7,6 +7,11 @@
 #include <stdatomic.h>
 #include <threads.h>
 #include <joltc.h>
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_IX86)
+#include <xmmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#endif
 
 struct Contact {
   uint32_t ref;
@@ -36,13 +41,17 @@ struct World {
   bool defaultIsSleepingAllowed;
   float inverseDelta;
   float interpolation;
+  float timestep;
+  float accumulator;
+  float lastUpdate;
+  uint32_t collisionSteps;
+  uint32_t maxSteps;
   uint32_t tagCount;
   uint32_t staticTagMask;
   uint32_t tagLookup[MAX_TAGS];
   char* tags[MAX_TAGS];
   JPH_JobSystem* jobSystem;
-  uint32_t jobCount;
-  job* jobs[1024];
+  job_group jobs;
   mtx_t lock;
 };
 
@@ -97,10 +106,17 @@ static thread_local struct {
   bool locked;
 } thread;
 
+#define SHAPE_CACHE_SIZE 64
+
 static struct {
   bool initialized;
   JPH_Shape* emptyShape;
   void (*freeUserData)(void* object, uintptr_t userdata);
+  lru_t shapeCache;
+  mtx_t shapeCacheLock;
+  map_t shapeCacheIndex;
+  char* shapeCacheData;
+  atomic_bool shapeCacheDirty;
 } state;
 
 #define vec3_toJolt(v) &(JPH_Vec3) { v[0], v[1], v[2] }
@@ -294,27 +310,54 @@ static void onContactRemoved(void* userdata, const JPH_SubShapeIDPair* pair) {
 
 static void queueJob(void* context, JPH_JobFunction* function, void* arg) {
   World* world = context;
+  job_group_add(&world->jobs, function, arg);
+}
 
-  // If there are too many jobs, fall back to single threaded
-  if (atomic_load(&world->jobCount) >= COUNTOF(world->jobs)) {
-    function(arg);
-  } else {
-    job* job = job_start(function, arg);
+static void queueJobs(void* context, JPH_JobFunction* function, void** args, uint32_t count) {
+  World* world = context;
+  job_group_add_batch(&world->jobs, function, args, count);
+}
 
-    if (job) {
-      uint32_t index = atomic_fetch_add(&world->jobCount, 1);
-      world->jobs[index] = job;
-    }
+// The shape cache is a single file with a header and a list of entries.  Each entry is a hash and
+// a size, followed by the serialized shape padded to 8 bytes.  Entries are indexed by hash here and
+// only validated when they're used.
+
+#define SHAPE_CACHE_MAGIC 0x48435357 // WSCH
+#define SHAPE_CACHE_VERSION 1
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t count;
+  uint32_t padding;
+} ShapeCacheHeader;
+
+typedef struct {
+  uint64_t hash;
+  uint64_t size;
+} ShapeCacheEntry;
+
+static void loadShapeCache(const void* data, size_t size) {
+  const ShapeCacheHeader* header = data;
+
+  if (!data || size < sizeof(ShapeCacheHeader) || header->magic != SHAPE_CACHE_MAGIC || header->version != SHAPE_CACHE_VERSION) {
+    return;
   }
-}
 
-static void queueJobs(void* context, JPH_JobFunction* function, void** args, uint32_t count) {
-  for (uint32_t i = 0; i < count; i++) {
-    queueJob(context, function, args[i]);
+  state.shapeCacheData = lovrMalloc(size);
+  memcpy(state.shapeCacheData, data, size);
+
+  size_t offset = sizeof(ShapeCacheHeader);
+  for (uint32_t i = 0; i < header->count && size - offset >= sizeof(ShapeCacheEntry); i++) {
+    const ShapeCacheEntry* entry = (const ShapeCacheEntry*) (state.shapeCacheData + offset);
+    size_t remaining = size - offset - sizeof(ShapeCacheEntry);
+    if (entry->size > remaining || ALIGN(entry->size, 8) > remaining) break;
+    map_set(&state.shapeCacheIndex, entry->hash, offset);
+    offset += sizeof(ShapeCacheEntry) + ALIGN(entry->size, 8);
   }
 }
 
-bool lovrPhysicsInit(void (*freeUserData)(void* object, uintptr_t userdata)) {
+bool lovrPhysicsInit(void (*freeUserData)(void* object, uintptr_t userdata), const void* shapeCache, size_t shapeCacheSize) {
   if (state.initialized) return true;
   JPH_Init();
   float center[3] = { 0.f, 0.f, 0.f };
@@ -322,12 +365,25 @@ bool lovrPhysicsInit(void (*freeUserData)(void* object, uintptr_t userdata)) {
   state.emptyShape = (JPH_Shape*) JPH_EmptyShapeSettings_CreateShape(settings);
   JPH_ShapeSettings_Destroy((JPH_ShapeSettings*) settings);
   state.freeUserData = freeUserData;
+  lru_init(&state.shapeCache, SHAPE_CACHE_SIZE);
+  mtx_init(&state.shapeCacheLock, mtx_plain);
+  map_init(&state.shapeCacheIndex, 0);
+  loadShapeCache(shapeCache, shapeCacheSize);
+  state.shapeCacheDirty = false;
   return state.initialized = true;
 }
 
 void lovrPhysicsDestroy(void) {
   if (!state.initialized) return;
   JPH_Shape_Destroy(state.emptyShape);
+  for (uint32_t i = 0; i < state.shapeCache.count; i++) {
+    JPH_Shape_Destroy((JPH_Shape*) (uintptr_t) state.shapeCache.values[i]);
+  }
+  lru_free(&state.shapeCache);
+  mtx_destroy(&state.shapeCacheLock);
+  map_free(&state.shapeCacheIndex);
+  lovrFree(state.shapeCacheData);
+  state.shapeCacheData = NULL;
   JPH_Shutdown();
   state.initialized = false;
 }
@@ -339,6 +395,9 @@ World* lovrWorldCreate(WorldInfo* info) {
   world->defaultLinearDamping = .05f;
   world->defaultAngularDamping = .05f;
   world->defaultIsSleepingAllowed = info->allowSleep;
+  world->timestep = MAX(info->timestep, 0.f);
+  world->collisionSteps = MAX(info->collisionSteps, 1);
+  world->maxSteps = MAX(info->maxSteps, 1);
   mtx_init(&world->lock, mtx_plain);
 
   world->tagCount = info->tagCount;
@@ -511,8 +570,9 @@ void lovrWorldSetGravity(World* world, float gravity[3]) {
   JPH_PhysicsSystem_SetGravity(world->system, vec3_toJolt(gravity));
 }
 
-void lovrWorldUpdate(World* world, float dt) {
-  for (uint32_t i = 0; i < world->activeColliderCount; i++) {
+static void saveLastPoses(void* arg, uint32_t start, uint32_t end) {
+  World* world = arg;
+  for (uint32_t i = start; i < end; i++) {
     Collider* collider = world->activeColliders[i];
 
     JPH_RVec3 position;
@@ -523,22 +583,413 @@ void lovrWorldUpdate(World* world, float dt) {
     JPH_Body_GetRotation(collider->body, &orientation);
     quat_fromJolt(collider->lastOrientation, &orientation);
   }
+}
+
+// With a fixed timestep, dt is accumulated and all of the whole steps that fit are simulated with a
+// single Jolt update (using one collision step per fixed step), so the pose snapshot and job setup
+// only happen once.  The interpolation is then set so that poses lag one step behind, blending
+// between the poses before and after the update based on the leftover time.
+uint32_t lovrWorldUpdate(World* world, float dt) {
+  uint32_t steps = 1;
+  float span = dt;
 
-  JPH_PhysicsSystem_Update(world->system, dt, 1, world->jobSystem);
+  if (world->timestep > 0.f) {
+    world->accumulator += dt;
+    steps = (uint32_t) (world->accumulator / world->timestep);
+
+    // Drop time that can't be simulated, so a slow frame doesn't cause even slower frames
+    if (steps > world->maxSteps) {
+      world->accumulator = fmodf(world->accumulator, world->timestep) + world->maxSteps * world->timestep;
+      steps = world->maxSteps;
+    }
 
-  for (uint32_t i = 0; i < world->jobCount; i++) {
-    job_wait(world->jobs[i]);
+    world->accumulator -= steps * world->timestep;
+    span = steps * world->timestep;
+  }
+
+  if (steps > 0) {
+#ifndef LOVR_DISABLE_THREAD
+    job_parallel_for(world->activeColliderCount, 256, saveLastPoses, world);
+#else
+    saveLastPoses(world, 0, world->activeColliderCount);
+#endif
+
+    uint32_t collisionSteps = steps * world->collisionSteps;
+    job_group_init(&world->jobs);
+    JPH_PhysicsSystem_Update(world->system, span, collisionSteps, world->jobSystem);
+    job_group_wait(&world->jobs);
+
+    world->inverseDelta = collisionSteps / span;
+    world->lastUpdate = span;
+  }
+
+  if (world->timestep > 0.f && world->lastUpdate > 0.f) {
+    world->interpolation = CLAMP((world->timestep - world->accumulator) / world->lastUpdate, 0.f, 1.f);
+  } else {
+    world->interpolation = 0.f;
   }
 
-  world->inverseDelta = 1.f / dt;
-  world->interpolation = 0.f;
-  world->jobCount = 0;
+  return steps;
 }
 
 void lovrWorldInterpolate(World* world, float alpha) {
   world->interpolation = 1.f - alpha;
 }
 
+// Batch operations lock all of the bodies at once, instead of locking each body separately.  During
+// collision callbacks the bodies are already locked.
+static uint64_t lockColliders(World* world, Collider** colliders, uint32_t count, int access) {
+  if (thread.locked || count == 0) {
+    return 0;
+  }
+
+  JPH_BodyID stack[64];
+  JPH_BodyID* bodies = count > COUNTOF(stack) ? lovrMalloc(count * sizeof(JPH_BodyID)) : stack;
+
+  for (uint32_t i = 0; i < count; i++) {
+    bodies[i] = colliders[i]->id;
+  }
+
+  uint64_t mask = access == READ ?
+    JPH_PhysicsSystem_LockBodiesRead(world->system, bodies, count) :
+    JPH_PhysicsSystem_LockBodiesWrite(world->system, bodies, count);
+
+  if (bodies != stack) {
+    lovrFree(bodies);
+  }
+
+  return mask;
+}
+
+static void unlockColliders(World* world, uint64_t mask, int access) {
+  if (thread.locked || mask == 0) {
+    return;
+  }
+
+  if (access == READ) {
+    JPH_PhysicsSystem_UnlockBodiesRead(world->system, mask);
+  } else {
+    JPH_PhysicsSystem_UnlockBodiesWrite(world->system, mask);
+  }
+}
+
+// Blends 4 poses towards their previous poses, stored as a structure of arrays (3 position and 4
+// orientation components).  Poses are only a step apart, so orientations use a normalized lerp
+// instead of a slerp, which only needs a square root and can be done 4 at a time.
+static void blendPoses(float pose[7][4], float last[7][4], float weight[4]) {
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_IX86)
+  __m128 w = _mm_loadu_ps(weight);
+  __m128 p[7], l[7];
+
+  for (uint32_t k = 0; k < 7; k++) {
+    p[k] = _mm_loadu_ps(pose[k]);
+    l[k] = _mm_loadu_ps(last[k]);
+  }
+
+  for (uint32_t k = 0; k < 3; k++) {
+    p[k] = _mm_add_ps(p[k], _mm_mul_ps(_mm_sub_ps(l[k], p[k]), w));
+  }
+
+  __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p[3], l[3]), _mm_mul_ps(p[4], l[4])), _mm_add_ps(_mm_mul_ps(p[5], l[5]), _mm_mul_ps(p[6], l[6])));
+  __m128 flip = _mm_and_ps(dot, _mm_set1_ps(-0.f));
+  __m128 length2 = _mm_setzero_ps();
+
+  for (uint32_t k = 3; k < 7; k++) {
+    p[k] = _mm_add_ps(p[k], _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(l[k], flip), p[k]), w));
+    length2 = _mm_add_ps(length2, _mm_mul_ps(p[k], p[k]));
+  }
+
+  __m128 scale = _mm_div_ps(_mm_set1_ps(1.f), _mm_sqrt_ps(length2));
+
+  for (uint32_t k = 0; k < 7; k++) {
+    _mm_storeu_ps(pose[k], k < 3 ? p[k] : _mm_mul_ps(p[k], scale));
+  }
+#elif defined(__aarch64__) || defined(_M_ARM64)
+  float32x4_t w = vld1q_f32(weight);
+  float32x4_t p[7], l[7];
+
+  for (uint32_t k = 0; k < 7; k++) {
+    p[k] = vld1q_f32(pose[k]);
+    l[k] = vld1q_f32(last[k]);
+  }
+
+  for (uint32_t k = 0; k < 3; k++) {
+    p[k] = vfmaq_f32(p[k], vsubq_f32(l[k], p[k]), w);
+  }
+
+  float32x4_t dot = vmulq_f32(p[3], l[3]);
+  dot = vfmaq_f32(dot, p[4], l[4]);
+  dot = vfmaq_f32(dot, p[5], l[5]);
+  dot = vfmaq_f32(dot, p[6], l[6]);
+  uint32x4_t flip = vandq_u32(vreinterpretq_u32_f32(dot), vdupq_n_u32(0x80000000u));
+  float32x4_t length2 = vdupq_n_f32(0.f);
+
+  for (uint32_t k = 3; k < 7; k++) {
+    float32x4_t target = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(l[k]), flip));
+    p[k] = vfmaq_f32(p[k], vsubq_f32(target, p[k]), w);
+    length2 = vfmaq_f32(length2, p[k], p[k]);
+  }
+
+  float32x4_t scale = vdivq_f32(vdupq_n_f32(1.f), vsqrtq_f32(length2));
+
+  for (uint32_t k = 0; k < 7; k++) {
+    vst1q_f32(pose[k], k < 3 ? p[k] : vmulq_f32(p[k], scale));
+  }
+#else
+  for (uint32_t j = 0; j < 4; j++) {
+    float dot = 0.f, length2 = 0.f;
+
+    for (uint32_t k = 0; k < 3; k++) {
+      pose[k][j] += (last[k][j] - pose[k][j]) * weight[j];
+    }
+
+    for (uint32_t k = 3; k < 7; k++) {
+      dot += pose[k][j] * last[k][j];
+    }
+
+    for (uint32_t k = 3; k < 7; k++) {
+      pose[k][j] += ((dot < 0.f ? -last[k][j] : last[k][j]) - pose[k][j]) * weight[j];
+      length2 += pose[k][j] * pose[k][j];
+    }
+
+    for (uint32_t k = 3; k < 7; k++) {
+      pose[k][j] /= sqrtf(length2);
+    }
+  }
+#endif
+}
+
+// Poses are packed as 7 floats (position and orientation quaternion).  Only awake colliders are
+// blended, since sleeping colliders haven't moved.
+static void interpolatePoses(Collider** colliders, uint32_t count, float* poses, float t) {
+  for (uint32_t base = 0; base < count; base += 4) {
+    uint32_t n = MIN(count - base, 4);
+    float pose[7][4] = { [6] = { 1.f, 1.f, 1.f, 1.f } };
+    float last[7][4] = { [6] = { 1.f, 1.f, 1.f, 1.f } };
+    float weight[4] = { 0.f };
+
+    for (uint32_t j = 0; j < n; j++) {
+      Collider* collider = colliders[base + j];
+      float* p = poses + 7 * (base + j);
+      weight[j] = collider->activeIndex != ~0u ? t : 0.f;
+      for (uint32_t k = 0; k < 7; k++) pose[k][j] = p[k];
+      for (uint32_t k = 0; k < 3; k++) last[k][j] = collider->lastPosition[k];
+      for (uint32_t k = 0; k < 4; k++) last[3 + k][j] = collider->lastOrientation[k];
+    }
+
+    blendPoses(pose, last, weight);
+
+    for (uint32_t j = 0; j < n; j++) {
+      float* p = poses + 7 * (base + j);
+      for (uint32_t k = 0; k < 7; k++) p[k] = pose[k][j];
+    }
+  }
+}
+
+void lovrWorldGetPoses(World* world, Collider** colliders, uint32_t count, float* poses) {
+  uint64_t mask = lockColliders(world, colliders, count, READ);
+
+  for (uint32_t i = 0; i < count; i++) {
+    JPH_RVec3 p;
+    JPH_Quat q;
+    JPH_BodyInterface_GetPositionAndRotation(world->bodyInterfaceNoLock, colliders[i]->id, &p, &q);
+    vec3_fromJolt(poses + 7 * i, &p);
+    quat_fromJolt(poses + 7 * i + 3, &q);
+  }
+
+  unlockColliders(world, mask, READ);
+
+  if (world->interpolation != 0.f) {
+    interpolatePoses(colliders, count, poses, world->interpolation);
+  }
+}
+
+// Every collider is checked before any of them are changed, so an error doesn't leave the batch
+// partially applied
+bool lovrWorldSetPoses(World* world, Collider** colliders, uint32_t count, float* poses) {
+  lovrCheck(!thread.locked, "Tried to write to a Collider inside a collision callback");
+
+  for (uint32_t i = 0; i < count; i++) {
+    lovrCheck(colliders[i]->world == world, "Collider %d belongs to a different World", i + 1);
+    lovrCheck(colliders[i]->enabled, "Collider %d must be enabled", i + 1);
+  }
+
+  uint64_t mask = lockColliders(world, colliders, count, WRITE);
+
+  for (uint32_t i = 0; i < count; i++) {
+    float* position = poses + 7 * i;
+    float* orientation = poses + 7 * i + 3;
+    JPH_BodyInterface_SetPositionAndRotation(world->bodyInterfaceNoLock, colliders[i]->id, vec3_toJolt(position), quat_toJolt(orientation), JPH_Activation_Activate);
+    vec3_init(colliders[i]->lastPosition, position);
+    quat_init(colliders[i]->lastOrientation, orientation);
+  }
+
+  unlockColliders(world, mask, WRITE);
+  return true;
+}
+
+bool lovrWorldMoveKinematic(World* world, Collider** colliders, uint32_t count, float* poses, float dt) {
+  lovrCheck(dt > 0.f, "dt must > 0");
+  lovrCheck(!thread.locked, "Tried to write to a Collider inside a collision callback");
+
+  for (uint32_t i = 0; i < count; i++) {
+    lovrCheck(colliders[i]->world == world, "Collider %d belongs to a different World", i + 1);
+    lovrCheck(colliders[i]->enabled, "Collider %d must be enabled", i + 1);
+  }
+
+  uint64_t mask = lockColliders(world, colliders, count, WRITE);
+
+  for (uint32_t i = 0; i < count; i++) {
+    float* position = poses + 7 * i;
+    float* orientation = poses + 7 * i + 3;
+    JPH_BodyInterface_MoveKinematic(world->bodyInterfaceNoLock, colliders[i]->id, vec3_toJolt(position), quat_toJolt(orientation), dt);
+  }
+
+  unlockColliders(world, mask, WRITE);
+  return true;
+}
+
+// State snapshots have a header, a record for each Collider in World list order, and then Jolt's
+// own state (body state, sleep timers, the contact cache, and constraint impulses for warm starting).
+// They can only be restored into the same World, or one with the same colliders created in the same
+// order, which is checked using the body IDs in the records.
+
+#define STATE_MAGIC 0x54535057 // WPST
+#define STATE_VERSION 1
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t colliderCount;
+  uint32_t joltSize;
+  float inverseDelta;
+  float interpolation;
+  float accumulator;
+  float lastUpdate;
+} StateHeader;
+
+typedef struct {
+  JPH_BodyID id;
+  float lastPosition[3];
+  float lastOrientation[4];
+} ColliderState;
+
+typedef arr_t(char) ByteArray;
+
+static void appendBytes(void* userdata, const void* data, size_t size) {
+  ByteArray* buffer = userdata;
+  arr_append(buffer, (const char*) data, size);
+}
+
+// Writes go straight into the caller's memory, moving to a new allocation if it runs out of room
+typedef struct {
+  char* data;
+  size_t length;
+  size_t capacity;
+  bool owned;
+} StateWriter;
+
+static void writeState(void* userdata, const void* data, size_t size) {
+  StateWriter* writer = userdata;
+
+  if (writer->length + size > writer->capacity) {
+    size_t capacity = MAX(writer->capacity * 2, writer->length + size);
+
+    if (writer->owned) {
+      writer->data = lovrRealloc(writer->data, capacity);
+    } else {
+      char* copy = lovrMalloc(capacity);
+      if (writer->length > 0) memcpy(copy, writer->data, writer->length);
+      writer->data = copy;
+      writer->owned = true;
+    }
+
+    writer->capacity = capacity;
+  }
+
+  memcpy(writer->data + writer->length, data, size);
+  writer->length += size;
+}
+
+void* lovrWorldSaveState(World* world, void* data, size_t* size) {
+  lovrCheck(!thread.locked, "Tried to save World state inside a collision callback");
+
+  StateWriter writer = {
+    .data = data,
+    .capacity = data ? *size : 0
+  };
+
+  StateHeader header = {
+    .magic = STATE_MAGIC,
+    .version = STATE_VERSION,
+    .inverseDelta = world->inverseDelta,
+    .interpolation = world->interpolation,
+    .accumulator = world->accumulator,
+    .lastUpdate = world->lastUpdate
+  };
+
+  for (Collider* collider = world->colliders; collider; collider = collider->next) {
+    header.colliderCount++;
+  }
+
+  writeState(&writer, &header, sizeof(header));
+
+  for (Collider* collider = world->colliders; collider; collider = collider->next) {
+    ColliderState entry = { .id = collider->id };
+    memcpy(entry.lastPosition, collider->lastPosition, 3 * sizeof(float));
+    memcpy(entry.lastOrientation, collider->lastOrientation, 4 * sizeof(float));
+    writeState(&writer, &entry, sizeof(entry));
+  }
+
+  size_t offset = writer.length;
+  JPH_PhysicsSystem_SaveState(world->system, writeState, &writer);
+
+  header.joltSize = (uint32_t) (writer.length - offset);
+  memcpy(writer.data, &header, sizeof(header));
+
+  *size = writer.length;
+  return writer.data;
+}
+
+bool lovrWorldRestoreState(World* world, const void* data, size_t size) {
+  lovrCheck(!thread.locked, "Tried to restore World state inside a collision callback");
+
+  StateHeader header;
+  lovrAssert(size >= sizeof(header), "Invalid World state: too small");
+  memcpy(&header, data, sizeof(header));
+  lovrAssert(header.magic == STATE_MAGIC, "Invalid World state: bad magic");
+  lovrAssert(header.version == STATE_VERSION, "Invalid World state: unsupported version %d", header.version);
+
+  uint32_t count = 0;
+  for (Collider* collider = world->colliders; collider; collider = collider->next) {
+    count++;
+  }
+
+  lovrAssert(header.colliderCount == count, "World state has %d colliders, but the World has %d", header.colliderCount, count);
+  size_t offset = sizeof(StateHeader) + count * sizeof(ColliderState);
+  lovrAssert(size >= offset && size - offset >= header.joltSize, "Invalid World state: too small");
+
+  const ColliderState* entry = (const ColliderState*) ((const char*) data + sizeof(StateHeader));
+  for (Collider* collider = world->colliders; collider; collider = collider->next, entry++) {
+    lovrAssert(entry->id == collider->id, "World state does not match the World's colliders");
+  }
+
+  bool restored = JPH_PhysicsSystem_RestoreState(world->system, (const char*) data + offset, header.joltSize);
+  lovrAssert(restored, "Invalid World state: Jolt state could not be restored");
+
+  entry = (const ColliderState*) ((const char*) data + sizeof(StateHeader));
+  for (Collider* collider = world->colliders; collider; collider = collider->next, entry++) {
+    memcpy(collider->lastPosition, entry->lastPosition, 3 * sizeof(float));
+    memcpy(collider->lastOrientation, entry->lastOrientation, 4 * sizeof(float));
+  }
+
+  world->inverseDelta = header.inverseDelta;
+  world->interpolation = header.interpolation;
+  world->accumulator = header.accumulator;
+  world->lastUpdate = header.lastUpdate;
+  return true;
+}
+
 typedef struct {
   World* world;
   float* start;
@@ -629,6 +1080,70 @@ bool lovrWorldShapecast(World* world, Shape* shape, float pose[7], float end[3],
   return JPH_NarrowPhaseQuery_CastShape(query, shape->handle, &transform, dir, NULL, &offset, shapecastCallback, &context, layerFilter, tagFilter, NULL, NULL);
 }
 
+// Batches only keep the closest hit for each query, and run the queries in parallel since the
+// narrow phase can be queried without locking while the World isn't updating
+
+typedef struct {
+  World* world;
+  Raycast* rays;
+  Shapecast* casts;
+  CastResult* hits;
+  atomic_uint hitCount;
+} CastBatch;
+
+static float closestHitCallback(void* userdata, CastResult* hit) {
+  *((CastResult*) userdata) = *hit;
+  return hit->fraction;
+}
+
+static void raycastRange(void* arg, uint32_t start, uint32_t end) {
+  CastBatch* batch = arg;
+  uint32_t hitCount = 0;
+  for (uint32_t i = start; i < end; i++) {
+    Raycast* ray = &batch->rays[i];
+    CastResult* hit = &batch->hits[i];
+    hit->collider = NULL;
+    lovrWorldRaycast(batch->world, ray->start, ray->end, ray->filter, closestHitCallback, hit);
+    hitCount += !!hit->collider;
+  }
+  atomic_fetch_add(&batch->hitCount, hitCount);
+}
+
+static void shapecastRange(void* arg, uint32_t start, uint32_t end) {
+  CastBatch* batch = arg;
+  uint32_t hitCount = 0;
+  for (uint32_t i = start; i < end; i++) {
+    Shapecast* cast = &batch->casts[i];
+    CastResult* hit = &batch->hits[i];
+    hit->collider = NULL;
+    lovrWorldShapecast(batch->world, cast->shape, cast->pose, cast->end, cast->filter, closestHitCallback, hit);
+    hitCount += !!hit->collider;
+  }
+  atomic_fetch_add(&batch->hitCount, hitCount);
+}
+
+uint32_t lovrWorldRaycastBatch(World* world, Raycast* rays, uint32_t count, CastResult* hits) {
+  CastBatch batch = { .world = world, .rays = rays, .hits = hits };
+  atomic_init(&batch.hitCount, 0);
+#ifndef LOVR_DISABLE_THREAD
+  job_parallel_for(count, 64, raycastRange, &batch);
+#else
+  raycastRange(&batch, 0, count);
+#endif
+  return atomic_load(&batch.hitCount);
+}
+
+uint32_t lovrWorldShapecastBatch(World* world, Shapecast* casts, uint32_t count, CastResult* hits) {
+  CastBatch batch = { .world = world, .casts = casts, .hits = hits };
+  atomic_init(&batch.hitCount, 0);
+#ifndef LOVR_DISABLE_THREAD
+  job_parallel_for(count, 16, shapecastRange, &batch);
+#else
+  shapecastRange(&batch, 0, count);
+#endif
+  return atomic_load(&batch.hitCount);
+}
+
 typedef struct {
   World* world;
   OverlapCallback* callback;
@@ -2269,16 +2784,188 @@ bool lovrCylinderShapeSetLength(CylinderShape* shape, float length) {
   return lovrShapeReplace(shape, makeCylinder(radius, length));
 }
 
+// Building convex hulls and mesh BVHs is slow, so the results are cached by a hash of the source
+// geometry and reused when the same data is used again (e.g. when reloading a level).  The cache
+// keeps each cooked shape alive by holding a ScaledShape that wraps it.  The cache can also be
+// saved and passed back to lovrPhysicsInit on later runs, so shapes are restored instead of rebuilt.
+
+#define SHAPE_DATA_MAGIC 0x50485357 // WSHP
+#define SHAPE_DATA_VERSION 1
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t joltVersion;
+  uint32_t type;
+  uint32_t size;
+  uint32_t padding;
+  uint64_t hash;
+} ShapeDataHeader;
+
+static void* saveShapeData(const JPH_Shape* shape, ShapeType type, size_t* size) {
+  ByteArray buffer;
+  arr_init(&buffer);
+  arr_reserve(&buffer, sizeof(ShapeDataHeader));
+  buffer.length = sizeof(ShapeDataHeader);
+
+  JPH_Shape_SaveBinaryState(shape, appendBytes, &buffer);
+
+  ShapeDataHeader* header = (ShapeDataHeader*) buffer.data;
+  header->magic = SHAPE_DATA_MAGIC;
+  header->version = SHAPE_DATA_VERSION;
+  header->joltVersion = JPH_GetVersion();
+  header->type = type;
+  header->padding = 0;
+  header->size = (uint32_t) (buffer.length - sizeof(ShapeDataHeader));
+  header->hash = hash64(header + 1, header->size);
+
+  *size = buffer.length;
+  return buffer.data;
+}
+
+static JPH_Shape* loadShapeData(const void* data, size_t size, ShapeType type) {
+  const ShapeDataHeader* header = data;
+  JPH_ShapeSubType subtype = type == SHAPE_CONVEX ? JPH_ShapeSubType_ConvexHull : JPH_ShapeSubType_Mesh;
+  lovrAssert(size >= sizeof(ShapeDataHeader) && header->magic == SHAPE_DATA_MAGIC, "Invalid Shape data");
+  lovrAssert(header->version == SHAPE_DATA_VERSION, "Invalid Shape data: unsupported version %d", header->version);
+  lovrAssert(header->joltVersion == JPH_GetVersion(), "Invalid Shape data: it was saved by a different version of Jolt");
+  lovrAssert(header->type == type, "Invalid Shape data: it is for a different type of Shape");
+  lovrAssert(header->size == size - sizeof(ShapeDataHeader), "Invalid Shape data: wrong size");
+  lovrAssert(header->hash == hash64(header + 1, header->size), "Invalid Shape data: checksum mismatch");
+  JPH_Shape* shape = JPH_Shape_RestoreBinaryState(header + 1, header->size);
+  lovrAssert(shape, "Invalid Shape data: Jolt could not restore it");
+  if (JPH_Shape_GetSubType(shape) != subtype) {
+    JPH_Shape_Destroy(shape);
+    lovrSetError("Invalid Shape data: wrong shape type");
+    return NULL;
+  }
+  return shape;
+}
+
+static void cacheShape(uint64_t hash, const JPH_Shape* shape) {
+  float one[3] = { 1.f, 1.f, 1.f };
+  JPH_Shape* holder = (JPH_Shape*) JPH_ScaledShape_Create(shape, vec3_toJolt(one));
+  JPH_Shape* evicted = NULL;
+
+  mtx_lock(&state.shapeCacheLock);
+  if (lru_get(&state.shapeCache, hash) == MAP_NIL) {
+    uint64_t old = lru_set(&state.shapeCache, hash, (uint64_t) (uintptr_t) holder, NULL);
+    evicted = old == MAP_NIL ? NULL : (JPH_Shape*) (uintptr_t) old;
+    holder = NULL;
+  }
+  mtx_unlock(&state.shapeCacheLock);
+
+  if (holder) JPH_Shape_Destroy(holder);
+  if (evicted) JPH_Shape_Destroy(evicted);
+}
+
+static JPH_Shape* getCachedShape(uint64_t hash, ShapeType type, float scale) {
+  JPH_Shape* shape = NULL;
+  float scale3[3] = { scale, scale, scale };
+  mtx_lock(&state.shapeCacheLock);
+  uint64_t holder = lru_get(&state.shapeCache, hash);
+  if (holder != MAP_NIL) {
+    const JPH_Shape* inner = JPH_DecoratedShape_GetInnerShape((const JPH_DecoratedShape*) (uintptr_t) holder);
+    shape = (JPH_Shape*) JPH_ScaledShape_Create(inner, vec3_toJolt(scale3));
+  }
+  mtx_unlock(&state.shapeCacheLock);
+
+  uint64_t offset = shape ? MAP_NIL : map_get(&state.shapeCacheIndex, hash);
+
+  if (offset != MAP_NIL) {
+    const ShapeCacheEntry* entry = (const ShapeCacheEntry*) (state.shapeCacheData + offset);
+
+    // A bad entry (e.g. from a different version of Jolt) is ignored and the shape is rebuilt
+    JPH_Shape* inner = loadShapeData(entry + 1, entry->size, type);
+
+    if (inner) {
+      shape = (JPH_Shape*) JPH_ScaledShape_Create(inner, vec3_toJolt(scale3));
+      cacheShape(hash, inner);
+      JPH_Shape_Destroy(inner);
+    }
+  }
+
+  return shape;
+}
+
+// Only the shapes in the LRU are saved, so the cache stays bounded and drops shapes that weren't
+// used recently.  Returns NULL if no shapes were cooked since the cache was loaded.
+void* lovrPhysicsGetShapeCache(size_t* size) {
+  *size = 0;
+
+  if (!state.shapeCacheDirty) {
+    return NULL;
+  }
+
+  static const char zero[8] = { 0 };
+  ShapeCacheHeader header = { SHAPE_CACHE_MAGIC, SHAPE_CACHE_VERSION, 0, 0 };
+  ByteArray buffer;
+  arr_init(&buffer);
+  arr_append(&buffer, (char*) &header, sizeof(header));
+
+  mtx_lock(&state.shapeCacheLock);
+  for (uint32_t i = 0; i < state.shapeCache.count; i++) {
+    const JPH_Shape* holder = (const JPH_Shape*) (uintptr_t) state.shapeCache.values[i];
+    const JPH_Shape* inner = JPH_DecoratedShape_GetInnerShape((const JPH_DecoratedShape*) holder);
+    ShapeType type = JPH_Shape_GetSubType(inner) == JPH_ShapeSubType_ConvexHull ? SHAPE_CONVEX : SHAPE_MESH;
+    ShapeCacheEntry entry = { .hash = state.shapeCache.hashes[i] };
+    size_t dataSize;
+    void* data = saveShapeData(inner, type, &dataSize);
+    size_t padding = ALIGN(dataSize, 8) - dataSize;
+    entry.size = dataSize;
+    arr_append(&buffer, (char*) &entry, sizeof(entry));
+    arr_append(&buffer, (char*) data, dataSize);
+    arr_append(&buffer, zero, padding);
+    lovrFree(data);
+    header.count++;
+  }
+  mtx_unlock(&state.shapeCacheLock);
+
+  memcpy(buffer.data, &header, sizeof(header));
+  *size = buffer.length;
+  return buffer.data;
+}
+
+void* lovrShapeSerialize(Shape* shape, size_t* size) {
+  lovrCheck(shape->type == SHAPE_CONVEX || shape->type == SHAPE_MESH, "Only ConvexShape and MeshShape can be serialized");
+  const JPH_Shape* inner = JPH_DecoratedShape_GetInnerShape((const JPH_DecoratedShape*) shape->handle);
+  return saveShapeData(inner, shape->type, size);
+}
+
 ConvexShape* lovrConvexShapeCreate(float points[], uint32_t count, float scale) {
   ConvexShape* shape = lovrCalloc(sizeof(ConvexShape));
   shape->ref = 1;
   shape->type = SHAPE_CONVEX;
-  JPH_ConvexHullShapeSettings* settings = JPH_ConvexHullShapeSettings_Create((const JPH_Vec3*) points, count, .05f);
-  JPH_Shape* hull = (JPH_Shape*) JPH_ConvexHullShapeSettings_CreateShape(settings);
-  JPH_ShapeSettings_Destroy((JPH_ShapeSettings*) settings);
+
+  uint64_t hash = hash_mix(hash64(points, count * 3 * sizeof(float)), SHAPE_CONVEX);
+  shape->handle = getCachedShape(hash, SHAPE_CONVEX, scale);
+
+  if (!shape->handle) {
+    JPH_ConvexHullShapeSettings* settings = JPH_ConvexHullShapeSettings_Create((const JPH_Vec3*) points, count, .05f);
+    JPH_Shape* hull = (JPH_Shape*) JPH_ConvexHullShapeSettings_CreateShape(settings);
+    JPH_ShapeSettings_Destroy((JPH_ShapeSettings*) settings);
+    float scale3[3] = { scale, scale, scale };
+    shape->handle = (JPH_Shape*) JPH_ScaledShape_Create(hull, vec3_toJolt(scale3));
+    cacheShape(hash, hull);
+    state.shapeCacheDirty = true;
+    JPH_Shape_Destroy(hull);
+  }
+
+  JPH_Shape_SetUserData(shape->handle, (uint64_t) (uintptr_t) shape);
+  quat_identity(shape->rotation);
+  return shape;
+}
+
+ConvexShape* lovrConvexShapeDeserialize(const void* data, size_t size, float scale) {
+  JPH_Shape* hull = loadShapeData(data, size, SHAPE_CONVEX);
+  if (!hull) return NULL;
+  ConvexShape* shape = lovrCalloc(sizeof(ConvexShape));
+  shape->ref = 1;
+  shape->type = SHAPE_CONVEX;
   float scale3[3] = { scale, scale, scale };
   shape->handle = (JPH_Shape*) JPH_ScaledShape_Create(hull, vec3_toJolt(scale3));
   JPH_Shape_SetUserData(shape->handle, (uint64_t) (uintptr_t) shape);
+  JPH_Shape_Destroy(hull);
   quat_identity(shape->rotation);
   return shape;
 }
@@ -2327,26 +3014,50 @@ MeshShape* lovrMeshShapeCreate(uint32_t vertexCount, float* vertices, uint32_t i
   shape->ref = 1;
   shape->type = SHAPE_MESH;
 
-  uint32_t triangleCount = indexCount / 3;
-  JPH_IndexedTriangle* triangles = lovrMalloc(triangleCount * sizeof(JPH_IndexedTriangle));
-  for (uint32_t i = 0; i < triangleCount; i++) {
-    triangles[i].i1 = indices[i * 3 + 0];
-    triangles[i].i2 = indices[i * 3 + 1];
-    triangles[i].i3 = indices[i * 3 + 2];
-    triangles[i].materialIndex = 0;
-    triangles[i].userData = i;
-  }
-
-  JPH_MeshShapeSettings* settings = JPH_MeshShapeSettings_Create2((const JPH_Vec3*) vertices, vertexCount, triangles, triangleCount);
-  JPH_MeshShapeSettings_SetPerTriangleUserData(settings, true);
-  JPH_MeshShape* mesh = JPH_MeshShapeSettings_CreateShape(settings);
-  JPH_ShapeSettings_Destroy((JPH_ShapeSettings*) settings);
-  lovrFree(triangles);
+  uint64_t hash = hash_mix(hash64(vertices, vertexCount * 3 * sizeof(float)), hash64(indices, indexCount * sizeof(uint32_t)));
+  hash = hash_mix(hash, SHAPE_MESH);
 
   // We wrap MeshShapes in ScaledShapes so that clones can have unique userdata
+  shape->handle = getCachedShape(hash, SHAPE_MESH, scale);
+
+  if (!shape->handle) {
+    uint32_t triangleCount = indexCount / 3;
+    JPH_IndexedTriangle* triangles = lovrMalloc(triangleCount * sizeof(JPH_IndexedTriangle));
+    for (uint32_t i = 0; i < triangleCount; i++) {
+      triangles[i].i1 = indices[i * 3 + 0];
+      triangles[i].i2 = indices[i * 3 + 1];
+      triangles[i].i3 = indices[i * 3 + 2];
+      triangles[i].materialIndex = 0;
+      triangles[i].userData = i;
+    }
+
+    JPH_MeshShapeSettings* settings = JPH_MeshShapeSettings_Create2((const JPH_Vec3*) vertices, vertexCount, triangles, triangleCount);
+    JPH_MeshShapeSettings_SetPerTriangleUserData(settings, true);
+    JPH_MeshShape* mesh = JPH_MeshShapeSettings_CreateShape(settings);
+    JPH_ShapeSettings_Destroy((JPH_ShapeSettings*) settings);
+    lovrFree(triangles);
+
+    float scale3[3] = { scale, scale, scale };
+    shape->handle = (JPH_Shape*) JPH_ScaledShape_Create((JPH_Shape*) mesh, vec3_toJolt(scale3));
+    cacheShape(hash, (JPH_Shape*) mesh);
+    state.shapeCacheDirty = true;
+    JPH_Shape_Destroy((JPH_Shape*) mesh);
+  }
+  JPH_Shape_SetUserData(shape->handle, (uint64_t) (uintptr_t) shape);
+  quat_identity(shape->rotation);
+  return shape;
+}
+
+MeshShape* lovrMeshShapeDeserialize(const void* data, size_t size, float scale) {
+  JPH_Shape* mesh = loadShapeData(data, size, SHAPE_MESH);
+  if (!mesh) return NULL;
+  MeshShape* shape = lovrCalloc(sizeof(MeshShape));
+  shape->ref = 1;
+  shape->type = SHAPE_MESH;
   float scale3[3] = { scale, scale, scale };
-  shape->handle = (JPH_Shape*) JPH_ScaledShape_Create((JPH_Shape*) mesh, vec3_toJolt(scale3));
+  shape->handle = (JPH_Shape*) JPH_ScaledShape_Create(mesh, vec3_toJolt(scale3));
   JPH_Shape_SetUserData(shape->handle, (uint64_t) (uintptr_t) shape);
+  JPH_Shape_Destroy(mesh);
   quat_identity(shape->rotation);
   return shape;
 }
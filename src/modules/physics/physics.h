@@ -27,8 +27,9 @@ typedef Joint DistanceJoint;
 typedef Joint HingeJoint;
 typedef Joint SliderJoint;
 
-bool lovrPhysicsInit(void (*freeUserdata)(void* object, uintptr_t userdata));
+bool lovrPhysicsInit(void (*freeUserdata)(void* object, uintptr_t userdata), const void* shapeCache, size_t shapeCacheSize);
 void lovrPhysicsDestroy(void);
+void* lovrPhysicsGetShapeCache(size_t* size);
 
 // World
 
@@ -49,6 +50,9 @@ typedef struct {
   float restitutionThreshold;
   uint32_t velocitySteps;
   uint32_t positionSteps;
+  uint32_t collisionSteps;
+  float timestep;
+  uint32_t maxSteps;
   const char* tags[MAX_TAGS];
   uint32_t staticTagMask;
   uint32_t tagCount;
@@ -65,6 +69,19 @@ typedef struct {
 
 typedef CastResult OverlapResult;
 
+typedef struct {
+  float start[3];
+  float end[3];
+  uint32_t filter;
+} Raycast;
+
+typedef struct {
+  Shape* shape;
+  float pose[7];
+  float end[3];
+  uint32_t filter;
+} Shapecast;
+
 typedef float CastCallback(void* userdata, CastResult* hit);
 typedef float OverlapCallback(void* userdata, OverlapResult* hit);
 typedef void QueryCallback(void* userdata, Collider* collider);
@@ -81,10 +98,17 @@ Collider* lovrWorldGetColliders(World* world, Collider* collider);
 Joint* lovrWorldGetJoints(World* world, Joint* joint);
 void lovrWorldGetGravity(World* world, float gravity[3]);
 void lovrWorldSetGravity(World* world, float gravity[3]);
-void lovrWorldUpdate(World* world, float dt);
+uint32_t lovrWorldUpdate(World* world, float dt);
 void lovrWorldInterpolate(World* world, float alpha);
+void lovrWorldGetPoses(World* world, Collider** colliders, uint32_t count, float* poses);
+bool lovrWorldSetPoses(World* world, Collider** colliders, uint32_t count, float* poses);
+bool lovrWorldMoveKinematic(World* world, Collider** colliders, uint32_t count, float* poses, float dt);
+void* lovrWorldSaveState(World* world, void* data, size_t* size);
+bool lovrWorldRestoreState(World* world, const void* data, size_t size);
 bool lovrWorldRaycast(World* world, float start[3], float end[3], uint32_t filter, CastCallback* callback, void* userdata);
 bool lovrWorldShapecast(World* world, Shape* shape, float pose[7], float end[3], uint32_t filter, CastCallback* callback, void* userdata);
+uint32_t lovrWorldRaycastBatch(World* world, Raycast* rays, uint32_t count, CastResult* hits);
+uint32_t lovrWorldShapecastBatch(World* world, Shapecast* casts, uint32_t count, CastResult* hits);
 bool lovrWorldOverlapShape(World* world, Shape* shape, float pose[7], float maxDistance, uint32_t filter, OverlapCallback* callback, void* userdata);
 bool lovrWorldQueryBox(World* world, float position[3], float size[3], uint32_t filter, QueryCallback* callback, void* userdata);
 bool lovrWorldQuerySphere(World* world, float position[3], float radius, uint32_t filter, QueryCallback* callback, void* userdata);
@@ -233,6 +257,7 @@ void lovrShapeGetPose(Shape* shape, float position[3], float orientation[4]);
 void lovrShapeGetAABB(Shape* shape, float aabb[6]);
 bool lovrShapeContainsPoint(Shape* shape, float point[3]);
 bool lovrShapeRaycast(Shape* shape, float start[3], float end[3], CastResult* hit);
+void* lovrShapeSerialize(Shape* shape, size_t* size);
 
 BoxShape* lovrBoxShapeCreate(float dimensions[3]);
 void lovrBoxShapeGetDimensions(BoxShape* shape, float dimensions[3]);
@@ -256,6 +281,9 @@ bool lovrCylinderShapeSetLength(CylinderShape* shape, float length);
 
 ConvexShape* lovrConvexShapeCreate(float points[], uint32_t count, float scale);
 ConvexShape* lovrConvexShapeClone(ConvexShape* parent, float scale);
+// Shape data is checked for corruption, but Jolt trusts its contents, so only deserialize data
+// that came from lovrShapeSerialize or the shape cache, never data from an untrusted source.
+ConvexShape* lovrConvexShapeDeserialize(const void* data, size_t size, float scale);
 uint32_t lovrConvexShapeGetPointCount(ConvexShape* shape);
 bool lovrConvexShapeGetPoint(ConvexShape* shape, uint32_t index, float point[3]);
 uint32_t lovrConvexShapeGetFaceCount(ConvexShape* shape);
@@ -264,6 +292,7 @@ float lovrConvexShapeGetScale(ConvexShape* shape);
 
 MeshShape* lovrMeshShapeCreate(uint32_t vertexCount, float vertices[], uint32_t indexCount, uint32_t indices[], float scale);
 MeshShape* lovrMeshShapeClone(MeshShape* parent, float scale);
+MeshShape* lovrMeshShapeDeserialize(const void* data, size_t size, float scale);
 float lovrMeshShapeGetScale(MeshShape* shape);
 
 TerrainShape* lovrTerrainShapeCreate(float* vertices, uint32_t n, float scaleXZ, float scaleY);
@@ -22,6 +22,14 @@ struct Thread {
   bool running;
 };
 
+// Bounded channels use a lock-free ring of cells.  A cell's sequence tells whether it's ready to
+// be written (sequence == position) or read (sequence == position + 1) by whoever claims position.
+// Positions are 64 bits so they never wrap, which lets them double as message ids.
+typedef struct {
+  _Atomic(uint64_t) sequence;
+  Variant variant;
+} ChannelCell;
+
 struct Channel {
   uint32_t ref;
   mtx_t lock;
@@ -31,6 +39,14 @@ struct Channel {
   uint64_t sent;
   uint64_t received;
   uint64_t hash;
+  ChannelCell* ring;
+  uint32_t mask;
+  atomic_uint waiters;
+  char pad[64];
+  _Atomic(uint64_t) readIndex;
+  char pad2[64];
+  _Atomic(uint64_t) writeIndex;
+  char pad3[64];
 };
 
 static struct {
@@ -78,7 +94,7 @@ Channel* lovrThreadGetChannel(const char* name) {
   uint64_t entry = map_get(&state.channels, hash);
 
   if (entry == MAP_NIL) {
-    channel = lovrChannelCreate(hash);
+    channel = lovrChannelCreate(hash, 0);
     map_set(&state.channels, hash, (uint64_t) (uintptr_t) channel);
   } else {
     channel = (Channel*) (uintptr_t) entry;
@@ -182,13 +198,115 @@ const char* lovrThreadGetError(Thread* thread) {
 
 // Channel
 
-Channel* lovrChannelCreate(uint64_t hash) {
+static void waitChannel(Channel* channel, double* timeout) {
+  if (isinf(*timeout)) {
+    cnd_wait(&channel->cond, &channel->lock);
+  } else {
+    struct timespec start;
+    struct timespec until;
+    struct timespec stop;
+    timespec_get(&start, TIME_UTC);
+    double whole, fraction;
+    fraction = modf(*timeout, &whole);
+    until.tv_sec = start.tv_sec + whole;
+    until.tv_nsec = start.tv_nsec + fraction * 1e9;
+    cnd_timedwait(&channel->cond, &channel->lock, &until);
+    timespec_get(&stop, TIME_UTC);
+    *timeout -= (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+  }
+}
+
+// Ring channels only touch the lock when a thread is blocked waiting on the condition variable
+static void notifyChannel(Channel* channel) {
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load(&channel->waiters) > 0) {
+    mtx_lock(&channel->lock);
+    cnd_broadcast(&channel->cond);
+    mtx_unlock(&channel->lock);
+  }
+}
+
+// Claims a run of up to count cells with a single CAS, returns how many were pushed
+static uint32_t ringPush(Channel* channel, Variant* variants, uint32_t count, uint64_t* id) {
+  uint64_t position = atomic_load_explicit(&channel->writeIndex, memory_order_relaxed);
+
+  for (;;) {
+    uint32_t n = 0;
+    while (n < count) {
+      ChannelCell* cell = &channel->ring[(position + n) & channel->mask];
+      if (atomic_load_explicit(&cell->sequence, memory_order_acquire) != position + n) break;
+      n++;
+    }
+
+    if (n == 0) {
+      ChannelCell* cell = &channel->ring[position & channel->mask];
+      int64_t difference = (int64_t) (atomic_load_explicit(&cell->sequence, memory_order_acquire) - position);
+      if (difference < 0) return 0; // Full
+      position = atomic_load_explicit(&channel->writeIndex, memory_order_relaxed);
+      continue;
+    }
+
+    if (atomic_compare_exchange_weak_explicit(&channel->writeIndex, &position, position + n, memory_order_relaxed, memory_order_relaxed)) {
+      for (uint32_t i = 0; i < n; i++) {
+        ChannelCell* cell = &channel->ring[(position + i) & channel->mask];
+        cell->variant = variants[i];
+        atomic_store_explicit(&cell->sequence, position + i + 1, memory_order_release);
+      }
+      *id = position + n;
+      return n;
+    }
+  }
+}
+
+static uint32_t ringPop(Channel* channel, Variant* variants, uint32_t count) {
+  uint64_t position = atomic_load_explicit(&channel->readIndex, memory_order_relaxed);
+
+  for (;;) {
+    uint32_t n = 0;
+    while (n < count) {
+      ChannelCell* cell = &channel->ring[(position + n) & channel->mask];
+      if (atomic_load_explicit(&cell->sequence, memory_order_acquire) != position + n + 1) break;
+      n++;
+    }
+
+    if (n == 0) {
+      ChannelCell* cell = &channel->ring[position & channel->mask];
+      int64_t difference = (int64_t) (atomic_load_explicit(&cell->sequence, memory_order_acquire) - (position + 1));
+      if (difference < 0) return 0; // Empty
+      position = atomic_load_explicit(&channel->readIndex, memory_order_relaxed);
+      continue;
+    }
+
+    if (atomic_compare_exchange_weak_explicit(&channel->readIndex, &position, position + n, memory_order_relaxed, memory_order_relaxed)) {
+      for (uint32_t i = 0; i < n; i++) {
+        ChannelCell* cell = &channel->ring[(position + i) & channel->mask];
+        variants[i] = cell->variant;
+        atomic_store_explicit(&cell->sequence, position + i + channel->mask + 1, memory_order_release);
+      }
+      return n;
+    }
+  }
+}
+
+Channel* lovrChannelCreate(uint64_t hash, uint32_t capacity) {
+  lovrCheck(capacity <= 1 << 24, "Channel capacity can not be greater than %d", 1 << 24);
   Channel* channel = lovrCalloc(sizeof(Channel));
   channel->ref = 1;
   arr_init(&channel->messages);
   mtx_init(&channel->lock, mtx_plain);
   cnd_init(&channel->cond);
   channel->hash = hash;
+
+  if (capacity > 0) {
+    uint32_t size = 2;
+    while (size < capacity) size <<= 1;
+    channel->ring = lovrMalloc(size * sizeof(ChannelCell));
+    channel->mask = size - 1;
+    for (uint32_t i = 0; i < size; i++) {
+      atomic_init(&channel->ring[i].sequence, i);
+    }
+  }
+
   return channel;
 }
 
@@ -196,12 +314,59 @@ void lovrChannelDestroy(void* ref) {
   Channel* channel = ref;
   lovrChannelClear(channel);
   arr_free(&channel->messages);
+  lovrFree(channel->ring);
   mtx_destroy(&channel->lock);
   cnd_destroy(&channel->cond);
   lovrFree(channel);
 }
 
-bool lovrChannelPush(Channel* channel, Variant* variant, double timeout, uint64_t* id) {
+uint32_t lovrChannelGetCapacity(Channel* channel) {
+  return channel->ring ? channel->mask + 1 : 0;
+}
+
+// Returns whether the message was pushed, and sets read to whether it was read before the timeout.
+// If a bounded channel stays full, the message isn't pushed, id is set to zero, and the Variant
+// still belongs to the caller.
+bool lovrChannelPush(Channel* channel, Variant* variant, double timeout, uint64_t* id, bool* read) {
+  *read = false;
+
+  if (channel->ring) {
+    uint64_t position;
+    bool pushed = ringPush(channel, variant, 1, &position);
+
+    if (!pushed && !isnan(timeout) && timeout >= 0) {
+      atomic_fetch_add(&channel->waiters, 1);
+      mtx_lock(&channel->lock);
+      while (!(pushed = ringPush(channel, variant, 1, &position)) && timeout >= 0) {
+        waitChannel(channel, &timeout);
+      }
+      mtx_unlock(&channel->lock);
+      atomic_fetch_sub(&channel->waiters, 1);
+    }
+
+    if (!pushed) {
+      *id = 0;
+      return false;
+    }
+
+    *id = position;
+    notifyChannel(channel);
+
+    if (isnan(timeout) || timeout < 0) {
+      return true;
+    }
+
+    atomic_fetch_add(&channel->waiters, 1);
+    mtx_lock(&channel->lock);
+    while (!lovrChannelHasRead(channel, position) && timeout >= 0) {
+      waitChannel(channel, &timeout);
+    }
+    mtx_unlock(&channel->lock);
+    atomic_fetch_sub(&channel->waiters, 1);
+    *read = lovrChannelHasRead(channel, position);
+    return true;
+  }
+
   mtx_lock(&channel->lock);
   if (channel->messages.length == 0) {
     lovrRetain(channel);
@@ -212,33 +377,39 @@ bool lovrChannelPush(Channel* channel, Variant* variant, double timeout, uint64_
 
   if (isnan(timeout) || timeout < 0) {
     mtx_unlock(&channel->lock);
-    return false;
+    return true;
   }
 
   while (channel->received < *id && timeout >= 0) {
-    if (isinf(timeout)) {
-      cnd_wait(&channel->cond, &channel->lock);
-    } else {
-      struct timespec start;
-      struct timespec until;
-      struct timespec stop;
-      timespec_get(&start, TIME_UTC);
-      double whole, fraction;
-      fraction = modf(timeout, &whole);
-      until.tv_sec = start.tv_sec + whole;
-      until.tv_nsec = start.tv_nsec + fraction * 1e9;
-      cnd_timedwait(&channel->cond, &channel->lock, &until);
-      timespec_get(&stop, TIME_UTC);
-      timeout -= (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
-    }
+    waitChannel(channel, &timeout);
   }
 
-  bool read = channel->received >= *id;
+  *read = channel->received >= *id;
   mtx_unlock(&channel->lock);
-  return read;
+  return true;
 }
 
 bool lovrChannelPop(Channel* channel, Variant* variant, double timeout) {
+  if (channel->ring) {
+    bool popped = ringPop(channel, variant, 1);
+
+    if (!popped && !isnan(timeout) && timeout >= 0) {
+      atomic_fetch_add(&channel->waiters, 1);
+      mtx_lock(&channel->lock);
+      while (!(popped = ringPop(channel, variant, 1)) && timeout >= 0) {
+        waitChannel(channel, &timeout);
+      }
+      mtx_unlock(&channel->lock);
+      atomic_fetch_sub(&channel->waiters, 1);
+    }
+
+    if (popped) {
+      notifyChannel(channel);
+    }
+
+    return popped;
+  }
+
   mtx_lock(&channel->lock);
 
   do {
@@ -257,25 +428,75 @@ bool lovrChannelPop(Channel* channel, Variant* variant, double timeout) {
       return false;
     }
 
-    if (isinf(timeout)) {
-      cnd_wait(&channel->cond, &channel->lock);
-    } else {
-      struct timespec start;
-      struct timespec until;
-      struct timespec stop;
-      timespec_get(&start, TIME_UTC);
-      double whole, fraction;
-      fraction = modf(timeout, &whole);
-      until.tv_sec = start.tv_sec + whole;
-      until.tv_nsec = start.tv_nsec + fraction * 1e9;
-      cnd_timedwait(&channel->cond, &channel->lock, &until);
-      timespec_get(&stop, TIME_UTC);
-      timeout -= (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / (double) 1e9;
-    }
+    waitChannel(channel, &timeout);
   } while (1);
 }
 
+// Batches never wait.  They take the lock (or wake waiters) once instead of once per message.
+uint32_t lovrChannelPushBatch(Channel* channel, Variant* variants, uint32_t count) {
+  if (channel->ring) {
+    uint64_t id;
+    uint32_t pushed = 0, n;
+    while (pushed < count && (n = ringPush(channel, variants + pushed, count - pushed, &id)) > 0) {
+      pushed += n;
+    }
+    if (pushed > 0) notifyChannel(channel);
+    return pushed;
+  }
+
+  if (count == 0) {
+    return 0;
+  }
+
+  mtx_lock(&channel->lock);
+  if (channel->messages.length == 0) {
+    lovrRetain(channel);
+  }
+  arr_append(&channel->messages, variants, count);
+  channel->sent += count;
+  cnd_broadcast(&channel->cond);
+  mtx_unlock(&channel->lock);
+  return count;
+}
+
+uint32_t lovrChannelPopBatch(Channel* channel, Variant* variants, uint32_t count) {
+  if (channel->ring) {
+    uint32_t popped = 0, n;
+    while (popped < count && (n = ringPop(channel, variants + popped, count - popped)) > 0) {
+      popped += n;
+    }
+    if (popped > 0) notifyChannel(channel);
+    return popped;
+  }
+
+  mtx_lock(&channel->lock);
+  size_t available = channel->messages.length - channel->head;
+  uint32_t popped = available < count ? (uint32_t) available : count;
+  if (popped > 0) {
+    memcpy(variants, channel->messages.data + channel->head, popped * sizeof(Variant));
+    channel->head += popped;
+    if (channel->head == channel->messages.length) {
+      channel->head = channel->messages.length = 0;
+      lovrRelease(channel, lovrChannelDestroy);
+    }
+    channel->received += popped;
+    cnd_broadcast(&channel->cond);
+  }
+  mtx_unlock(&channel->lock);
+  return popped;
+}
+
 bool lovrChannelPeek(Channel* channel, Variant* variant) {
+  if (channel->ring) {
+    uint64_t position = atomic_load(&channel->readIndex);
+    ChannelCell* cell = &channel->ring[position & channel->mask];
+    if (atomic_load_explicit(&cell->sequence, memory_order_acquire) == position + 1) {
+      *variant = cell->variant;
+      return atomic_load(&channel->readIndex) == position;
+    }
+    return false;
+  }
+
   mtx_lock(&channel->lock);
 
   if (channel->head < channel->messages.length) {
@@ -289,6 +510,15 @@ bool lovrChannelPeek(Channel* channel, Variant* variant) {
 }
 
 void lovrChannelClear(Channel* channel) {
+  if (channel->ring) {
+    Variant variant;
+    while (ringPop(channel, &variant, 1)) {
+      lovrVariantDestroy(&variant);
+    }
+    notifyChannel(channel);
+    return;
+  }
+
   mtx_lock(&channel->lock);
   for (size_t i = channel->head; i < channel->messages.length; i++) {
     lovrVariantDestroy(&channel->messages.data[i]);
@@ -301,6 +531,12 @@ void lovrChannelClear(Channel* channel) {
 }
 
 uint64_t lovrChannelGetCount(Channel* channel) {
+  if (channel->ring) {
+    uint64_t read = atomic_load(&channel->readIndex);
+    uint64_t write = atomic_load(&channel->writeIndex);
+    return write > read ? write - read : 0;
+  }
+
   mtx_lock(&channel->lock);
   uint64_t length = channel->messages.length - channel->head;
   mtx_unlock(&channel->lock);
@@ -308,6 +544,10 @@ uint64_t lovrChannelGetCount(Channel* channel) {
 }
 
 bool lovrChannelHasRead(Channel* channel, uint64_t id) {
+  if (channel->ring) {
+    return atomic_load(&channel->readIndex) >= id;
+  }
+
   mtx_lock(&channel->lock);
   bool received = channel->received >= id;
   mtx_unlock(&channel->lock);
@@ -32,10 +32,13 @@ const char* lovrThreadGetError(Thread* thread);
 
 // Channel
 
-Channel* lovrChannelCreate(uint64_t hash);
+Channel* lovrChannelCreate(uint64_t hash, uint32_t capacity);
 void lovrChannelDestroy(void* ref);
-bool lovrChannelPush(Channel* channel, struct Variant* variant, double timeout, uint64_t* id);
+uint32_t lovrChannelGetCapacity(Channel* channel);
+bool lovrChannelPush(Channel* channel, struct Variant* variant, double timeout, uint64_t* id, bool* read);
 bool lovrChannelPop(Channel* channel, struct Variant* variant, double timeout);
+uint32_t lovrChannelPushBatch(Channel* channel, struct Variant* variants, uint32_t count);
+uint32_t lovrChannelPopBatch(Channel* channel, struct Variant* variants, uint32_t count);
 bool lovrChannelPeek(Channel* channel, struct Variant* variant);
 void lovrChannelClear(Channel* channel);
 uint64_t lovrChannelGetCount(Channel* channel);
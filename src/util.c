@@ -155,6 +155,159 @@ void map_set(map_t* map, uint64_t hash, uint64_t value) {
   map->values[h] = value;
 }
 
+uint64_t map_remove(map_t* map, uint64_t hash) {
+  uint64_t mask = map->size - 1;
+  uint64_t h = map_find(map, hash);
+  uint64_t value = map->values[h];
+
+  if (map->hashes[h] == MAP_NIL) {
+    return MAP_NIL;
+  }
+
+  // Shift back any entries in the rest of the cluster that would no longer be reachable
+  for (uint64_t i = (h + 1) & mask; map->hashes[i] != MAP_NIL; i = (i + 1) & mask) {
+    uint64_t home = map->hashes[i] & mask;
+    if (((i - home) & mask) >= ((i - h) & mask)) {
+      map->hashes[h] = map->hashes[i];
+      map->values[h] = map->values[i];
+      h = i;
+    }
+  }
+
+  map->hashes[h] = MAP_NIL;
+  map->values[h] = MAP_NIL;
+  map->used--;
+  return value;
+}
+
+void map_get_stats(map_t* map, map_stats* stats) {
+  uint64_t mask = map->size - 1;
+  uint64_t total = 0;
+  stats->size = map->size;
+  stats->used = map->used;
+  stats->load = map->size > 0 ? (float) map->used / map->size : 0.f;
+  stats->maxProbe = 0;
+
+  for (uint32_t i = 0; i < map->size; i++) {
+    if (map->hashes[i] != MAP_NIL) {
+      uint32_t probe = (uint32_t) ((i - (map->hashes[i] & mask)) & mask) + 1;
+      stats->maxProbe = probe > stats->maxProbe ? probe : stats->maxProbe;
+      total += probe;
+    }
+  }
+
+  stats->averageProbe = map->used > 0 ? (float) total / map->used : 0.f;
+}
+
+// LRU
+// Entries live in fixed slots linked from most (head) to least (tail) recently used, the map
+// points from hashes to slots.
+
+#define LRU_NIL ~0u
+
+static void lru_unlink(lru_t* lru, uint32_t slot) {
+  if (lru->prev[slot] != LRU_NIL) lru->next[lru->prev[slot]] = lru->next[slot];
+  else lru->head = lru->next[slot];
+  if (lru->next[slot] != LRU_NIL) lru->prev[lru->next[slot]] = lru->prev[slot];
+  else lru->tail = lru->prev[slot];
+}
+
+static void lru_link(lru_t* lru, uint32_t slot) {
+  lru->prev[slot] = LRU_NIL;
+  lru->next[slot] = lru->head;
+  if (lru->head != LRU_NIL) lru->prev[lru->head] = slot;
+  else lru->tail = slot;
+  lru->head = slot;
+}
+
+void lru_init(lru_t* lru, uint32_t capacity) {
+  if (capacity == 0) capacity = 1;
+  map_init(&lru->map, capacity);
+  lru->hashes = lovrMalloc(capacity * (2 * sizeof(uint64_t) + 2 * sizeof(uint32_t)));
+  lru->values = lru->hashes + capacity;
+  lru->prev = (uint32_t*) (lru->values + capacity);
+  lru->next = lru->prev + capacity;
+  lru->head = LRU_NIL;
+  lru->tail = LRU_NIL;
+  lru->count = 0;
+  lru->capacity = capacity;
+}
+
+void lru_free(lru_t* lru) {
+  if (lru) {
+    map_free(&lru->map);
+    lovrFree(lru->hashes);
+    lru->hashes = NULL;
+  }
+}
+
+uint64_t lru_get(lru_t* lru, uint64_t hash) {
+  uint64_t slot = map_get(&lru->map, hash);
+
+  if (slot == MAP_NIL) {
+    return MAP_NIL;
+  }
+
+  if (slot != lru->head) {
+    lru_unlink(lru, (uint32_t) slot);
+    lru_link(lru, (uint32_t) slot);
+  }
+
+  return lru->values[slot];
+}
+
+uint64_t lru_set(lru_t* lru, uint64_t hash, uint64_t value, uint64_t* evicted) {
+  uint64_t slot = map_get(&lru->map, hash);
+  uint64_t old = MAP_NIL;
+  if (evicted) *evicted = MAP_NIL;
+
+  if (slot != MAP_NIL) {
+    lru_unlink(lru, (uint32_t) slot);
+  } else if (lru->count < lru->capacity) {
+    slot = lru->count++;
+    map_set(&lru->map, hash, slot);
+  } else {
+    slot = lru->tail;
+    lru_unlink(lru, (uint32_t) slot);
+    map_remove(&lru->map, lru->hashes[slot]);
+    map_set(&lru->map, hash, slot);
+    if (evicted) *evicted = lru->hashes[slot];
+    old = lru->values[slot];
+  }
+
+  lru->hashes[slot] = hash;
+  lru->values[slot] = value;
+  lru_link(lru, (uint32_t) slot);
+  return old;
+}
+
+uint64_t lru_remove(lru_t* lru, uint64_t hash) {
+  uint64_t slot = map_remove(&lru->map, hash);
+
+  if (slot == MAP_NIL) {
+    return MAP_NIL;
+  }
+
+  uint64_t value = lru->values[slot];
+  lru_unlink(lru, (uint32_t) slot);
+
+  // Keep slots packed by moving the last slot into the hole
+  uint32_t last = --lru->count;
+  if (slot != last) {
+    lru->hashes[slot] = lru->hashes[last];
+    lru->values[slot] = lru->values[last];
+    lru->prev[slot] = lru->prev[last];
+    lru->next[slot] = lru->next[last];
+    if (lru->prev[slot] != LRU_NIL) lru->next[lru->prev[slot]] = (uint32_t) slot;
+    else lru->head = (uint32_t) slot;
+    if (lru->next[slot] != LRU_NIL) lru->prev[lru->next[slot]] = (uint32_t) slot;
+    else lru->tail = (uint32_t) slot;
+    map_set(&lru->map, lru->hashes[slot], slot);
+  }
+
+  return value;
+}
+
 // UTF-8
 // https://github.com/starwing/luautf8
 
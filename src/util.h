@@ -1,6 +1,7 @@
 #include <stdarg.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #pragma once
 
@@ -94,17 +95,72 @@ static inline void _arr_reserve(void** data, size_t n, size_t* capacity, size_t
   *data = lovrRealloc(*data, *capacity * stride);
 }
 
-// Hash function (FNV1a)
+// Hash function (wyhash, reads 8 bytes at a time)
+static inline void hash_mum(uint64_t* a, uint64_t* b) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = (__uint128_t) *a * *b;
+  *a = (uint64_t) r, *b = (uint64_t) (r >> 64);
+#else
+  uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t) *a, lb = (uint32_t) *b;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+  uint64_t lo = t + (rm1 << 32), hi = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl) + (lo < t);
+  *a = lo, *b = hi;
+#endif
+}
+
+static inline uint64_t hash_mix(uint64_t a, uint64_t b) {
+  hash_mum(&a, &b);
+  return a ^ b;
+}
+
+static inline uint64_t hash_read64(const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static inline uint64_t hash_read32(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
 static inline uint64_t hash64(const void* data, size_t length) {
-  const uint8_t* bytes = (const uint8_t*) data;
-  uint64_t hash = 0xcbf29ce484222325;
-  for (size_t i = 0; i < length; i++) {
-    hash = (hash ^ bytes[i]) * 0x100000001b3;
+  static const uint64_t s[4] = { 0xa0761d6478bd642f, 0xe7037ed1a0b428db, 0x8ebc6af09c88c6e3, 0x589965cc75374cc3 };
+  const uint8_t* p = (const uint8_t*) data;
+  uint64_t seed = s[0] ^ hash_mix(s[0], s[1]);
+  uint64_t a, b;
+
+  if (length <= 16) {
+    if (length >= 4) {
+      size_t offset = (length >> 3) << 2;
+      a = (hash_read32(p) << 32) | hash_read32(p + offset);
+      b = (hash_read32(p + length - 4) << 32) | hash_read32(p + length - 4 - offset);
+    } else if (length > 0) {
+      a = ((uint64_t) p[0] << 16) | ((uint64_t) p[length >> 1] << 8) | p[length - 1];
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    size_t i = length;
+    if (i > 48) {
+      uint64_t see1 = seed, see2 = seed;
+      do {
+        seed = hash_mix(hash_read64(p) ^ s[1], hash_read64(p + 8) ^ seed);
+        see1 = hash_mix(hash_read64(p + 16) ^ s[2], hash_read64(p + 24) ^ see1);
+        see2 = hash_mix(hash_read64(p + 32) ^ s[3], hash_read64(p + 40) ^ see2);
+        p += 48, i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      seed = hash_mix(hash_read64(p) ^ s[1], hash_read64(p + 8) ^ seed);
+      p += 16, i -= 16;
+    }
+    a = hash_read64(p + i - 16);
+    b = hash_read64(p + i - 8);
   }
-  return hash;
+
+  a ^= s[1], b ^= seed;
+  hash_mum(&a, &b);
+  return hash_mix(a ^ s[0] ^ length, b ^ s[1]);
 }
 
-// Hashmap (does not support removal)
+// Hashmap (linear probing, removal shifts entries back so there are no tombstones)
+// Iterate by walking hashes/values and skipping MAP_NIL.  Removing the current entry during
+// iteration moves a later entry into its slot, so the slot has to be visited again.
 typedef struct {
   uint64_t* hashes;
   uint64_t* values;
@@ -112,12 +168,41 @@ typedef struct {
   uint32_t used;
 } map_t;
 
+typedef struct {
+  uint32_t size;
+  uint32_t used;
+  float load;
+  float averageProbe;
+  uint32_t maxProbe;
+} map_stats;
+
 #define MAP_NIL UINT64_MAX
 
 void map_init(map_t* map, uint32_t n);
 void map_free(map_t* map);
 uint64_t map_get(map_t* map, uint64_t hash);
 void map_set(map_t* map, uint64_t hash, uint64_t value);
+uint64_t map_remove(map_t* map, uint64_t hash);
+void map_get_stats(map_t* map, map_stats* stats);
+
+// LRU cache (map with a fixed number of entries, setting a new key evicts the least recently used)
+typedef struct {
+  map_t map;
+  uint64_t* hashes;
+  uint64_t* values;
+  uint32_t* prev;
+  uint32_t* next;
+  uint32_t head;
+  uint32_t tail;
+  uint32_t count;
+  uint32_t capacity;
+} lru_t;
+
+void lru_init(lru_t* lru, uint32_t capacity);
+void lru_free(lru_t* lru);
+uint64_t lru_get(lru_t* lru, uint64_t hash);
+uint64_t lru_set(lru_t* lru, uint64_t hash, uint64_t value, uint64_t* evicted);
+uint64_t lru_remove(lru_t* lru, uint64_t hash);
 
 // UTF-8
 size_t utf8_decode(const char *s, const char *e, unsigned *pch);
@@ -29,5 +29,158 @@ group('data', function()
       expect({ image:getPixel(0, 0) }).to.equal({ 1, 2, 0, 1 })
       expect({ image:getPixel(3, 3) }).to.equal({ 9, 8, 0, 1 })
     end)
+
+    test(':compress', function()
+      local image = lovr.data.newImage(6, 5)
+      image:mapPixel(function(x, y) return x / 5, y / 4, 0, 1 end)
+
+      for _, format in ipairs({ 'bc1', 'bc3', 'bc4u', 'bc5u', 'bc7' }) do
+        local compressed = image:compress(format)
+        expect(compressed:getFormat()).to.equal(format)
+        expect({ compressed:getDimensions() }).to.equal({ 6, 5 })
+      end
+
+      expect(function() image:compress('rgba8') end).to.fail()
+      expect(function() lovr.data.newImage(4, 4, 'r16f'):compress('bc7') end).to.fail()
+    end)
+
+    test(':compress round trip', function()
+      local function bits(bytes, start, count)
+        local value = 0
+        for i = start + count - 1, start, -1 do
+          value = value * 2 + math.floor(bytes[math.floor(i / 8) + 1] / 2 ^ (i % 8)) % 2
+        end
+        return value
+      end
+
+      local function unpack565(c)
+        local r, g, b = math.floor(c / 2048), math.floor(c / 32) % 64, c % 32
+        return { (r * 8 + math.floor(r / 4)) / 255, (g * 4 + math.floor(g / 16)) / 255, (b * 8 + math.floor(b / 4)) / 255 }
+      end
+
+      -- Decode the first 4x4 block into 16 rgba pixels, row by row
+      local decoders = {
+        bc1 = function(b)
+          local c0, c1 = b[1] + b[2] * 256, b[3] + b[4] * 256
+          local p0, p1 = unpack565(c0), unpack565(c1)
+          local palette = { p0, p1, {}, { 0, 0, 0 } }
+          for c = 1, 3 do
+            if c0 > c1 then
+              palette[3][c] = (2 * p0[c] + p1[c]) / 3
+              palette[4][c] = (p0[c] + 2 * p1[c]) / 3
+            else
+              palette[3][c] = (p0[c] + p1[c]) / 2
+            end
+          end
+          local pixels = {}
+          for i = 0, 15 do
+            local index = bits(b, 32 + 2 * i, 2)
+            local color = palette[index + 1]
+            pixels[i + 1] = { color[1], color[2], color[3], (c0 <= c1 and index == 3) and 0 or 1 }
+          end
+          return pixels
+        end,
+        bc4u = function(b)
+          local r0, r1 = b[1], b[2]
+          local palette = { r0, r1 }
+          for i = 2, 7 do
+            if r0 > r1 then
+              palette[i + 1] = ((8 - i) * r0 + (i - 1) * r1) / 7
+            elseif i < 6 then
+              palette[i + 1] = ((6 - i) * r0 + (i - 1) * r1) / 5
+            else
+              palette[i + 1] = i == 6 and 0 or 255
+            end
+          end
+          local pixels = {}
+          for i = 0, 15 do
+            pixels[i + 1] = { palette[bits(b, 16 + 3 * i, 3) + 1] / 255, 0, 0, 1 }
+          end
+          return pixels
+        end,
+        bc7 = function(b)
+          expect(bits(b, 0, 7)).to.equal(64) -- Mode 6
+          local weights = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 }
+          local e0, e1 = {}, {}
+          for c = 0, 3 do
+            e0[c + 1] = bits(b, 7 + 14 * c, 7) * 2 + bits(b, 63, 1)
+            e1[c + 1] = bits(b, 14 + 14 * c, 7) * 2 + bits(b, 64, 1)
+          end
+          local pixels = {}
+          for i = 0, 15 do
+            local index = i == 0 and bits(b, 65, 3) or bits(b, 64 + 4 * i, 4)
+            local w = weights[index + 1]
+            pixels[i + 1] = {}
+            for c = 1, 4 do
+              pixels[i + 1][c] = math.floor(((64 - w) * e0[c] + w * e1[c] + 32) / 64) / 255
+            end
+          end
+          return pixels
+        end
+      }
+
+      local image = lovr.data.newImage(4, 4)
+      image:mapPixel(function(x, y) return x / 3, 1 - x / 3, .5, 1 end)
+
+      for format, decode in pairs(decoders) do
+        local blob = image:compress(format):getBlob()
+        local pixels = decode({ blob:getU8(0, format == 'bc7' and 16 or 8) })
+        for y = 0, 3 do
+          for x = 0, 3 do
+            local expected = { image:getPixel(x, y) }
+            if format == 'bc4u' then expected = { expected[1], 0, 0, 1 } end
+            expect(pixels[y * 4 + x + 1]).to.equal(expected, .06)
+          end
+        end
+      end
+    end)
+
+    test(':fill', function()
+      local image = lovr.data.newImage(4, 4)
+      image:fill({ 1, .5, 0, 1 })
+      image:fill(0x000000, 2, 2, 2, 2)
+      expect({ image:getPixel(0, 0) }).to.equal({ 1, .5, 0, 1 }, .01)
+      expect({ image:getPixel(3, 3) }).to.equal({ 0, 0, 0, 1 })
+    end)
+
+    test(':swizzle', function()
+      local image = lovr.data.newImage(2, 2, 'rgba32f')
+      image:fill({ .1, .2, .3, .4 })
+      image:swizzle('bgr1')
+      expect({ image:getPixel(1, 1) }).to.equal({ .3, .2, .1, 1 }, 1e-6)
+    end)
+
+    test(':combine', function()
+      local image = lovr.data.newImage(2, 2, 'rgba32f')
+      local other = lovr.data.newImage(1, 1, 'rgba32f')
+      image:fill({ 1, 1, 1, 1 })
+      other:fill({ 2, 3, 4, 1 })
+      image:combine(other, 'multiply', 1, 1)
+      expect({ image:getPixel(1, 1) }).to.equal({ 2, 3, 4, 1 })
+      expect({ image:getPixel(0, 0) }).to.equal({ 1, 1, 1, 1 })
+      expect(function() image:combine(image, 'add') end).to.fail()
+    end)
+
+    test(':convert', function()
+      local image = lovr.data.newImage(2, 2, 'rgba32f')
+      image:fill({ 2, .5, -1, 1 })
+      local converted = image:convert('rgba8')
+      expect(converted:getFormat()).to.equal('rgba8')
+      expect({ converted:getPixel(0, 0) }).to.equal({ 1, .5, 0, 1 }, .01)
+    end)
+
+    test(':resize', function()
+      local image = lovr.data.newImage(4, 4, 'rgba32f')
+      image:mapPixel(function(x, y) return x, 1, 1, 1 end)
+
+      local resized = image:resize(2, 2, 'box')
+      expect({ resized:getDimensions() }).to.equal({ 2, 2 })
+      expect({ resized:getPixel(0, 0) }).to.equal({ .5, 1, 1, 1 }, 1e-5)
+      expect({ resized:getPixel(1, 1) }).to.equal({ 2.5, 1, 1, 1 }, 1e-5)
+
+      local mipmapped = image:generateMipmaps('box')
+      expect({ mipmapped:getDimensions() }).to.equal({ 4, 4 })
+      expect(mipmapped:getFormat()).to.equal('rgba32f')
+    end)
   end)
 end)
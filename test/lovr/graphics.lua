@@ -363,6 +363,36 @@ group('graphics', function()
       local lines = font:getLines({ 0xff0000, 'hello ', 0x0000ff, 'world' }, 0)
       expect(lines).to.equal({ 'hello ', 'world' })
     end)
+
+    test(':prewarm', function()
+      local font = lovr.graphics.newFont(lovr.data.newRasterizer(20))
+      local before = font:getVertices('hello')
+      font:prewarm(32, 126)
+      font:prewarm('hello world')
+      local after = font:getVertices('hello')
+      expect(#after).to.equal(#before)
+      for i = 1, #before do
+        expect(after[i][1]).to.equal(before[i][1], 1e-6)
+        expect(after[i][2]).to.equal(before[i][2], 1e-6)
+      end
+    end)
+
+    test(':getCache', function()
+      local font = lovr.graphics.newFont(lovr.data.newRasterizer(20))
+      local before = font:getVertices('hello')
+      local cache = font:getCache()
+      local copy = lovr.graphics.newFont(lovr.data.newRasterizer(20))
+      expect(copy:loadCache(cache)).to.equal(true)
+      expect(copy:loadCache(cache)).to.equal(false)
+      expect(lovr.graphics.newFont(lovr.data.newRasterizer(21)):loadCache(cache)).to.equal(false)
+      local after = copy:getVertices('hello')
+      expect(#after).to.equal(#before)
+      for i = 1, #before do
+        for j = 1, 4 do
+          expect(after[i][j]).to.equal(before[i][j], 1e-6)
+        end
+      end
+    end)
   end)
 
   group('Mesh', function()
@@ -480,6 +510,74 @@ group('graphics', function()
       image = texture:getPixels()
       expect({ image:getPixel(0, 0) }).to.equal({ 0, 0, 1, 1 })
     end)
+
+    test(':fork', function()
+      texture = lovr.graphics.newTexture(1, 1, { usage = { 'render', 'transfer' } })
+      pass = lovr.graphics.newPass(texture)
+
+      -- Forks inherit state
+      pass:setColor(1, 0, 0)
+      fork = pass:fork()
+      fork:fill()
+      lovr.graphics.submit(pass)
+      image = texture:getPixels()
+      expect({ image:getPixel(0, 0) }).to.equal({ 1, 0, 0, 1 })
+      expect(pass:getStats().draws).to.equal(1)
+      expect(function() fork:fill() end).to.fail()
+
+      -- Forked draws happen where the fork was created
+      pass:reset()
+      fork = pass:fork()
+      fork:setColor(0, 0, 1)
+      fork:fill()
+      pass:setColor(0, 1, 0)
+      pass:fill()
+      lovr.graphics.submit(pass)
+      image = texture:getPixels()
+      expect({ image:getPixel(0, 0) }).to.equal({ 0, 1, 0, 1 })
+      expect(function() fork:reset() end).to.fail()
+    end)
+
+    test(':setSorting', function()
+      texture = lovr.graphics.newTexture(1, 1)
+      pass = lovr.graphics.newPass(texture)
+      expect(pass:isSorting()).to.equal(false)
+      pass:setSorting(true)
+      expect(pass:isSorting()).to.equal(true)
+      for i = 1, 4 do
+        pass:setShader(i % 2 == 0 and 'normal' or 'unlit')
+        pass:sphere(0, 0, -1 - i)
+      end
+      lovr.graphics.submit(pass)
+      expect(pass:getStats().drawsCulled).to.equal(0)
+      expect(pass:getStats().stateChangesSaved > 0).to.equal(true)
+    end)
+
+    test('batching', function()
+      texture = lovr.graphics.newTexture(1, 1, { usage = { 'render', 'transfer' } })
+      pass = lovr.graphics.newPass(texture)
+      pass:setColor(1, 0, 0)
+      pass:plane(0, 0, -2, 10, 10)
+      pass:setColor(0, 0, 1)
+      pass:plane(0, 0, -1, 10, 10)
+      lovr.graphics.submit(pass)
+      expect(pass:getStats().drawsBatched).to.equal(1)
+      image = texture:getPixels()
+      expect({ image:getPixel(0, 0) }).to.equal({ 0, 0, 1, 1 })
+
+      -- Fragment shaders that use the draw index aren't batched, since it's only known per vertex
+      shader = lovr.graphics.newShader('unlit', 'vec4 lovrmain() { return Draws[DrawID].color; }')
+      pass:reset()
+      pass:setShader(shader)
+      pass:setColor(1, 0, 0)
+      pass:plane(0, 0, -2, 10, 10)
+      pass:setColor(0, 1, 0)
+      pass:plane(0, 0, -1, 10, 10)
+      lovr.graphics.submit(pass)
+      expect(pass:getStats().drawsBatched).to.equal(0)
+      image = texture:getPixels()
+      expect({ image:getPixel(0, 0) }).to.equal({ 0, 1, 0, 1 })
+    end)
   end)
 
   group('Shader', function()
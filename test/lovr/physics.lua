@@ -3,6 +3,14 @@ group('physics', function()
   before(function() world = lovr.physics.newWorld() end)
 
   group('World', function()
+    test('fixed timestep', function()
+      local fixed = lovr.physics.newWorld({ timestep = 1 / 64, collisionSteps = 2, maxSteps = 4 })
+      expect(fixed:update(1 / 128)).to.equal(0)
+      expect(fixed:update(1 / 128)).to.equal(1)
+      expect(fixed:update(1)).to.equal(4)
+      expect(fixed:update(1 / 256)).to.equal(0)
+    end)
+
     test('distant colliders', function()
       local c1 = world:newBoxCollider(1e8, 0, 0)
       local c2 = world:newBoxCollider(1e8, 0, 0)
@@ -15,6 +23,50 @@ group('physics', function()
         world:raycast(0, 10, 0, 0, -10, 0)
       end)
     end)
+
+    test(':raycastBatch', function()
+      local box = world:newBoxCollider(0, 0, 0, 1, 1, 1)
+      local results, count = world:raycastBatch({ 0, 10, 0, 0, -10, 0,  5, 10, 0, 5, -10, 0 })
+      expect(count).to.equal(1)
+      expect(results[1]).to.equal(box)
+      expect({ select(3, (table.unpack or unpack)(results, 1, 9)) }).to.equal({ 0, .5, 0, 0, 1, 0, .475 }, 1e-5)
+      expect(results[10]).to.equal(false)
+    end)
+
+    test(':getPoses', function()
+      local a = world:newBoxCollider(1, 2, 3)
+      local b = world:newBoxCollider(4, 5, 6)
+      local poses, count = world:getPoses({ b, a })
+      expect(count).to.equal(2)
+      expect({ poses:getF32(0, 7) }).to.equal({ 4, 5, 6, 0, 0, 0, 1 }, 1e-6)
+      expect({ poses:getF32(28, 7) }).to.equal({ 1, 2, 3, 0, 0, 0, 1 }, 1e-6)
+      world:setPoses({ a, b }, poses)
+      expect({ a:getPosition() }).to.equal({ 4, 5, 6 }, 1e-6)
+      expect({ b:getPosition() }).to.equal({ 1, 2, 3 }, 1e-6)
+
+      -- Nothing is moved if any of the colliders can't be
+      b:setEnabled(false)
+      expect(function() world:setPoses({ a, b }, (world:getPoses({ b, a }))) end).to.fail()
+      expect({ a:getPosition() }).to.equal({ 4, 5, 6 }, 1e-6)
+    end)
+
+    test(':saveState', function()
+      local c = world:newSphereCollider(0, 10, 0)
+      c:setLinearVelocity(1, 0, 0)
+      local state = world:saveState()
+      world:update(.1)
+      expect((c:getPosition())).to_not.equal(0)
+      world:restoreState(state)
+      expect({ c:getPosition() }).to.equal({ 0, 10, 0 }, 1e-6)
+      expect({ c:getLinearVelocity() }).to.equal({ 1, 0, 0 }, 1e-6)
+      c:setAwake(false)
+      state = world:saveState(state)
+      c:setAwake(true)
+      world:restoreState(state)
+      expect(c:isAwake()).to.equal(false)
+      world:newBoxCollider()
+      expect(function() world:restoreState(state) end).to.fail()
+    end)
   end)
 
   group('Collider', function()
@@ -96,6 +148,15 @@ group('physics', function()
           shape = lovr.physics.newMeshShape(mesh)
         end)
       end
+
+      test(':serialize', function()
+        local vertices = { 0, .4, 0, -.5, -.4, 0, .5, -.4, 0 }
+        local blob = lovr.physics.newMeshShape(vertices, { 1, 2, 3 }):serialize()
+        local copy = lovr.physics.newMeshShape(blob, 2)
+        expect(copy:getScale()).to.equal(2)
+        expect({ copy:raycast(0, .6, 5, 0, .6, -5) }).to.equal({ 0, .6, 0, 0, 0, 1, 1 }, 1e-6)
+        expect(function() lovr.physics.newConvexShape(blob) end).to.fail()
+      end)
     end)
   end)
 end)
@@ -22,5 +22,34 @@ group('thread', function()
       t.t = t
       expect(function() channel:push(t) end).to.fail()
     end)
+
+    test('bounded', function()
+      local channel = lovr.thread.newChannel(3)
+      expect(channel:getCapacity()).to.equal(4)
+      expect(channel:pushBatch({ 1, 'two', { 3 }, 4, 5 })).to.equal(4)
+      expect(channel:push(6)).to.equal(0)
+      expect(channel:getCount()).to.equal(4)
+      expect({ channel:popBatch(3) }).to.equal({ 1, 'two', { 3 } })
+      expect(channel:pop()).to.equal(4)
+      expect(channel:pop()).to.equal(nil)
+      expect(lovr.thread.newChannel():getCapacity()).to.equal(nil)
+
+      -- Nothing is pushed if a value can't be sent
+      channel:clear()
+      expect(function() channel:pushBatch({ 1, 2, print }) end).to.fail()
+      expect(channel:getCount()).to.equal(0)
+    end)
+
+    test(':popBatch', function()
+      -- Messages that don't fit on the stack stay in the Channel
+      local channel = lovr.thread.newChannel()
+      local messages = {}
+      for i = 1, 100000 do messages[i] = i end
+      channel:pushBatch(messages)
+      local count = select('#', channel:popBatch())
+      expect(count > 0).to.equal(true)
+      expect(count + channel:getCount()).to.equal(100000)
+      channel:clear()
+    end)
   end)
 end)